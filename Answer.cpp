@@ -47,26 +47,230 @@ namespace {
     
     /// 過去の移動履歴
     Vec2 _positionHistory[Parameter::GameTurnPerStage];
+    
+    /// 蓮ごとの、次の蓮へ向かう区間の情報です
+    // _lotuses と _field はステージ中に変わらないので、Init で一度だけ求めておいて毎ターンは表を引くだけにする
+    struct RouteLeg
+    {
+        Vec2 aimPoint;      ///< 次の蓮の方向にある蓮の縁の点から、流れの分を差し引いた、アクセルで狙う点
+    };
+    
+    /// 蓮ごとの区間の情報（添字は蓮の番号）
+    // ゲームのルールでの最大数だけ持つ。それより多い蓮（-ls で増やした場合）は毎回求める
+    RouteLeg _route[Parameter::LotusCountMax];
+    
+    /// 軌道の表に持つターン数の最大値
+    // 衝突で速さが増えることはないので、速さは CharaAccelSpeed を超えず、止まるまでのターン数は
+    // CharaAccelSpeed / CharaDecelSpeed (= 14) 以下になる。余裕をみて倍より多く持つ
+    const int TrajectoryTurnCountMax = 32;
+    
+    /// 閉じた式で求めたターンの範囲を広げる幅（座標の大きさに対する比）
+    // 表の位置は1ターンずつの丸め誤差で直線から少しずれるので、範囲を広げてから IsHit で確かめる
+    const float TrajectoryMarginRatio = 1.0e-3f;
+    
+    /// 一定の速度で進む点が円の中にいる間の、進んだ回数の範囲を求めます
+    // aStart から1回に aStep ずつ進む点と、aCenter との距離が aRadius 以下になる u の範囲 [aBegin, aEnd] を返す。
+    // 二次方程式の解を、一番近づく点からの距離で求めて桁落ちを避ける。円に入らなければfalseを返します
+    bool solveStepRange(const Vec2& aStart, const Vec2& aStep, const Vec2& aCenter, float aRadius, float& aBegin, float& aEnd)
+    {
+        const Vec2 toStart = aStart - aCenter;
+        const float squareStep = aStep.squareLength();
+        const float closestStep = -toStart.dot(aStep) / squareStep;
+        const float squareDist = (toStart + aStep * closestStep).squareLength();
+        if (squareDist > aRadius * aRadius) {
+            return false;
+        }
+        const float halfStep = Math::Sqrt((aRadius * aRadius - squareDist) / squareStep);
+        aBegin = closestStep - halfStep;
+        aEnd = closestStep + halfStep;
+        return true;
+    }
+    
+    /// アクセルを踏まなかった場合に、GetNextAction が予想する軌道です
+    // 1ターン目は今の速度で、2ターン目からは「今の速さ - CharaDecelSpeed」の一定の速さで、流れとあわせて進み、
+    // 今の速さを CharaDecelSpeed で割ったターン数（切り捨て）で止まると見なす。止まった後は流れにも流されない。
+    // 予想の結果を変えないように、位置は1ターンずつ足し合わせた値を浮動小数の丸めまでそのまま表にしておく。
+    // 表の値が1ターンずつ求めた値と一致することは、 -st (ModelCheck) で調べている。
+    struct Trajectory
+    {
+        int turnCount;                                  ///< 表にあるターン数（止まるターンか、求めたターン数の小さい方）
+        Vec2 positions[TrajectoryTurnCountMax + 1];     ///< nターン後の位置（添字はターン数）
+        
+        /// 位置と速度から、aTurnCountMaxターン後までの軌道を求めます
+        Trajectory(const Vec2& aPos, const Vec2& aVel, const Vec2& aFlowVel, int aTurnCountMax)
+        : turnCount(0)
+        {
+            const float speed = aVel.length();
+            const int stopTurn = static_cast<int>(speed / Parameter::CharaDecelSpeed());
+            turnCount = Math::Min(Math::Min(stopTurn, aTurnCountMax), TrajectoryTurnCountMax);
+            const float nextSpeed = speed - Parameter::CharaDecelSpeed();
+            Vec2 currentVel = aVel;
+            positions[0] = aPos;
+            for (int turn = 1; turn <= turnCount; ++turn) {
+                positions[turn] = positions[turn - 1] + currentVel + aFlowVel;
+                currentVel.normalize();
+                currentVel *= nextSpeed;
+            }
+        }
+        
+        /// nターン後の位置を返します
+        const Vec2& posAt(int turn) const
+        {
+            return positions[Math::Min(turn, turnCount)];
+        }
+        
+        /// 止まる地点を返します
+        const Vec2& stopPos() const
+        {
+            return positions[turnCount];
+        }
+        
+        /// 座標の丸め誤差に見合う、閉じた式の範囲を広げる幅を返します
+        float marginFor(const Vec2& aPoint) const
+        {
+            const float scale = Math::Max(
+                Math::Max(Math::Abs(positions[0].x), Math::Abs(positions[0].y))
+                , Math::Max(Math::Abs(aPoint.x), Math::Abs(aPoint.y))
+                );
+            return TrajectoryMarginRatio * (1.0f + scale);
+        }
+        
+        /// maxTurnターン以内で初めてregionに触れるターンを返します。触れなければ-1を返します
+        // 2ターン目からは一定の速度で進むので、触れ始めるターンは円と直線の交点から閉じた式で求まる。
+        // 求めた範囲を少し広げて、その中だけを1ターン分の移動ごとに IsHit で確かめる
+        int firstTurnInRegion(const Circle& region, int maxTurn) const
+        {
+            const int lastTurn = Math::Min(maxTurn, turnCount);
+            if (lastTurn < 1) {
+                return -1;
+            }
+            const float charaRadius = Parameter::CharaRadius();
+            if (Collision::IsHit(region, Circle(positions[0], charaRadius), positions[1])) {
+                return 1;
+            }
+            if (lastTurn < 2) {
+                return -1;
+            }
+            
+            // 2ターン目からの移動は、positions[1] から1ターンに step ずつ進む直線上にある
+            // nターン目の移動は u = n - 2 から u = n - 1 まで
+            const Vec2 step = (positions[lastTurn] - positions[1]) / static_cast<float>(lastTurn - 1);
+            int beginTurn = 2;
+            int endTurn = lastTurn;
+            if (!step.isZero()) {
+                const float radius = region.radius() + charaRadius + marginFor(region.pos());
+                float beginStep = 0.0f;
+                float endStep = 0.0f;
+                if (!solveStepRange(positions[1], step, region.pos(), radius, beginStep, endStep)) {
+                    return -1;
+                }
+                const float lastStep = static_cast<float>(lastTurn);
+                beginTurn = Math::Max(beginTurn, Math::Ceil(Math::LimitMinMax(beginStep, -1.0f, lastStep)) + 1);
+                endTurn = Math::Min(endTurn, 2 - Math::Ceil(-Math::LimitMinMax(endStep, -1.0f, lastStep)));
+            }
+            for (int turn = beginTurn; turn <= endTurn; ++turn) {
+                if (Collision::IsHit(region, Circle(positions[turn - 1], charaRadius), positions[turn])) {
+                    return turn;
+                }
+            }
+            return -1;
+        }
+        
+        /// startTurnからendTurnまでの間で、両方の軌道が一定の速度で進む（か止まっている）とき、
+        /// checkTurnからendTurnまでで初めてotherと重なるターンを返します。重ならなければ-1を返します
+        int firstContactTurnIn(const Trajectory& other, int startTurn, int endTurn, int checkTurn) const
+        {
+            const float charaRadius = Parameter::CharaRadius();
+            int beginTurn = checkTurn;
+            int lastTurn = endTurn;
+            if (startTurn < endTurn) {
+                // 相対位置は、startTurnの位置から1ターンに step ずつ進む直線上にある
+                const Vec2 startPos = posAt(startTurn) - other.posAt(startTurn);
+                const Vec2 step = (posAt(endTurn) - other.posAt(endTurn) - startPos) / static_cast<float>(endTurn - startTurn);
+                if (!step.isZero()) {
+                    const float radius = charaRadius * 2.0f + marginFor(other.posAt(startTurn));
+                    float beginStep = 0.0f;
+                    float endStep = 0.0f;
+                    if (!solveStepRange(startPos, step, Vec2(), radius, beginStep, endStep)) {
+                        return -1;
+                    }
+                    const float lastStep = static_cast<float>(endTurn - startTurn);
+                    beginTurn = Math::Max(beginTurn, startTurn + Math::Ceil(Math::LimitMinMax(beginStep, 0.0f, lastStep)));
+                    lastTurn = Math::Min(lastTurn, startTurn - Math::Ceil(-Math::LimitMinMax(endStep, 0.0f, lastStep)));
+                } else {
+                    // 相対位置が変わらなければ、1ターン調べれば足りる
+                    lastTurn = Math::Min(lastTurn, beginTurn);
+                }
+            }
+            for (int turn = beginTurn; turn <= lastTurn; ++turn) {
+                if (Collision::IsHit(Circle(posAt(turn), charaRadius), Circle(other.posAt(turn), charaRadius))) {
+                    return turn;
+                }
+            }
+            return -1;
+        }
+        
+        /// maxTurnターン以内で、ターンの終わりに初めてotherと重なるターンを返します。重ならなければ-1を返します
+        // どちらの軌道も1ターン目から止まるまでは一定の速度で進み、その後は動かないので、相対位置は
+        // 「両方が動く」「片方だけが動く」「両方止まっている」の区間ごとに直線の上を等間隔に進む。
+        // 区間ごとに重なるターンの範囲を閉じた式で求めて、その中だけを IsHit で確かめる
+        int firstContactTurn(const Trajectory& other, int maxTurn) const
+        {
+            const int lastTurn = Math::Min(maxTurn, TrajectoryTurnCountMax);
+            if (lastTurn < 1) {
+                return -1;
+            }
+            const int bounds[] = {
+                1
+                , Math::LimitMinMax(Math::Min(turnCount, other.turnCount), 1, lastTurn)
+                , Math::LimitMinMax(Math::Max(turnCount, other.turnCount), 1, lastTurn)
+                , lastTurn
+            };
+            const int boundCount = sizeof(bounds) / sizeof(bounds[0]);
+            int checkTurn = 1;
+            for (int i = 1; i < boundCount; ++i) {
+                if (bounds[i] < checkTurn) {
+                    continue;
+                }
+                const int turn = firstContactTurnIn(other, bounds[i - 1], bounds[i], checkTurn);
+                if (turn >= 0) {
+                    return turn;
+                }
+                checkTurn = bounds[i] + 1;
+            }
+            return -1;
+        }
+    };
+    
+    /// Init で同時にシミュレーションする候補の最大数
+    const int RolloutLaneCountMax = 32;
+    
+    /// 候補ごとのダミープレイヤーを並べて、まとめてシミュレーションするための構造です
+    // 同じ種類の値を候補の数だけ連続して並べ、全候補を1ターンずつ同時に進める
+    struct RolloutLanes
+    {
+        int count;                                      ///< 候補の数
+        int passedTurn;                                 ///< 経過ターン（全候補共通）
+        int passedLotusCount;                           ///< 通過した蓮の数（全候補共通）
+        float minSpeed[RolloutLaneCountMax];            ///< 候補ごとの予想最低速度
+        float posX[RolloutLaneCountMax];                ///< 位置
+        float posY[RolloutLaneCountMax];                ///< 位置
+        float velX[RolloutLaneCountMax];                ///< 速度
+        float velY[RolloutLaneCountMax];                ///< 速度
+        int accelCount[RolloutLaneCountMax];            ///< 加速できる回数
+        int accelWaitTurn[RolloutLaneCountMax];         ///< 加速回数が増えるまでのターン数
+        int targetLotusNo[RolloutLaneCountMax];         ///< 目標の蓮
+        int roundCount[RolloutLaneCountMax];            ///< 周回数
+        int requiredAccelCount[RolloutLaneCountMax];    ///< 踏んだアクセルの回数
+        int wholeAccelCount[RolloutLaneCountMax];       ///< 得られたアクセルの回数
+        int lastTargetLotusNo[RolloutLaneCountMax];     ///< 前回の目的地
+        bool isActive[RolloutLaneCountMax];             ///< シミュレーション中かどうか
+    };
 }
 
 /// プロコン問題環境を表します。
 namespace hpc {
     
-    /// 新しいダミー用のプレイヤーを生成します
-    DummyPlayer createDummyPlayer()
-    {
-        DummyPlayer dummy;
-        dummy.roundCount = 0;
-        dummy.passedTurn = 0;
-        dummy.passedLotusCount = 0;
-        dummy.accelCount = 0;
-        dummy.accelWaitTurn = Parameter::CharaAddAccelWaitTurn;
-        dummy.targetLotusNo = 0;
-        dummy.pos = _initialPlayerPosition;
-        dummy.vel = Vec2();
-        return dummy;
-    }
-    
     /// Charaクラスからダミー用のプレイヤーを生成します
     DummyPlayer createDummyPlayer(const Chara& player)
     {
@@ -119,51 +323,17 @@ namespace hpc {
         return goal;
     }
     
-    /// nターン後の位置を返す
-    Vec2 posAfterTurn(DummyPlayer dplayer, int afterTurn) {
-        float stopTurn = dplayer.vel.length() / Parameter::CharaDecelSpeed();
-        if (afterTurn > stopTurn)
-        {
-            afterTurn = stopTurn;
-        }
-        float a = -Parameter::CharaDecelSpeed();
-        Vec2 currentVel = dplayer.vel;
-        Vec2 currentPos = dplayer.pos;
-        for (int passedTurn = 1; passedTurn <= afterTurn; ++passedTurn) {
-            currentPos = currentPos + currentVel + _field.flowVel();
-            float currentSpeed = dplayer.vel.length();
-            currentVel.normalize();
-            currentSpeed += a;
-            currentVel *= currentSpeed;
-        }
-        return currentPos;
-    }
-    
+    /// 今の速度のまま止まるまで進んだ位置を返す
     Vec2 posCurrentAccel(DummyPlayer dplayer) {
-        float stopTurn = dplayer.vel.length() / Parameter::CharaDecelSpeed();
-        return posAfterTurn(dplayer, stopTurn);
+        return Trajectory(dplayer.pos, dplayer.vel, _field.flowVel(), TrajectoryTurnCountMax).stopPos();
     }
     
     /// ある地点までplayerが到達するのに何ターンかかるか計算します
     // 到達不可能なら-1が返ります
     int calcTurnToReachRegion(DummyPlayer dplayer, Circle region, int maxTurn)
     {
-        Vec2 prevPos = dplayer.pos;
-        // 何ターン後に止まるか
-        float stopTurn = dplayer.vel.length() / Parameter::CharaDecelSpeed();
-        if (maxTurn >= stopTurn) {
-            maxTurn = stopTurn;
-        }
-        float charaRadius = Parameter::CharaRadius();
-        // 1ターンずつシミュレーションする
-        for (int passedTurn = 1; passedTurn <= maxTurn; ++passedTurn) {
-            Vec2 futurePos = posAfterTurn(dplayer, passedTurn);
-            if (Collision::IsHit(region, Circle(prevPos, charaRadius), futurePos)) {
-                return passedTurn;
-            }
-            prevPos = futurePos;
-        }
-        return -1;
+        // 止まるまでに到達するかを調べる
+        return Trajectory(dplayer.pos, dplayer.vel, _field.flowVel(), maxTurn).firstTurnInRegion(region, maxTurn);
     }
     
     // targetに現在のアクセルだけでtターン以内に到達可能かどうか
@@ -177,34 +347,59 @@ namespace hpc {
         return true;
     }
     
-    /// 次の目的地を返します
-    Vec2 getNextTarget(DummyPlayer player)
+    /// 流れの分を差し引くために、アクセルを踏んでから止まるまでのターン数を返します
+    float getStreamCompensationTurn()
     {
         const float v0 = Parameter::CharaAccelSpeed();
         const float d = -Parameter::CharaDecelSpeed();
-        float t = -(v0 / d);
+        return -(v0 / d);
+    }
+    
+    /// 蓮iから次の蓮へ向かうときに、アクセルで狙う点を求めます
+    Vec2 calcAimPoint(int i)
+    {
+        const int lotusCount = _lotuses.count();
+        const Lotus& target = _lotuses[i];
+        const Lotus& next = _lotuses[(i + 1) % lotusCount];
+        Vec2 aimPoint = getTargetByTwoPoints(target, next.pos());
+        aimPoint -= _field.flowVel() * getStreamCompensationTurn();
+        return aimPoint;
+    }
+    
+    /// 区間の情報を蓮ごとに求めて _route に入れます
+    // _lotuses と _field を設定してから呼ぶ
+    void buildRoute()
+    {
+        const int lotusCount = Math::Min(_lotuses.count(), Parameter::LotusCountMax);
+        for (int i = 0; i < lotusCount; ++i) {
+            _route[i].aimPoint = calcAimPoint(i);
+        }
+    }
+    
+    /// 次の目的地を返します
+    Vec2 getNextTarget(DummyPlayer player)
+    {
         int lotusCount = _lotuses.count();
-        Vec2 goal;
         int targetLotusNo = player.targetLotusNo;
         int roundNo = player.roundCount;
-        const Lotus& target = _lotuses[targetLotusNo];
         
         // もし、targetが最後ハスだったら
         if (roundNo == 2 && targetLotusNo == lotusCount - 1)
         {
+            // プレイヤーの位置で変わるので、毎回計算する
+            const Lotus& target = _lotuses[targetLotusNo];
             Vec2 sub = player.pos - target.pos();
             sub.normalize(target.radius() * 0.75);
-            goal = target.pos() + sub;
-        } else {
-            // それ以外の時
-            const Lotus& target2 = _lotuses[(targetLotusNo + 1) % lotusCount];
-            
-            goal = getTargetByTwoPoints(target, target2.pos());
+            Vec2 goal = target.pos() + sub;
+            Vec2 stream = _field.flowVel();
+            goal -= stream * getStreamCompensationTurn();
+            return goal;
         }
-        Vec2 stream = _field.flowVel();
-        goal -= stream * t;
-        return goal;
-        
+        // それ以外の時は、Init で求めておいた点を使う
+        if (targetLotusNo < Parameter::LotusCountMax) {
+            return _route[targetLotusNo].aimPoint;
+        }
+        return calcAimPoint(targetLotusNo);
     }
     
     // targetに現在のアクセルだけで止まるまでに到達可能かどうか
@@ -216,22 +411,17 @@ namespace hpc {
     }
     
     /// 特定ターン以内に敵と自機がぶつかりそうならぶつかるであろうターンを返します。そうじゃなければ-1を返します
+    // ルール通り、各ターンの終わりの位置で重なるかどうかを、2つの軌道から閉じた式で求める
     int turnToHitWithEnemy(DummyPlayer dplayer, const Chara& enemy, int maxTurn)
     {
-        DummyPlayer denemy = createDummyPlayer(enemy);
-        for (int passedTurn = 1; passedTurn <= maxTurn; ++passedTurn) {
-            Vec2 myFuturePos = posAfterTurn(dplayer, passedTurn);
-            Vec2 enemyFuturePos = posAfterTurn(denemy, passedTurn);
-            if (Collision::IsHit(Circle(myFuturePos, Parameter::CharaRadius()),
-                                 Circle(enemyFuturePos, Parameter::CharaRadius()))) {
-                return passedTurn;
-            }
-        }
-        return -1;
+        const Trajectory myTrajectory(dplayer.pos, dplayer.vel, _field.flowVel(), maxTurn);
+        const Trajectory enemyTrajectory(enemy.pos(), enemy.vel(), _field.flowVel(), maxTurn);
+        return myTrajectory.firstContactTurn(enemyTrajectory, maxTurn);
     }
     
     /// GetNextActionをダミープレイヤーでシミュレーションする
-    Action simulateGetNextAction(DummyPlayer dplayer, float minSpeed, const EnemyAccessor* enemies)
+    // lastTargetLotusNoには前回の目的地が入っていて、今回の目的地で更新される
+    Action simulateGetNextAction(DummyPlayer dplayer, float minSpeed, const EnemyAccessor* enemies, int& lastTargetLotusNo)
     {
         // 最低限残しておくアクセル回数
         bool saveAccel = true;
@@ -249,7 +439,7 @@ namespace hpc {
         
         // 規定速度以下の時
         if (vel.length() <= minSpeed) {
-            if (_lastTargetLotusNo != dplayer.targetLotusNo) {
+            if (lastTargetLotusNo != dplayer.targetLotusNo) {
                 // 前回と目的地が変わってたら無条件で踏む
                 doAccel = true;
             } else {
@@ -267,7 +457,7 @@ namespace hpc {
             }
         }
         
-        _lastTargetLotusNo = dplayer.targetLotusNo;
+        lastTargetLotusNo = dplayer.targetLotusNo;
         _positionHistory[dplayer.passedTurn] = dplayer.pos;
         
         // 本番の時は敵を考慮する
@@ -298,6 +488,283 @@ namespace hpc {
         return Action::Wait();
     }
     
+    /// 候補のシミュレーションを初期化します
+    void setupRollout(RolloutLanes& lanes, const Chara& player, const float* minSpeeds, int count)
+    {
+        lanes.count = Math::Min(count, RolloutLaneCountMax);
+        lanes.passedTurn = player.passedTurn();
+        lanes.passedLotusCount = player.passedLotusCount();
+        for (int lane = 0; lane < lanes.count; ++lane) {
+            lanes.minSpeed[lane] = minSpeeds[lane];
+            lanes.posX[lane] = player.pos().x;
+            lanes.posY[lane] = player.pos().y;
+            lanes.velX[lane] = player.vel().x;
+            lanes.velY[lane] = player.vel().y;
+            lanes.accelCount[lane] = player.accelCount();
+            lanes.accelWaitTurn[lane] = player.accelWaitTurn();
+            lanes.targetLotusNo[lane] = player.targetLotusNo();
+            lanes.roundCount[lane] = player.roundCount();
+            lanes.requiredAccelCount[lane] = 0;
+            lanes.wholeAccelCount[lane] = player.accelCount();
+            lanes.lastTargetLotusNo[lane] = _lastTargetLotusNo;
+            lanes.isActive[lane] = true;
+        }
+    }
+    
+    /// 候補の1つをダミープレイヤーとして取り出します
+    DummyPlayer getRolloutPlayer(const RolloutLanes& lanes, int lane)
+    {
+        DummyPlayer dummy;
+        dummy.roundCount = lanes.roundCount[lane];
+        dummy.passedTurn = lanes.passedTurn;
+        dummy.passedLotusCount = lanes.passedLotusCount;
+        dummy.accelCount = lanes.accelCount[lane];
+        dummy.accelWaitTurn = lanes.accelWaitTurn[lane];
+        dummy.targetLotusNo = lanes.targetLotusNo[lane];
+        dummy.pos = Vec2(lanes.posX[lane], lanes.posY[lane]);
+        dummy.vel = Vec2(lanes.velX[lane], lanes.velY[lane]);
+        return dummy;
+    }
+    
+    /// 全候補を1ターン同時に進めます
+    // forcedActionsを渡すと、候補ごとにその行動をとる（0ならGetNextActionと同じ判断をする）
+    // ゴールした候補はisGoalsがtrueになり、シミュレーションを終える。
+    // 動いている候補がなければfalseを返します
+    bool stepRollout(RolloutLanes& lanes, int passedTurn, const Action* forcedActions, bool* isGoals)
+    {
+        const float flowX = _field.flowVel().x;
+        const float flowY = _field.flowVel().y;
+        const float decel = Parameter::CharaDecelSpeed();
+        float prevX[RolloutLaneCountMax];
+        float prevY[RolloutLaneCountMax];
+        bool isHits[RolloutLaneCountMax];
+        
+        // 行動を決める（分岐が多いので候補ごとに行う）
+        int activeCount = 0;
+        for (int lane = 0; lane < lanes.count; ++lane) {
+            if (!lanes.isActive[lane]) {
+                continue;
+            }
+            ++activeCount;
+            const DummyPlayer dummy = getRolloutPlayer(lanes, lane);
+            Action nextAction = forcedActions != 0
+                ? forcedActions[lane]
+                : simulateGetNextAction(dummy, lanes.minSpeed[lane], 0, lanes.lastTargetLotusNo[lane]);
+            if (nextAction.type() == ActionType_Accel && dummy.accelCount > 0) {
+                // アクセルを踏む
+                const Vec2 toTargetVec = nextAction.value() - dummy.pos;
+                // 目標座標とキャラ座標が同値の場合、何もしない
+                if (!toTargetVec.isZero()) {
+                    const Vec2 vel = toTargetVec.getNormalized(Parameter::CharaAccelSpeed());
+                    --lanes.accelCount[lane];
+                    lanes.velX[lane] = vel.x;
+                    lanes.velY[lane] = vel.y;
+                    ++lanes.requiredAccelCount[lane];
+                }
+            }
+        }
+        if (activeCount == 0) {
+            return false;
+        }
+        
+        // 移動と減速（全候補で同じ計算なので並べて行う）
+        // Chara::move と同じ順序で計算して結果を一致させている
+        for (int lane = 0; lane < lanes.count; ++lane) {
+            prevX[lane] = lanes.posX[lane];
+            prevY[lane] = lanes.posY[lane];
+            lanes.posX[lane] += lanes.velX[lane];
+            lanes.posY[lane] += lanes.velY[lane];
+            lanes.posX[lane] += flowX;
+            lanes.posY[lane] += flowY;
+        }
+        for (int lane = 0; lane < lanes.count; ++lane) {
+            Vec2 vel(lanes.velX[lane], lanes.velY[lane]);
+            if (!vel.isZero()) {
+                const float len = Math::Max(vel.length() - decel, 0.0f);
+                if (0.0f < len) {
+                    vel.normalize(len);
+                } else {
+                    vel.reset();
+                }
+            }
+            lanes.velX[lane] = vel.x;
+            lanes.velY[lane] = vel.y;
+        }
+        
+        // 蓮の通過を判定する
+        for (int lane = 0; lane < lanes.count; ++lane) {
+            const Circle& region = _lotuses[lanes.targetLotusNo[lane]].region();
+            const Circle prevCircle(Vec2(prevX[lane], prevY[lane]), Parameter::CharaRadius());
+            isHits[lane] = Collision::IsHit(region, prevCircle, Vec2(lanes.posX[lane], lanes.posY[lane]));
+        }
+        
+        // ゴールの判定
+        for (int lane = 0; lane < lanes.count; ++lane) {
+            isGoals[lane] = false;
+            if (!lanes.isActive[lane]) {
+                continue;
+            }
+            if (isHits[lane]) {
+                // 目標の蓮を通過したら、次の蓮との判定を行う
+                ++lanes.targetLotusNo[lane];
+                // 一周回ったら周回数加算
+                if (_lotuses.count() == lanes.targetLotusNo[lane]) {
+                    lanes.targetLotusNo[lane] = 0;
+                    ++lanes.roundCount[lane];
+                }
+            }
+            if (lanes.roundCount[lane] == Parameter::StageRoundCount) {
+                isGoals[lane] = true;
+                lanes.isActive[lane] = false;
+            }
+        }
+        
+        // プレイヤーの更新
+        lanes.passedTurn = passedTurn;
+        for (int lane = 0; lane < lanes.count; ++lane) {
+            --lanes.accelWaitTurn[lane];
+            if (lanes.accelWaitTurn[lane] <= 0) {
+                lanes.accelCount[lane] = Math::Min(lanes.accelCount[lane] + 1, Parameter::CharaAccelCountMax);
+                lanes.accelWaitTurn[lane] = Parameter::CharaAddAccelWaitTurn;
+                ++lanes.wholeAccelCount[lane];
+            }
+        }
+        return true;
+    }
+    
+    /// 全候補を1ターンずつ同時に進めて、一番早くゴールした候補の番号を返します
+    // ゴールした候補がなければ-1を返します。同じターンにゴールしたら番号の小さい方を選ぶ。
+    // 1つでもゴールしたら、それより遅い候補は調べる意味がないのでその時点で打ち切る
+    int runRollout(RolloutLanes& lanes, int maxTurn, int& goalTurn)
+    {
+        bool isGoals[RolloutLaneCountMax];
+        for (int passedTurn = 0; passedTurn <= maxTurn; ++passedTurn) {
+            if (!stepRollout(lanes, passedTurn, 0, isGoals)) {
+                break;
+            }
+            for (int lane = 0; lane < lanes.count; ++lane) {
+                // 途中でアクセルが足りなくなる候補は採用しない
+                if (isGoals[lane] && lanes.wholeAccelCount[lane] >= lanes.requiredAccelCount[lane]) {
+                    goalTurn = passedTurn;
+                    return lane;
+                }
+            }
+        }
+        return -1;
+    }
+    
+    /// 先読みで比べる最初の行動の候補の最大数
+    const int PlanCandidateCountMax = 4;
+    /// 先読みするターン数の最初の値。予算が残っている限り倍にしていく
+    const int PlanHorizonMin = 8;
+    /// GetNextAction 1回の先読みで進められる、候補ごとのターン数の合計（予算）
+    // 時間ではなくシミュレーションの量で区切るので、実行環境やワーカー数によらず同じ結果になる。
+    // 3つの候補を PlanHorizonMin ターンずつ比べられる量で、全ステージの実行時間は先読みなしの3倍程度に収まる
+    const int PlanTurnBudget = 24;
+    
+    /// 近くに敵がいるかどうか
+    // GetNextAction が敵を避けてアクセルを控える範囲と同じ。先読みは敵を考えないので、このときは先読みしない
+    bool isEnemyNear(DummyPlayer dplayer, const EnemyAccessor& enemies)
+    {
+        for (int i = 0; i < enemies.count(); ++i) {
+            const int isHit = turnToHitWithEnemy(dplayer, enemies[i], 5);
+            if (isHit >= 1 && isHit <= 3) {
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    /// 先読みした候補の評価値を返します（大きいほど良い）
+    // ゴールしていれば早いほど良い。そうでなければ通過した蓮の数で比べる。
+    // 目標の蓮までの距離や残りのアクセルの回数まで比べると、目先で得をする候補を選んで後で損をしやすい
+    int evaluatePlanLane(const RolloutLanes& lanes, int lane, int goalTurn)
+    {
+        if (goalTurn >= 0) {
+            return Parameter::StageRoundCount * _lotuses.count() + Parameter::GameTurnPerStage - goalTurn;
+        }
+        return lanes.roundCount[lane] * _lotuses.count() + lanes.targetLotusNo[lane];
+    }
+    
+    /// 予算の範囲で先読みして、一番良さそうな行動を返します
+    // 候補ごとに最初の行動だけを変えて、その後は GetNextAction と同じ判断で進める。
+    // 先読みするターン数を倍にしながら、予算で全候補を比べ終えられる一番深いところまで繰り返す。
+    // ゴールしていない途中の評価は当てにならないので、 baseAction より早くゴールする候補だけを採用する。
+    // 評価が同じなら baseAction を選ぶので、予算が足りなければ baseAction がそのまま返る
+    Action planNextAction(const Chara& player, const Action& baseAction)
+    {
+        Action candidates[PlanCandidateCountMax];
+        int candidateCount = 0;
+        candidates[candidateCount++] = baseAction;
+        if (player.accelCount() > 0) {
+            if (baseAction.type() == ActionType_Accel) {
+                candidates[candidateCount++] = Action::Wait();
+            } else {
+                candidates[candidateCount++] = Action::Accel(getNextTarget(createDummyPlayer(player)));
+            }
+            // 流れを差し引いた蓮の中心も狙ってみる
+            const Lotus& target = _lotuses[player.targetLotusNo()];
+            candidates[candidateCount++] = Action::Accel(target.pos() - _field.flowVel() * getStreamCompensationTurn());
+        }
+        if (candidateCount == 1) {
+            return baseAction;
+        }
+        
+        float minSpeeds[PlanCandidateCountMax];
+        for (int i = 0; i < candidateCount; ++i) {
+            minSpeeds[i] = _minSpeed;
+        }
+        // 予算が足りる限り、ステージの最後まで先読みする
+        const int horizonMax = Parameter::GameTurnPerStage - player.passedTurn();
+        // 先読みでグローバル変数が書き換わるので、後で元に戻す
+        const float lastAccelTurn = _lastAccelTurn;
+        const Vec2 lastAccelPos = _lastAccelPos;
+        
+        int bestCandidate = 0;
+        int budget = PlanTurnBudget;
+        for (int horizon = Math::Min(PlanHorizonMin, horizonMax); horizon * candidateCount <= budget; horizon = Math::Min(horizon * 2, horizonMax)) {
+            budget -= horizon * candidateCount;
+            RolloutLanes lanes;
+            setupRollout(lanes, player, minSpeeds, candidateCount);
+            int goalTurns[PlanCandidateCountMax];
+            bool isGoals[RolloutLaneCountMax];
+            for (int i = 0; i < candidateCount; ++i) {
+                goalTurns[i] = -1;
+            }
+            for (int turn = 0; turn < horizon; ++turn) {
+                if (!stepRollout(lanes, player.passedTurn() + turn + 1, turn == 0 ? candidates : 0, isGoals)) {
+                    break;
+                }
+                for (int i = 0; i < candidateCount; ++i) {
+                    if (isGoals[i]) {
+                        goalTurns[i] = turn;
+                    }
+                }
+            }
+            
+            int best = 0;
+            int bestValue = evaluatePlanLane(lanes, 0, goalTurns[0]);
+            bool isAllGoal = goalTurns[0] >= 0;
+            for (int i = 1; i < candidateCount; ++i) {
+                const int value = evaluatePlanLane(lanes, i, goalTurns[i]);
+                if (value > bestValue) {
+                    best = i;
+                    bestValue = value;
+                }
+                isAllGoal = isAllGoal && goalTurns[i] >= 0;
+            }
+            bestCandidate = goalTurns[best] >= 0 ? best : 0;
+            // 全候補がゴールしていれば、これ以上深く読んでも変わらない
+            if (isAllGoal || horizon == horizonMax) {
+                break;
+            }
+        }
+        
+        _lastAccelTurn = lastAccelTurn;
+        _lastAccelPos = lastAccelPos;
+        return candidates[bestCandidate];
+    }
+    
     //------------------------------------------------------------------------------
     /// 各ステージ開始時に呼び出されます。
     ///
@@ -312,84 +779,27 @@ namespace hpc {
         // fieldとlotusesは変更され得ないので、最初にコピーしてグローバルにアクセスできるようにしている
         _field = aStageAccessor.field();
         _lotuses = aStageAccessor.lotuses();
+        buildRoute();
         
         // 予想最低速度を算出する
-        float minPassedTurn = Parameter::GameTurnPerStage;
         float minSpeed = Parameter::CharaAccelSpeed();
         const float stopTime = Math::Abs(Parameter::CharaAccelSpeed() / Parameter::CharaDecelSpeed());
         
         // minSpeedを徐々に変えてって一番早く回れた奴を採用する
-        for (float aps = 1.0; aps <= stopTime; aps += 1.0) {
-            int requiredAccelCount = 0;
-            int wholeAccelCount = player.accelCount();
-            float speed = Parameter::CharaAccelSpeed() - ((aps - 1) * Parameter::CharaDecelSpeed());
-            // めっちゃリアルっぽいシミュレーションする
-            DummyPlayer dummyPlayer = createDummyPlayer(player);
-            // ゴールするまでリアルシミュレーション
-            // 経験上、2300ターンは超えない気がするから2300まで
-            for (int passedTurn = 0; passedTurn <= 2300; ++passedTurn) {
-                const Lotus& targetLotus = _lotuses[dummyPlayer.targetLotusNo];
-                Action nextAction = simulateGetNextAction(dummyPlayer, speed, 0);
-                if (nextAction.type() == ActionType_Accel && dummyPlayer.accelCount > 0) {
-                    // アクセルを踏む
-                    const Vec2 toTargetVec = nextAction.value() - dummyPlayer.pos;
-                    // 目標座標とキャラ座標が同値の場合、何もしない
-                    if (!toTargetVec.isZero()) {
-                        --dummyPlayer.accelCount;
-                        dummyPlayer.vel = toTargetVec.getNormalized(Parameter::CharaAccelSpeed());
-                        ++requiredAccelCount;
-                    }
-                } else {
-                    // Waitなら何もしない
-                }
-                Vec2 prevPos = dummyPlayer.pos;
-                dummyPlayer.pos += dummyPlayer.vel;
-                dummyPlayer.pos += _field.flowVel();
-                
-                // 減速させる
-                if (!dummyPlayer.vel.isZero()) {
-                    const float len = Math::Max(
-                                                dummyPlayer.vel.length() - Parameter::CharaDecelSpeed()
-                                                , 0.0f
-                                                );
-                    if (0.0f < len) {
-                        dummyPlayer.vel.normalize(len);
-                    } else {
-                        dummyPlayer.vel.reset();
-                    }
-                }
-                if (Collision::IsHit(targetLotus.region(), Circle(prevPos, Parameter::CharaRadius()), dummyPlayer.pos)) {
-                    // 目標の蓮を通過したら、次の蓮との判定を行う
-                    ++dummyPlayer.targetLotusNo;
-                    // 一周回ったら周回数加算
-                    if (_lotuses.count() == dummyPlayer.targetLotusNo) {
-                        dummyPlayer.targetLotusNo = 0;
-                        ++dummyPlayer.roundCount;
-                    }
-                }
-                // ゴールしてたら探索終了
-                if (dummyPlayer.roundCount == Parameter::StageRoundCount)
-                {
-                    if (wholeAccelCount >= requiredAccelCount && passedTurn < minPassedTurn) {
-                        // 最速だったら記録
-                        minPassedTurn = passedTurn;
-                        minSpeed = speed;
-                    }
-                    break;
-                }
-                if (passedTurn >= minPassedTurn) {
-                    // 経過ターン数が今までの最低値を上回ったらもうチェックする意味ないので省略
-                    break;
-                }
-                // プレイヤーの更新
-                dummyPlayer.passedTurn = passedTurn;
-                --dummyPlayer.accelWaitTurn;
-                if (dummyPlayer.accelWaitTurn <= 0) {
-                    dummyPlayer.accelCount = Math::Min(dummyPlayer.accelCount + 1, Parameter::CharaAccelCountMax);
-                    dummyPlayer.accelWaitTurn = Parameter::CharaAddAccelWaitTurn;
-                    ++wholeAccelCount;
-                }
-            }
+        float speeds[RolloutLaneCountMax];
+        int speedCount = 0;
+        for (float aps = 1.0; aps <= stopTime && speedCount < RolloutLaneCountMax; aps += 1.0) {
+            speeds[speedCount] = Parameter::CharaAccelSpeed() - ((aps - 1) * Parameter::CharaDecelSpeed());
+            ++speedCount;
+        }
+        // 全候補をまとめてめっちゃリアルっぽいシミュレーションする
+        // 経験上、2300ターンは超えない気がするから2300まで
+        RolloutLanes lanes;
+        setupRollout(lanes, player, speeds, speedCount);
+        int goalTurn = 0;
+        const int goalLane = runRollout(lanes, 2300, goalTurn);
+        if (goalLane >= 0 && goalTurn < Parameter::GameTurnPerStage) {
+            minSpeed = speeds[goalLane];
         }
         _minSpeed = minSpeed;
         
@@ -410,9 +820,66 @@ namespace hpc {
     {
         DummyPlayer dplayer = createDummyPlayer(aStageAccessor.player());
         const EnemyAccessor* enemies = &aStageAccessor.enemies();
-        return simulateGetNextAction(dplayer, _minSpeed, enemies);
+        const Action action = simulateGetNextAction(dplayer, _minSpeed, enemies, _lastTargetLotusNo);
+        // 予算の範囲で先読みして、行動を選び直す
+        if (!isEnemyNear(dplayer, *enemies)) {
+            return planNextAction(aStageAccessor.player(), action);
+        }
+        return action;
+    }
+    
+    //------------------------------------------------------------------------------
+    /// アクセルを踏まなかった場合に予想する、 aTurn ターン後の位置を返します。
+    ///
+    /// -st (ModelCheck) が、予想を1ターンずつ求めた位置と比べるために呼び出します。
+    ///
+    /// @param[in] aPos     現在の位置。
+    /// @param[in] aVel     現在の速度。
+    /// @param[in] aFlowVel 流れの速度。
+    /// @param[in] aTurn    ターン数。
+    ///
+    /// @return aTurn ターン後の位置。
+    Vec2 AnswerTrajectoryPos(const Vec2& aPos, const Vec2& aVel, const Vec2& aFlowVel, int aTurn)
+    {
+        return Trajectory(aPos, aVel, aFlowVel, aTurn).posAt(aTurn);
     }
     
+    //------------------------------------------------------------------------------
+    /// アクセルを踏まなかった場合に、 aMaxTurn ターン以内で初めて aRegion に触れると予想するターンを返します。
+    ///
+    /// -st (ModelCheck) が、予想を1ターンずつ IsHit で調べた結果と比べるために呼び出します。
+    ///
+    /// @param[in] aPos     現在の位置。
+    /// @param[in] aVel     現在の速度。
+    /// @param[in] aFlowVel 流れの速度。
+    /// @param[in] aRegion  調べる領域。
+    /// @param[in] aMaxTurn 調べるターン数。
+    ///
+    /// @return 触れるターン。触れなければ -1 。
+    int AnswerTrajectoryTurnInRegion(const Vec2& aPos, const Vec2& aVel, const Vec2& aFlowVel, const Circle& aRegion, int aMaxTurn)
+    {
+        return Trajectory(aPos, aVel, aFlowVel, aMaxTurn).firstTurnInRegion(aRegion, aMaxTurn);
+    }
+    
+    //------------------------------------------------------------------------------
+    /// アクセルを踏まなかった場合に、 aMaxTurn ターン以内のターンの終わりで初めて2人が重なると予想するターンを返します。
+    ///
+    /// -st (ModelCheck) が、予想を1ターンずつ IsHit で調べた結果と比べるために呼び出します。
+    ///
+    /// @param[in] aPos0    1人目の現在の位置。
+    /// @param[in] aVel0    1人目の現在の速度。
+    /// @param[in] aPos1    2人目の現在の位置。
+    /// @param[in] aVel1    2人目の現在の速度。
+    /// @param[in] aFlowVel 流れの速度。
+    /// @param[in] aMaxTurn 調べるターン数。
+    ///
+    /// @return 重なるターン。重ならなければ -1 。
+    int AnswerTrajectoryContactTurn(const Vec2& aPos0, const Vec2& aVel0, const Vec2& aPos1, const Vec2& aVel1, const Vec2& aFlowVel, int aMaxTurn)
+    {
+        const Trajectory trajectory0(aPos0, aVel0, aFlowVel, aMaxTurn);
+        const Trajectory trajectory1(aPos1, aVel1, aFlowVel, aMaxTurn);
+        return trajectory0.firstContactTurn(trajectory1, aMaxTurn);
+    }
 }
 
 //------------------------------------------------------------------------------
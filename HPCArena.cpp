@@ -0,0 +1,73 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    HPCArena.hpp の実装
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+
+#include "HPCArena.hpp"
+
+#include "HPCCommon.hpp"
+
+namespace hpc {
+
+    //------------------------------------------------------------------------------
+    /// クラスのインスタンスを生成します。
+    ///
+    /// @param[in] aBuffer      使用する領域。インスタンスより長く存在する必要があります。
+    /// @param[in] aCapacity    領域のバイト数。
+    Arena::Arena(unsigned char* aBuffer, int aCapacity)
+        : mBuffer(aBuffer)
+        , mCapacity(aCapacity)
+        , mUsedSize(0)
+    {
+        HPC_ASSERT(aBuffer != 0);
+        HPC_LB_ASSERT_I(aCapacity, 0);
+    }
+
+    //------------------------------------------------------------------------------
+    /// 領域を確保します。
+    ///
+    /// @param[in] aSize 確保するバイト数。
+    ///
+    /// @return 確保した領域の先頭。残りが足りない場合は 0 を返します。
+    unsigned char* Arena::allocate(int aSize)
+    {
+        HPC_LB_ASSERT_I(aSize, 0);
+        if (mCapacity - mUsedSize < aSize) {
+            return 0;
+        }
+        unsigned char* const result = mBuffer + mUsedSize;
+        mUsedSize += aSize;
+        return result;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 確保した領域をすべて解放します。
+    /// それまでに確保した領域を参照しているものがあれば、先に手放しておく必要があります。
+    void Arena::reset()
+    {
+        mUsedSize = 0;
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return 確保したバイト数。
+    int Arena::usedSize()const
+    {
+        return mUsedSize;
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return 領域のバイト数。
+    int Arena::capacity()const
+    {
+        return mCapacity;
+    }
+}
+
+//------------------------------------------------------------------------------
+// EOF
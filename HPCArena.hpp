@@ -0,0 +1,44 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    Arena クラス
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+#pragma once
+
+namespace hpc {
+
+    //------------------------------------------------------------------------------
+    /// あらかじめ用意した領域から、先頭から順にバイト列を確保します。
+    ///
+    /// new, delete を使うことは出来ないので、領域は static な変数として用意したものを渡します。
+    /// 確保した領域を個別に解放することはできず、 reset() でまとめて解放します。
+    /// 確保する領域はバイト単位で、アラインメントは考慮しません。
+    ///
+    /// @note 領域のうち、まだ確保していない部分には書き込まないので、
+    ///       ゼロで初期化された static な変数を渡せば、実際に使った分だけがメモリに載ります。
+    class Arena
+    {
+    public:
+        Arena(unsigned char* aBuffer, int aCapacity);
+
+        unsigned char* allocate(int aSize);     ///< 領域を確保します。
+        void reset();                           ///< 確保した領域をすべて解放します。
+        int usedSize()const;                   ///< 確保したバイト数を返します。
+        int capacity()const;                   ///< 領域のバイト数を返します。
+
+    private:
+        Arena(const Arena& aArena);             ///< コピーはできません。
+        Arena& operator=(const Arena& aArena);  ///< コピーはできません。
+
+        unsigned char* mBuffer;                 ///< 領域
+        int mCapacity;                          ///< 領域のバイト数
+        int mUsedSize;                          ///< 確保したバイト数
+    };
+}
+//------------------------------------------------------------------------------
+// EOF
@@ -0,0 +1,378 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    HPCBatchRunner.hpp の実装
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+
+#include "HPCBatchRunner.hpp"
+
+#include "HPCBatchStats.hpp"
+#include "HPCCommon.hpp"
+#include "HPCMath.hpp"
+#include "HPCParallelRunner.hpp"
+
+namespace {
+    using namespace hpc;
+
+    /// CSV 形式の項目名
+    const char CsvHeader[] = "seed,stage,score,turn,lotus,rank,failed,sec\n";
+
+    int sDerivedSeedIndex = -1;                             ///< ステージごとの乱数を導出したシードの番号
+
+    //------------------------------------------------------------------------------
+    /// BatchRunner::Run() から、分担の仕事に渡す情報です。
+    struct ShardJobContext
+    {
+        const SeedList* seeds;      ///< 実行するシードの一覧
+        int firstStage;             ///< 実行する最初のステージ番号
+        int lastStage;              ///< 実行する最後のステージ番号
+        BatchResultWriter* writer;  ///< 実行結果の書き出し先
+        BatchStats* stats;          ///< 実行結果の集計
+    };
+
+    //------------------------------------------------------------------------------
+    /// 分担1つ分の実行結果を、書き出し先と集計に加えます。
+    void CommitResults(const BatchResult* aResults, int aCount, BatchResultWriter& aWriter, BatchStats& aStats)
+    {
+        for (int index = 0; index < aCount; ++index) {
+            aWriter.write(aResults[index]);
+            aStats.add(aResults[index]);
+        }
+    }
+}
+
+namespace hpc {
+
+    const char BatchResultWriter::Magic[4] = { 'H', 'P', 'C', 'B' };
+
+    //------------------------------------------------------------------------------
+    /// クラスのインスタンスを生成します。
+    BatchResultWriter::BatchResultWriter()
+        : mFormat(BatchResultFormat_Csv)
+        , mFile(0)
+        , mIsStdout(false)
+        , mWriter()
+        , mCount(0)
+        , mIsValid(false)
+    {
+    }
+
+    //------------------------------------------------------------------------------
+    /// ファイルを開いていれば閉じます。
+    BatchResultWriter::~BatchResultWriter()
+    {
+        close();
+    }
+
+    //------------------------------------------------------------------------------
+    /// 書き出し用にファイルを開き、 CSV 形式の項目名、またはバイナリ形式のファイルヘッダを書き出します。
+    ///
+    /// @param[in] aFileName    書き出すファイル名。
+    /// @param[in] aFormat      書き出す形式。
+    ///
+    /// @return 開くことができたら @c true を返します。
+    bool BatchResultWriter::open(const char* aFileName, BatchResultFormat aFormat)
+    {
+        HPC_ASSERT(aFileName != 0);
+        HPC_ENUM_ASSERT(BatchResultFormat, aFormat);
+        close();
+        mFormat = aFormat;
+        mCount = 0;
+        if (mFormat == BatchResultFormat_Binary) {
+            mIsValid = mWriter.open(aFileName);
+            mWriter.writeBytes(Magic, sizeof(Magic));
+            mWriter.writeInt(Version);
+            mWriter.writeInt(0);    // 実行結果の数は、閉じるときに書き込む。
+            return mIsValid;
+        }
+        mFile = std::fopen(aFileName, "w");
+        mIsValid = (mFile != 0);
+        if (mIsValid) {
+            std::fprintf(mFile, "%s", CsvHeader);
+        }
+        return mIsValid;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 標準出力に CSV 形式で書き出すよう設定し、項目名を書き出します。
+    ///
+    /// @return 常に @c true を返します。
+    bool BatchResultWriter::openStdout()
+    {
+        close();
+        mFormat = BatchResultFormat_Csv;
+        mFile = stdout;
+        mIsStdout = true;
+        mCount = 0;
+        mIsValid = true;
+        std::fprintf(mFile, "%s", CsvHeader);
+        return mIsValid;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 書き出しを終えてファイルを閉じます。
+    /// バイナリ形式の場合は、ファイルヘッダに実行結果の数を書き込みます。
+    ///
+    /// @return すべての書き出しに成功していれば @c true を返します。
+    bool BatchResultWriter::close()
+    {
+        if (mFormat == BatchResultFormat_Binary) {
+            if (mWriter.isValid()) {
+                mWriter.overwriteInt(8, mCount);
+            }
+            mIsValid = mWriter.close() && mIsValid;
+        }
+        if (mFile != 0) {
+            if (mIsStdout) {
+                mIsValid = (std::fflush(mFile) == 0) && mIsValid;
+            } else {
+                mIsValid = (std::fclose(mFile) == 0) && mIsValid;
+            }
+            mFile = 0;
+            mIsStdout = false;
+        }
+        mFormat = BatchResultFormat_Csv;
+        return mIsValid;
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return ここまでの書き出しがすべて成功していれば @c true を返します。
+    bool BatchResultWriter::isValid()const
+    {
+        if (mFormat == BatchResultFormat_Binary) {
+            return mIsValid && mWriter.isValid();
+        }
+        return mIsValid && (mFile == 0 || !std::ferror(mFile));
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return open() してから書き出した実行結果の数。
+    int BatchResultWriter::count()const
+    {
+        return mCount;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 実行結果を1つ書き出します。
+    ///
+    /// @param[in] aResult 書き出す実行結果。
+    void BatchResultWriter::write(const BatchResult& aResult)
+    {
+        if (mFormat == BatchResultFormat_Binary) {
+            mWriter.writeInt(aResult.seedIndex);
+            mWriter.writeInt(aResult.stageIndex);
+            mWriter.writeDouble(aResult.score);
+            mWriter.writeInt(aResult.turn);
+            mWriter.writeInt(aResult.passedLotusCount);
+            mWriter.writeInt(aResult.rank);
+            mWriter.writeInt(aResult.isFailed ? 1 : 0);
+            mWriter.writeDouble(aResult.sec);
+        } else if (mFile != 0) {
+            std::fprintf(
+                mFile
+                , "%d,%d,%.6f,%d,%d,%d,%d,%.6f\n"
+                , aResult.seedIndex
+                , aResult.stageIndex
+                , aResult.score
+                , aResult.turn
+                , aResult.passedLotusCount
+                , aResult.rank
+                , aResult.isFailed ? 1 : 0
+                , aResult.sec
+                );
+        }
+        ++mCount;
+    }
+
+    //------------------------------------------------------------------------------
+    /// @param[in] aSeedCount   シードの数。
+    /// @param[in] aFirstStage  実行する最初のステージ番号。
+    /// @param[in] aLastStage   実行する最後のステージ番号。
+    ///
+    /// @return 分担の数。
+    int BatchRunner::ShardCount(int aSeedCount, int aFirstStage, int aLastStage)
+    {
+        const int stageCount = aLastStage - aFirstStage + 1;
+        return aSeedCount * ((stageCount + ShardStageCount - 1) / ShardStageCount);
+    }
+
+    //------------------------------------------------------------------------------
+    /// 分担1つ分のステージを、ステージ順に実行します。
+    ///
+    /// @param[in] aSeeds       実行するシードの一覧。
+    /// @param[in] aShardIndex  分担の番号。
+    /// @param[in] aFirstStage  実行する最初のステージ番号。
+    /// @param[in] aLastStage   実行する最後のステージ番号。
+    /// @param[in] aGameTimer   シードの制限時間を判定するタイマー。同じシードの分担で共有します。
+    /// @param[out] aResults    実行結果。 ShardStageCount 個の要素が必要です。
+    ///
+    /// @return 実行結果の数。
+    int BatchRunner::RunShard(
+        const SeedList& aSeeds
+        , int aShardIndex
+        , int aFirstStage
+        , int aLastStage
+        , const Timer& aGameTimer
+        , BatchResult* aResults
+        )
+    {
+        HPC_ASSERT(aResults != 0);
+        int seedIndex = 0;
+        int beginStage = 0;
+        int endStage = 0;
+        GetShardRange(aShardIndex, aFirstStage, aLastStage, seedIndex, beginStage, endStage);
+
+        // 同じシードの分担が続く場合は、導出したステージごとの乱数を使い回す。
+        if (seedIndex != sDerivedSeedIndex) {
+            RandomSet randSet(aSeeds.seed(seedIndex));
+            ParallelRunner::DeriveScratchRandoms(randSet);
+            sDerivedSeedIndex = seedIndex;
+        }
+
+        int count = 0;
+        for (int stageIndex = beginStage; stageIndex < endStage; ++stageIndex) {
+            const double beginSec = Timer::MonotonicSec();
+            const RecordStage& record = ParallelRunner::RunScratchStage(stageIndex, aGameTimer);
+
+            BatchResult& result = aResults[count];
+            result.seedIndex = seedIndex;
+            result.stageIndex = stageIndex;
+            result.score = record.score();
+            result.turn = record.turn();
+            result.passedLotusCount = record.passedLotusCount();
+            result.rank = record.rank();
+            result.isFailed = record.isFailed();
+            result.sec = Timer::MonotonicSec() - beginSec;
+            ++count;
+        }
+        return count;
+    }
+
+    //------------------------------------------------------------------------------
+    /// すべてのシードとステージの組を実行し、実行結果を書き出して集計します。
+    ///
+    /// 実行結果は、シード順・ステージ順に書き出します。
+    /// ワーカーが異常終了して失われた分担は、標準エラー出力に通知し、失敗した分担として集計します。
+    ///
+    /// @param[in] aWorkerCount ワーカー数。1 以下の場合は呼び出し元のプロセスで実行します。
+    /// @param[in] aSeeds       実行するシードの一覧。
+    /// @param[in] aFirstStage  実行する最初のステージ番号。
+    /// @param[in] aLastStage   実行する最後のステージ番号。このステージも実行します。
+    /// @param[in] aIsSweptCollision キャラ同士の衝突を連続判定するなら @c true 。ワーカーにも引き継がれます。
+    /// @param[out] aWriter     実行結果の書き出し先。
+    /// @param[out] aStats      実行結果の集計。実行前に初期化されます。
+    void BatchRunner::Run(
+        int aWorkerCount
+        , const SeedList& aSeeds
+        , int aFirstStage
+        , int aLastStage
+        , bool aIsSweptCollision
+        , BatchResultWriter& aWriter
+        , BatchStats& aStats
+        )
+    {
+        HPC_RANGE_ASSERT_MIN_UB_I(aFirstStage, 0, Parameter::GameStageCount);
+        HPC_RANGE_ASSERT_MIN_UB_I(aLastStage, aFirstStage, Parameter::GameStageCount);
+
+        ParallelRunner::SetSweptCollision(aIsSweptCollision);
+        aStats.reset(aSeeds.count(), aLastStage - aFirstStage + 1);
+        sDerivedSeedIndex = -1;
+
+        ShardJobContext context;
+        context.seeds = &aSeeds;
+        context.firstStage = aFirstStage;
+        context.lastStage = aLastStage;
+        context.writer = &aWriter;
+        context.stats = &aStats;
+
+        ParallelJobs jobs;
+        jobs.jobCount = ShardCount(aSeeds.count(), aFirstStage, aLastStage);
+        jobs.gameJobCount = ShardCount(1, aFirstStage, aLastStage);
+        jobs.resultSizeMax = sizeof(BatchResult) * ShardStageCount;
+        jobs.gameTimer = 0;
+        jobs.isRetried = false;
+        jobs.run = RunShardJob;
+        jobs.commit = CommitShardJob;
+        jobs.context = &context;
+        ParallelRunner::RunJobs(aWorkerCount, jobs);
+    }
+
+    //------------------------------------------------------------------------------
+    /// 分担に含まれるシードとステージの範囲を求めます。
+    ///
+    /// 分担はシード順に並び、同じシードの中ではステージ順に並びます。
+    ///
+    /// @param[in] aShardIndex  分担の番号。
+    /// @param[in] aFirstStage  実行する最初のステージ番号。
+    /// @param[in] aLastStage   実行する最後のステージ番号。
+    /// @param[out] aSeedIndex  シードの番号。
+    /// @param[out] aBeginStage 分担の最初のステージ番号。
+    /// @param[out] aEndStage   分担の最後のステージ番号の次の番号。
+    void BatchRunner::GetShardRange(
+        int aShardIndex
+        , int aFirstStage
+        , int aLastStage
+        , int& aSeedIndex
+        , int& aBeginStage
+        , int& aEndStage
+        )
+    {
+        HPC_LB_ASSERT_I(aShardIndex, -1);
+        const int shardCountPerSeed = ShardCount(1, aFirstStage, aLastStage);
+        aSeedIndex = aShardIndex / shardCountPerSeed;
+        aBeginStage = aFirstStage + (aShardIndex % shardCountPerSeed) * ShardStageCount;
+        aEndStage = Math::Min(aBeginStage + ShardStageCount, aLastStage + 1);
+    }
+
+    //------------------------------------------------------------------------------
+    /// ParallelRunner::RunJobs() の仕事として、分担1つ分のステージを実行します。
+    ///
+    /// @return 書き込んだ実行結果のバイト数。
+    int BatchRunner::RunShardJob(int aShardIndex, const Timer& aGameTimer, void* aResults, void* aContext)
+    {
+        const ShardJobContext& context = *static_cast<const ShardJobContext*>(aContext);
+        const int count = RunShard(
+            *context.seeds
+            , aShardIndex
+            , context.firstStage
+            , context.lastStage
+            , aGameTimer
+            , static_cast<BatchResult*>(aResults)
+            );
+        return count * static_cast<int>(sizeof(BatchResult));
+    }
+
+    //------------------------------------------------------------------------------
+    /// ParallelRunner::RunJobs() から、分担1つ分の実行結果を受け取り、書き出して集計します。
+    ///
+    /// 実行結果がない場合は、ワーカーが異常終了しているので、失敗した分担として集計します。
+    void BatchRunner::CommitShardJob(int aShardIndex, const void* aResults, int aResultSize, void* aContext)
+    {
+        ShardJobContext& context = *static_cast<ShardJobContext*>(aContext);
+        if (aResults != 0) {
+            const int count = aResultSize / static_cast<int>(sizeof(BatchResult));
+            CommitResults(static_cast<const BatchResult*>(aResults), count, *context.writer, *context.stats);
+            return;
+        }
+        int seedIndex = 0;
+        int beginStage = 0;
+        int endStage = 0;
+        GetShardRange(aShardIndex, context.firstStage, context.lastStage, seedIndex, beginStage, endStage);
+        std::fprintf(
+            stderr
+            , "[Batch] Worker stopped on seed %d, stage %d-%d.\n"
+            , seedIndex
+            , beginStage
+            , endStage - 1
+            );
+        context.stats->addFailedShard();
+    }
+}
+
+//------------------------------------------------------------------------------
+// EOF
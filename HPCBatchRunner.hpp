@@ -0,0 +1,153 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    BatchResultWriter, BatchRunner クラス
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+#pragma once
+
+#include <cstdio>
+#include "HPCReplay.hpp"
+#include "HPCSeedList.hpp"
+#include "HPCTimer.hpp"
+
+namespace hpc {
+
+    class BatchStats;
+
+    //------------------------------------------------------------------------------
+    /// シードとステージの組1つ分の実行結果を表します。
+    struct BatchResult
+    {
+        int seedIndex;          ///< SeedList でのシードの番号
+        int stageIndex;         ///< ステージ番号
+        double score;           ///< ステージの得点
+        int turn;               ///< 終了時のターン番号
+        int passedLotusCount;   ///< プレイヤーが通過した蓮の数
+        int rank;               ///< プレイヤーの順位。 1 位を 0 とします。
+        bool isFailed;          ///< 失敗した、またはターン数の上限に達したか
+        double sec;             ///< ステージの実行にかかった実時間
+    };
+
+    //------------------------------------------------------------------------------
+    /// 実行結果を書き出す形式を表します。
+    ///
+    /// CSV 形式は、1行目が項目名で、以降は1行に1つの実行結果です。
+    ///
+    /// @code
+    /// seed,stage,score,turn,lotus,rank,failed,sec
+    /// 0,0,12.345678,301,9,0,0,0.001234
+    /// @endcode
+    ///
+    /// バイナリ形式の値は、リプレイファイルと同じく 4 バイトのリトルエンディアンで格納されます。
+    /// 得点と実行時間は 8 バイトの倍精度の浮動小数です。
+    ///
+    ///   項目                  | 内容
+    ///  -----------------------|----------------------------------------------
+    ///   ファイルヘッダ        | マジック "HPCB", バージョン, 実行結果の数
+    ///   実行結果 × 結果の数   | シード番号, ステージ番号, 得点, ターン番号, 通過した蓮の数, 順位, 失敗したか, 実行時間
+    ///
+    /// バイナリ形式のバージョン 2 で、8 バイトの倍精度の浮動小数の実行時間 [秒] を加えました。
+    enum BatchResultFormat
+    {
+        BatchResultFormat_Csv,          ///< CSV 形式
+        BatchResultFormat_Binary,       ///< バイナリ形式
+
+        BatchResultFormat_TERM
+    };
+
+    //------------------------------------------------------------------------------
+    /// 実行結果を、1つずつファイルに書き出します。
+    class BatchResultWriter
+    {
+    public:
+        static const int Version = 2;           ///< バイナリ形式のバージョン
+        static const char Magic[4];             ///< バイナリ形式のファイル先頭のマジック
+        static const int HeaderSize = 12;       ///< バイナリ形式のファイルヘッダのバイト数
+        static const int ResultSize = 40;       ///< バイナリ形式の、実行結果1つ分のバイト数
+
+        BatchResultWriter();
+        ~BatchResultWriter();
+
+        bool open(const char* aFileName, BatchResultFormat aFormat); ///< ファイルを開きます。
+        bool openStdout();                      ///< 標準出力に CSV 形式で書き出すよう設定します。
+        bool close();                           ///< ファイルを閉じます。
+        bool isValid()const;                   ///< ここまでの書き出しが成功しているかを返します。
+        int count()const;                      ///< 書き出した実行結果の数を返します。
+        void write(const BatchResult& aResult); ///< 実行結果を1つ書き出します。
+
+    private:
+        BatchResultWriter(const BatchResultWriter& aWriter);            ///< コピーはできません。
+        BatchResultWriter& operator=(const BatchResultWriter& aWriter); ///< コピーはできません。
+
+        BatchResultFormat mFormat;              ///< 書き出す形式
+        std::FILE* mFile;                       ///< CSV 形式の出力先
+        bool mIsStdout;                         ///< 出力先が標準出力か
+        ReplayWriter mWriter;                   ///< バイナリ形式の出力先
+        int mCount;                             ///< 書き出した実行結果の数
+        bool mIsValid;                          ///< 書き出しが成功しているか
+    };
+
+    //------------------------------------------------------------------------------
+    /// 複数のシードについて、指定した範囲のステージを実行します。
+    ///
+    /// シード1つの、連続した最大 ShardStageCount 個のステージを1つの分担として実行します。
+    /// 各ステージは、 ParallelRunner と同じくシードから導出したステージごとの乱数で実行されるため、
+    /// シードを1つだけ指定し、全ステージを実行した場合の結果は、 -w を指定した実行と一致します。
+    /// 制限時間は、シードごとに Parameter::GameTimeLimitSec を与え、そのシードのすべての分担で共有します。
+    ///
+    /// 分担は ParallelRunner::RunJobs() の仕事として、ワーカーで分け合って実行します。
+    /// 実行結果は分担ごとにまとめて受け取るので、ワーカーが HPC_ASSERT などで異常終了しても、
+    /// 失われるのはそのワーカーが実行中だった分担だけです。残りの分担は、ほかのワーカーが実行を続けます。
+    /// 実行結果は、ワーカー数によらずシード順・ステージ順に書き出します。
+    class BatchRunner
+    {
+    public:
+        static const int ShardStageCount = 10;      ///< 1つの分担に含めるステージ数の最大値
+
+        /// 分担の数を返します。
+        static int ShardCount(int aSeedCount, int aFirstStage, int aLastStage);
+        /// 分担1つ分のステージを実行します。
+        static int RunShard(
+            const SeedList& aSeeds
+            , int aShardIndex
+            , int aFirstStage
+            , int aLastStage
+            , const Timer& aGameTimer
+            , BatchResult* aResults
+            );
+        /// すべてのシードとステージの組を実行し、実行結果を書き出します。
+        static void Run(
+            int aWorkerCount
+            , const SeedList& aSeeds
+            , int aFirstStage
+            , int aLastStage
+            , bool aIsSweptCollision
+            , BatchResultWriter& aWriter
+            , BatchStats& aStats
+            );
+
+    private:
+        /// 分担に含まれるシードとステージの範囲を求めます。
+        static void GetShardRange(
+            int aShardIndex
+            , int aFirstStage
+            , int aLastStage
+            , int& aSeedIndex
+            , int& aBeginStage
+            , int& aEndStage
+            );
+        /// ParallelRunner::RunJobs() の仕事として、分担1つ分のステージを実行します。
+        static int RunShardJob(int aShardIndex, const Timer& aGameTimer, void* aResults, void* aContext);
+        /// ParallelRunner::RunJobs() から、分担1つ分の実行結果を受け取ります。
+        static void CommitShardJob(int aShardIndex, const void* aResults, int aResultSize, void* aContext);
+
+        BatchRunner();
+    };
+}
+//------------------------------------------------------------------------------
+// EOF
@@ -0,0 +1,186 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    HPCBatchStats.hpp の実装
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+
+#include "HPCBatchStats.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include "HPCCommon.hpp"
+
+namespace {
+
+    /// 表に出力するパーセンタイル
+    const int Percentiles[] = { 5, 25, 50, 75, 95 };
+
+    //------------------------------------------------------------------------------
+    /// 並べ替えた値の並びから、最近接順位法でパーセンタイルを求めます。
+    ///
+    /// @param[in] aValues      昇順に並べ替えた値。
+    /// @param[in] aCount       値の数。 1 以上。
+    /// @param[in] aPercentile  求めるパーセンタイル。
+    ///
+    /// @return 値のうち、 aPercentile % 以上がそれ以下になる最小の値。
+    float Percentile(const float* aValues, int aCount, int aPercentile)
+    {
+        int rank = (aCount * aPercentile + 99) / 100;
+        if (rank < 1) {
+            rank = 1;
+        }
+        return aValues[rank - 1];
+    }
+}
+
+namespace hpc {
+
+    //------------------------------------------------------------------------------
+    /// 空の集計を生成します。
+    BatchStats::BatchStats()
+        : mCount(0)
+        , mSeedCount(0)
+        , mStageCountPerSeed(0)
+        , mFailedShardCount(0)
+    {
+    }
+
+    //------------------------------------------------------------------------------
+    /// 集計を初期化します。
+    ///
+    /// @param[in] aSeedCount           実行するシードの数。
+    /// @param[in] aStageCountPerSeed   シードごとに実行するステージ数。
+    void BatchStats::reset(int aSeedCount, int aStageCountPerSeed)
+    {
+        HPC_RANGE_ASSERT_MIN_UB_I(aSeedCount, 0, SeedList::SeedCountMax + 1);
+        HPC_RANGE_ASSERT_MIN_UB_I(aStageCountPerSeed, 1, Parameter::GameStageCount + 1);
+        mCount = 0;
+        mSeedCount = aSeedCount;
+        mStageCountPerSeed = aStageCountPerSeed;
+        mFailedShardCount = 0;
+        for (int index = 0; index < mSeedCount; ++index) {
+            mSeedScores[index] = 0.0;
+            mSeedStageCounts[index] = 0;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// 実行結果を1つ加えます。
+    ///
+    /// @param[in] aResult 加える実行結果。
+    void BatchStats::add(const BatchResult& aResult)
+    {
+        HPC_RANGE_ASSERT_MIN_UB_I(aResult.seedIndex, 0, mSeedCount);
+        if (mCount >= ResultCountMax) {
+            return;
+        }
+        mStageScores[mCount] = static_cast<float>(aResult.score);
+        mStageSecs[mCount] = static_cast<float>(aResult.sec);
+        ++mCount;
+        mSeedScores[aResult.seedIndex] += aResult.score;
+        ++mSeedStageCounts[aResult.seedIndex];
+    }
+
+    //------------------------------------------------------------------------------
+    /// ワーカーの異常終了などで、実行できなかった分担を1つ数えます。
+    void BatchStats::addFailedShard()
+    {
+        ++mFailedShardCount;
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return 加えた実行結果の数。
+    int BatchStats::count()const
+    {
+        return mCount;
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return 実行できなかった分担の数。
+    int BatchStats::failedShardCount()const
+    {
+        return mFailedShardCount;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 集計を表にして出力します。
+    ///
+    /// 実行結果の CSV と混ざらないよう、標準エラー出力に出力します。
+    /// シードごとの合計得点は、 Record::score() と同じく整数に丸めた値です。
+    ///
+    /// @note パーセンタイルを求めるため、保持している値を並べ替えます。
+    void BatchStats::print()
+    {
+        int seedTotalCount = 0;
+        for (int index = 0; index < mSeedCount; ++index) {
+            if (mSeedStageCounts[index] == mStageCountPerSeed) {
+                mSeedTotals[seedTotalCount] = static_cast<float>(static_cast<int>(mSeedScores[index]));
+                ++seedTotalCount;
+            }
+        }
+
+        std::fprintf(
+            stderr
+            , "[Batch] Stages: %d, Seeds: %d/%d, Failed shards: %d\n"
+            , mCount
+            , seedTotalCount
+            , mSeedCount
+            , mFailedShardCount
+            );
+        std::fprintf(stderr, "%-14s %8s %12s %12s %12s", "Item", "Count", "Mean", "StdDev", "Min");
+        for (int index = 0; index < HPC_ARRAY_NUM(Percentiles); ++index) {
+            char label[8];
+            std::sprintf(label, "P%d", Percentiles[index]);
+            std::fprintf(stderr, " %12s", label);
+        }
+        std::fprintf(stderr, " %12s\n", "Max");
+        PrintRow("StageScore", mStageScores, mCount, 1.0);
+        PrintRow("GameScore", mSeedTotals, seedTotalCount, 1.0);
+        PrintRow("StageTime[ms]", mStageSecs, mCount, 1000.0);
+    }
+
+    //------------------------------------------------------------------------------
+    /// 値の並びの件数・平均・標準偏差・最小値・パーセンタイル・最大値を1行出力します。
+    ///
+    /// @param[in] aName        項目名。
+    /// @param[in,out] aValues  値の並び。昇順に並べ替えられます。
+    /// @param[in] aCount       値の数。
+    /// @param[in] aScale       出力時に値に掛ける倍率。
+    void BatchStats::PrintRow(const char* aName, float* aValues, int aCount, double aScale)
+    {
+        std::fprintf(stderr, "%-14s %8d", aName, aCount);
+        if (aCount == 0) {
+            std::fprintf(stderr, "\n");
+            return;
+        }
+
+        double sum = 0.0;
+        for (int index = 0; index < aCount; ++index) {
+            sum += aValues[index];
+        }
+        const double mean = sum / aCount;
+        double squareSum = 0.0;
+        for (int index = 0; index < aCount; ++index) {
+            const double diff = aValues[index] - mean;
+            squareSum += diff * diff;
+        }
+        // 標本の標準偏差ではなく、不偏分散の平方根を求める。
+        const double stdDev = aCount > 1 ? std::sqrt(squareSum / (aCount - 1)) : 0.0;
+
+        std::sort(aValues, aValues + aCount);
+        std::fprintf(stderr, " %12.3f %12.3f %12.3f", mean * aScale, stdDev * aScale, aValues[0] * aScale);
+        for (int index = 0; index < HPC_ARRAY_NUM(Percentiles); ++index) {
+            std::fprintf(stderr, " %12.3f", Percentile(aValues, aCount, Percentiles[index]) * aScale);
+        }
+        std::fprintf(stderr, " %12.3f\n", aValues[aCount - 1] * aScale);
+    }
+}
+
+//------------------------------------------------------------------------------
+// EOF
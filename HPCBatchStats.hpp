@@ -0,0 +1,60 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    BatchStats クラス
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "HPCBatchRunner.hpp"
+#include "HPCParameter.hpp"
+#include "HPCSeedList.hpp"
+
+namespace hpc {
+
+    //------------------------------------------------------------------------------
+    /// BatchRunner の実行結果を集計します。
+    ///
+    /// ステージごとの得点と実行時間、シードごとの合計得点について、
+    /// 平均・標準偏差・パーセンタイルを求めます。
+    /// シードごとの合計得点は、範囲内のすべてのステージの結果がそろったシードのみを集計します。
+    ///
+    /// @note パーセンタイルを求めるため、値をすべて保持します。
+    ///       new, delete を使うことは出来ないので、保持できる最大数の領域を持ちます。
+    ///       このクラスのインスタンスは static な変数として用意してください。
+    class BatchStats
+    {
+    public:
+        /// 保持できるステージの実行結果の数の最大値
+        static const int ResultCountMax = SeedList::SeedCountMax * Parameter::GameStageCount;
+
+        BatchStats();
+
+        void reset(int aSeedCount, int aStageCountPerSeed); ///< 集計を初期化します。
+        void add(const BatchResult& aResult);       ///< 実行結果を1つ加えます。
+        void addFailedShard();                      ///< 実行できなかった分担を1つ数えます。
+        int count()const;                          ///< 加えた実行結果の数を返します。
+        int failedShardCount()const;               ///< 実行できなかった分担の数を返します。
+        void print();                               ///< 集計を表にして出力します。
+
+    private:
+        /// 値の並びの集計を1行出力します。並びは並べ替えられます。
+        static void PrintRow(const char* aName, float* aValues, int aCount, double aScale);
+
+        float mStageScores[ResultCountMax];         ///< ステージごとの得点
+        float mStageSecs[ResultCountMax];           ///< ステージごとの実行時間
+        int mCount;                                 ///< 加えた実行結果の数
+        double mSeedScores[SeedList::SeedCountMax]; ///< シードごとの合計得点
+        int mSeedStageCounts[SeedList::SeedCountMax]; ///< シードごとの、加えた実行結果の数
+        float mSeedTotals[SeedList::SeedCountMax];  ///< 集計に使う、結果がそろったシードの合計得点
+        int mSeedCount;                             ///< シードの数
+        int mStageCountPerSeed;                     ///< シードごとに実行するステージ数
+        int mFailedShardCount;                      ///< 実行できなかった分担の数
+    };
+}
+//------------------------------------------------------------------------------
+// EOF
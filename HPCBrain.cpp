@@ -16,6 +16,7 @@
 #include "HPCCommon.hpp"
 #include "HPCMath.hpp"
 #include "HPCParameter.hpp"
+#include "HPCProfiler.hpp"
 #include "HPCRandom.hpp"
 #include "HPCStageAccessor.hpp"
 
@@ -52,6 +53,13 @@ namespace hpc {
         mCharaParam = aCharaParam;
     }
     
+    //------------------------------------------------------------------------------
+    /// @return setup() で設定したキャラのパラメータ。
+    const CharaParam& Brain::charaParam()const
+    {
+        return mCharaParam;
+    }
+    
     //------------------------------------------------------------------------------
     /// ステージ開始前の準備処理を行います。
     ///
@@ -63,7 +71,10 @@ namespace hpc {
         case CharaType_Human:
             // Answer::Init でプレイヤーの初期状態を参照できるようにします。
             // 但し、Init でステージの状態を書き換えることはできません。
-            Answer::Init(aStageAccessor);
+            {
+                ProfileSample sample(ProfileScope_AnswerInit);
+                Answer::Init(aStageAccessor);
+            }
             break;
 
         case CharaType_Cpu:
@@ -90,7 +101,10 @@ namespace hpc {
     {
         switch (mCharaParam.type()) {
         case CharaType_Human:
-            return Answer::GetNextAction(aStageAccessor);
+            {
+                ProfileSample sample(ProfileScope_AnswerAction);
+                return Answer::GetNextAction(aStageAccessor);
+            }
 
         case CharaType_Cpu:
             return getCpuNextAction(aStageAccessor, aRandom);
@@ -102,6 +116,24 @@ namespace hpc {
         return Action();
     }
     
+    //------------------------------------------------------------------------------
+    /// @return 加速を節約して待機したターン数。CPU 以外では常に 0 です。
+    int Brain::cpuSaveAccelTurn()const
+    {
+        return mCpuSaveAccelTurn;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 加速を節約して待機したターン数を設定します。
+    ///
+    /// スナップショットから状態を戻すときに使用します。
+    ///
+    /// @param[in] aTurn cpuSaveAccelTurn() で取得した値。
+    void Brain::setCpuSaveAccelTurn(int aTurn)
+    {
+        mCpuSaveAccelTurn = aTurn;
+    }
+    
     //------------------------------------------------------------------------------
     /// CPUがステージ開始前の準備処理を行います。
     ///
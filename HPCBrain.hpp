@@ -27,8 +27,11 @@ namespace hpc {
 
         void reset();                                       ///< リセットします。
         void setup(const CharaParam& aCharaParam);          ///< 初期状態を設定します。
+        const CharaParam& charaParam()const;               ///< キャラのパラメータを返します。
         
         void init(const StageAccessor& aStageAccessor);     ///< 準備処理を行います。
+        int cpuSaveAccelTurn()const;                       ///< 加速を節約して待機したターン数を返します。(CPU)
+        void setCpuSaveAccelTurn(int aTurn);                ///< 加速を節約して待機したターン数を設定します。(CPU)
         /// 次の動作を返します。
         Action getNextAction(
             const StageAccessor& aStageAccessor
@@ -23,10 +23,9 @@ namespace hpc {
     Chara::Chara()
         : mStageAccessor()
         , mBrain()
-        , mRegion(Vec2(), Parameter::CharaRadius())
-        , mPrevRegion(Vec2(), Parameter::CharaRadius())
+        , mPhysics(0)
+        , mIndex(0)
         , mDecidedAction()
-        , mVel()
         , mAccelCount(0)
         , mAccelWaitTurn(0)
         , mAccelWaitTurnMax(0)
@@ -38,6 +37,20 @@ namespace hpc {
         reset();
     }
 
+    //------------------------------------------------------------------------------
+    /// 位置と速度の格納先を設定します。
+    ///
+    /// CharaCollection が、キャラを使う前に一度だけ呼びます。
+    ///
+    /// @param[in] aPhysics 全キャラの位置と速度を持つ CharaPhysics 。
+    /// @param[in] aIndex   aPhysics の中での、このキャラの番号。
+    void Chara::bindPhysics(CharaPhysics& aPhysics, int aIndex)
+    {
+        HPC_RANGE_ASSERT_MIN_UB_I(aIndex, 0, Parameter::CharaCapacity);
+        mPhysics = &aPhysics;
+        mIndex = aIndex;
+    }
+
     //------------------------------------------------------------------------------
     /// ステージ開始前の準備処理を行います。
     ///
@@ -53,7 +66,8 @@ namespace hpc {
     void Chara::decideAction(Random& aRandom)
     {
         // 衝突判定用に、前回領域を覚えておく
-        mPrevRegion = mRegion;
+        mPhysics->prevPosX[mIndex] = mPhysics->posX[mIndex];
+        mPhysics->prevPosY[mIndex] = mPhysics->posY[mIndex];
         
         mDecidedAction = mBrain.getNextAction(mStageAccessor, aRandom);
     }
@@ -81,34 +95,6 @@ namespace hpc {
         mDecidedAction.reset();
     }
 
-    //------------------------------------------------------------------------------
-    /// 移動処理を行います。
-    void Chara::move()
-    {
-        // 速度分移動 ＆ フィールドの流れる速度を反映
-        mRegion.move(mVel + mStageAccessor.field().flowVel());
-        
-        // 減速させる
-        if (!mVel.isZero()) {
-            const float len = Math::Max(
-                mVel.length() - Parameter::CharaDecelSpeed()
-                , 0.0f
-                );
-            if (0.0f < len) {
-                mVel.normalize(len);
-            } else {
-                mVel.reset();
-            }
-        }
-    }
-
-    //------------------------------------------------------------------------------
-    /// めり込み補正を行います。
-    void Chara::separation(const Vec2& aSeparateVec)
-    {
-        mRegion.move(aSeparateVec);
-    }
-
     //------------------------------------------------------------------------------
     /// ターン経過処理を行います。
     void Chara::updateTurn()
@@ -123,46 +109,21 @@ namespace hpc {
         }
     }
 
-    //------------------------------------------------------------------------------
-    /// フィールドの内側に補正します。
-    /// フィールド外に出ていた場合、座標補正と同時に速度がゼロになります。
-    void Chara::correctInside()
-    {
-        const Rectangle fieldRect = mStageAccessor.field().rect();
-        
-        Vec2 myPos = mRegion.pos();
-        const float radius = mRegion.radius();
-        bool isCorrect = false;
-        
-        if (myPos.x - radius < fieldRect.left) {
-            myPos.x = fieldRect.left + radius;
-            isCorrect = true;
-        } else if (fieldRect.right < myPos.x + radius) {
-            myPos.x = fieldRect.right - radius;
-            isCorrect = true;
-        }
-        if (myPos.y - radius < fieldRect.bottom) {
-            myPos.y = fieldRect.bottom + radius;
-            isCorrect = true;
-        } else if (fieldRect.top < myPos.y + radius) {
-            myPos.y = fieldRect.top - radius;
-            isCorrect = true;
-        }
-        
-        if (isCorrect) {
-            mRegion.setPos(myPos);
-            mVel.reset();
-        }
-    }
-
     //------------------------------------------------------------------------------
     /// 状態をリセットします。
+    ///
+    /// 位置と速度の格納先が設定されていれば、位置と速度もゼロにします。
     void Chara::reset()
     {
-        mRegion.setPos(hpc::Vec2());
-        mPrevRegion.setPos(hpc::Vec2());
+        if (mPhysics != 0) {
+            mPhysics->posX[mIndex] = 0.0f;
+            mPhysics->posY[mIndex] = 0.0f;
+            mPhysics->prevPosX[mIndex] = 0.0f;
+            mPhysics->prevPosY[mIndex] = 0.0f;
+            mPhysics->velX[mIndex] = 0.0f;
+            mPhysics->velY[mIndex] = 0.0f;
+        }
         mBrain.reset();
-        mVel.reset();
         mAccelCount = Parameter::CharaInitAccelCount;
         mAccelWaitTurn = Parameter::CharaAddAccelWaitTurn;
         mAccelWaitTurnMax = Parameter::CharaAddAccelWaitTurn;
@@ -179,8 +140,10 @@ namespace hpc {
     /// @param[in] aCharaType キャラのパラメータ
     void Chara::setup(const Vec2& aPos, const CharaParam& aCharaParam)
     {
-        mRegion.setPos(aPos);
-        mPrevRegion.setPos(aPos);
+        mPhysics->posX[mIndex] = aPos.x;
+        mPhysics->posY[mIndex] = aPos.y;
+        mPhysics->prevPosX[mIndex] = aPos.x;
+        mPhysics->prevPosY[mIndex] = aPos.y;
         mBrain.setup(aCharaParam);
         
         // パラメータ設定
@@ -208,7 +171,8 @@ namespace hpc {
     /// @param[in] aVel       速度
     void Chara::setVel(const Vec2& aVel)
     {
-        mVel = aVel;
+        mPhysics->velX[mIndex] = aVel.x;
+        mPhysics->velY[mIndex] = aVel.y;
     }
 
     //------------------------------------------------------------------------------
@@ -220,27 +184,60 @@ namespace hpc {
         mRank = aRank;
     }
 
+    //------------------------------------------------------------------------------
+    /// ターンごとに変わる状態を取得します。
+    ///
+    /// @param[out] aState 状態の書き込み先。
+    void Chara::saveState(CharaState& aState)const
+    {
+        aState.accelCount = mAccelCount;
+        aState.accelWaitTurn = mAccelWaitTurn;
+        aState.targetLotusNo = mTargetLotusNo;
+        aState.roundCount = mRoundCount;
+        aState.rank = mRank;
+        aState.passedTurn = mPassedTurn;
+        aState.cpuSaveAccelTurn = mBrain.cpuSaveAccelTurn();
+    }
+
+    //------------------------------------------------------------------------------
+    /// ターンごとに変わる状態を戻します。
+    ///
+    /// ターンの合間に呼んでください。決定済みの動作は持ち越しません。
+    ///
+    /// @param[in] aState saveState() で取得した状態。
+    void Chara::restoreState(const CharaState& aState)
+    {
+        mAccelCount = aState.accelCount;
+        mAccelWaitTurn = aState.accelWaitTurn;
+        mTargetLotusNo = aState.targetLotusNo;
+        mRoundCount = aState.roundCount;
+        mRank = aState.rank;
+        mPassedTurn = aState.passedTurn;
+        mBrain.setCpuSaveAccelTurn(aState.cpuSaveAccelTurn);
+        mDecidedAction.reset();
+    }
+
     //------------------------------------------------------------------------------
     /// キャラの領域を表す円を返します。
     ///
     /// @return キャラの領域を表す Circle
-    const Circle& Chara::region()const
+    Circle Chara::region()const
     {
-        return mRegion;
+        return Circle(pos(), Parameter::CharaRadius());
     }
 
     //------------------------------------------------------------------------------
     /// @return キャラの現在位置
     Vec2 Chara::pos()const
     {
-        return mRegion.pos();
+        return Vec2(mPhysics->posX[mIndex], mPhysics->posY[mIndex]);
     }
 
     //------------------------------------------------------------------------------
     /// @return キャラの現在速度
     Vec2 Chara::vel()const
     {
-        return mVel;
+        return Vec2(mPhysics->velX[mIndex], mPhysics->velY[mIndex]);
     }
 
     //------------------------------------------------------------------------------
@@ -299,13 +296,20 @@ namespace hpc {
         return mPassedTurn;
     }
 
+    //------------------------------------------------------------------------------
+    /// @return setup() で設定したキャラのパラメータ
+    const CharaParam& Chara::charaParam()const
+    {
+        return mBrain.charaParam();
+    }
+
     //------------------------------------------------------------------------------
     /// キャラの前回領域を表す円を返します。
     ///
     /// @return キャラの領域を表す Circle
-    const Circle& Chara::prevRegion()const
+    Circle Chara::prevRegion()const
     {
-        return mPrevRegion;
+        return Circle(Vec2(mPhysics->prevPosX[mIndex], mPhysics->prevPosY[mIndex]), Parameter::CharaRadius());
     }
 
     //------------------------------------------------------------------------------
@@ -327,7 +331,7 @@ namespace hpc {
         --mAccelCount;
         
         // 目標座標方向への一定加速度を設定する（加算ではなく、上書き）
-        mVel = toTargetVec.getNormalized(Parameter::CharaAccelSpeed());
+        setVel(toTargetVec.getNormalized(Parameter::CharaAccelSpeed()));
     }
 }
 //------------------------------------------------------------------------------
@@ -12,6 +12,7 @@
 
 #include "HPCAction.hpp"
 #include "HPCBrain.hpp"
+#include "HPCCharaPhysics.hpp"
 #include "HPCCircle.hpp"
 #include "HPCStageAccessor.hpp"
 
@@ -20,28 +21,49 @@ namespace hpc {
     class CharaParam;
     class Random;
     
+    //------------------------------------------------------------------------------
+    /// キャラの状態のうち、ターンごとに変わるものをまとめた POD です。
+    ///
+    /// Chara::saveState() で取得し、 Chara::restoreState() で戻します。
+    /// 位置と速度は CharaPhysics にまとめて持つので含みません。
+    /// ステージの設定（キャラのパラメータや、ステージへの参照）も含みません。
+    struct CharaState
+    {
+        int accelCount;         ///< 加速できる回数
+        int accelWaitTurn;      ///< 加速回数が増えるまでの残りターン数
+        int targetLotusNo;      ///< 現在の目指す蓮番号
+        int roundCount;         ///< 周回数
+        int rank;               ///< 順位
+        int passedTurn;         ///< 経過ターン数
+        int cpuSaveAccelTurn;   ///< 加速を節約して待機したターン数(CPU)
+    };
+    
     //------------------------------------------------------------------------------
     /// キャラの情報を保持します。
+    ///
+    /// 位置と速度は CharaCollection が持つ CharaPhysics にあり、
+    /// このクラスはその中の自分の要素を参照します。
+    /// 移動・衝突・フィールド内への補正は、 CharaCollection が全キャラ分まとめて行います。
     class Chara
     {
     public:
         Chara();
 
+        void bindPhysics(CharaPhysics& aPhysics, int aIndex); ///< 位置と速度の格納先を設定します。
         void init(const Stage& aStage, int aCharaIndex);    ///< 準備処理を行います。
         void decideAction(Random& aRandom);                 ///< 動作を決定します。
         void execAction();                                  ///< 動作を実行します。
-        void move();                                        ///< 移動処理を行います。
-        void separation(const Vec2& aSeparateVec);          ///< めり込み補正を行います。
         void updateTurn();                                  ///< ターン経過処理を行います。
-        void correctInside();                               ///< フィールドの内側に補正します。
         
         void reset();                                       ///< 状態をリセットします。
         void setup(const Vec2& aPos, const CharaParam& aCharaParam); ///< 初期設定を行います。
         void incTargetLotusNo();                            ///< 次に目指す蓮の番号を１つ進めます。
         void setVel(const Vec2& aVel);                      ///< 速度を設定します。
         void setRank(int aRank);                            ///< 順位を設定します。
+        void saveState(CharaState& aState)const;           ///< ターンごとに変わる状態を取得します。
+        void restoreState(const CharaState& aState);        ///< ターンごとに変わる状態を戻します。
 
-        const Circle& region()const;                        ///< 領域を表す円を返します。
+        Circle region()const;                               ///< 領域を表す円を返します。
         Vec2 pos()const;                                    ///< 現在位置を返します。
         Vec2 vel()const;                                    ///< 現在速度を返します。
         bool isGoal()const;                                 ///< ゴールしたかどうかを返します。
@@ -52,16 +74,16 @@ namespace hpc {
         int rank()const;                                    ///< 順位を返します。
         int passedLotusCount()const;                        ///< 通過した蓮の数を返します。
         int passedTurn()const;                              ///< 経過ターン数を返します。
+        const CharaParam& charaParam()const;               ///< キャラのパラメータを返します。
         
-        const Circle& prevRegion()const;                    ///< 前回領域を表す円を返します。
+        Circle prevRegion()const;                           ///< 前回領域を表す円を返します。
 
     private:
         StageAccessor mStageAccessor;   ///< ステージ情報のアクセサ
         Brain mBrain;                   ///< 動作決定モジュール
-        Circle mRegion;                 ///< 領域
-        Circle mPrevRegion;             ///< 前回領域
+        CharaPhysics* mPhysics;         ///< 位置と速度の格納先
+        int mIndex;                     ///< 格納先での番号
         Action mDecidedAction;          ///< 決定された動作
-        Vec2 mVel;                      ///< 速度
         int mAccelCount;                ///< 加速できる回数
         int mAccelWaitTurn;             ///< 加速回数が増えるまでの残りターン数
         int mAccelWaitTurnMax;          ///< 加速回数が増えるまでの残りターン数 の設定値
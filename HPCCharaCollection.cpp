@@ -11,8 +11,10 @@
 
 #include "HPCCharaCollection.hpp"
 
+#include <algorithm>
 #include "HPCCollision.hpp"
 #include "HPCCommon.hpp"
+#include "HPCMath.hpp"
 #include "HPCStage.hpp"
 
 namespace {
@@ -20,14 +22,15 @@ namespace {
     
     //------------------------------------------------------------------------------
     /// 速度ベクトル計算用構造体
+    // 速度は加えた順に足していくので、すべて覚えてから足した場合と結果は変わらない
     struct CalcVelSet
     {
-        Vec2 vels[Parameter::CharaCountMax];
+        Vec2 totalVel;
         Vec2 ofsSeparateVec;
         int count;
 
         CalcVelSet()
-            : vels()
+            : totalVel()
             , ofsSeparateVec()
             , count(0)
         {
@@ -35,8 +38,9 @@ namespace {
         
         void addVel(const Vec2& aVel, const Vec2& aOfsSeparateVec)
         {
-            HPC_ASSERT(count < Parameter::CharaCountMax);
-            vels[count++] = aVel;
+            HPC_ASSERT(count < Parameter::CharaCapacity);
+            totalVel += aVel;
+            ++count;
             ofsSeparateVec += aOfsSeparateVec;
         }
         
@@ -46,41 +50,67 @@ namespace {
                 return Vec2();
             }
             
-            Vec2 totalVel;
-            for (int index = 0; index < count; ++index) {
-                totalVel += vels[index];
-            }
-            
             return totalVel / static_cast<float>(count);
         }
     };
     
+    /// 衝突しそうな組を x 座標で絞り込む (sweep and prune) キャラ数の最小値
+    // これより少なければ全組を調べた方が速い
+    const int SweepAndPruneCountMin = 16;
+    
+    /// 衝突しそうな組を x 座標で絞り込むときの、中心間の x 方向の距離の上限の、直径に対する割合
+    // 衝突判定の計算誤差で取りこぼさないよう、直径より少し広く取る
+    const float SweepAndPruneReachRate = 1.0f + 1.0f / 64.0f;
+    
+    /// キャラの組 (aIndexA < aIndexB) を、並べ替えると組の辞書順になる1つの値にまとめます。
+    uint PackCharaPair(int aIndexA, int aIndexB)
+    {
+        return (static_cast<uint>(aIndexA) << 16) | static_cast<uint>(aIndexB);
+    }
+    
+    /// ゴールしたキャラの順位の比較用の値の基準。通過できる蓮の数より十分大きい値。
+    const int GoalOrderKeyBase = 1 << 30;
+    
     //------------------------------------------------------------------------------
-    /// aCharaB より aCharaA が上位かどうかを返します。
-    bool IsHighOrder(const Chara& aCharaA, const Chara& aCharaB)
+    /// 順位を比較するための値を返します。値が大きいほど上位です。
+    ///
+    /// - ゴールしている方が上位
+    /// - 両方ゴールしている場合、ゴールまでのターン数が短い方が上位
+    /// - 両方ゴールしていない場合、通過した蓮の数が多い方が上位
+    ///
+    /// この値は蓮を通過したときとゴールしたときにしか変わりません。
+    int RankOrderKey(const Chara& aChara)
     {
-        // ゴールしている方が上位
-        if (aCharaA.isGoal() && !aCharaB.isGoal()) {
-            return true;
+        if (aChara.isGoal()) {
+            return GoalOrderKeyBase - aChara.passedTurn();
         }
-        if (!aCharaA.isGoal() && aCharaB.isGoal()) {
-            return false;
-        }
-        
-        // 両方ゴールしている場合
-        if (aCharaA.isGoal() && aCharaB.isGoal()) {
-            // ゴールまでのターン数が短い方が上位
-            return aCharaA.passedTurn() < aCharaB.passedTurn();
-        }
-        
-        // 両方ゴールしていない場合
-        if (!aCharaA.isGoal() && !aCharaB.isGoal()) {
-            // 通過した蓮の数が多い方が上位
-            return aCharaB.passedLotusCount() < aCharaA.passedLotusCount();
+        return aChara.passedLotusCount();
+    }
+
+    //------------------------------------------------------------------------------
+    /// キャラの番号を、順位の高い順に並べるための比較関数です。
+    ///
+    /// 順位の比較用の値が同じキャラは、番号の小さい方を上位とします。
+    /// そのため順位はキャラの状態だけで決まり、並べ替えや入れ替えの手順にはよりません。
+    struct RankOrderGreater
+    {
+        const Chara* charas;    ///< キャラ用配列
+
+        //------------------------------------------------------------------------------
+        /// @return aIndexA のキャラが aIndexB のキャラより上位なら @c true 。
+        bool operator()(int aIndexA, int aIndexB)const
+        {
+            const int keyA = RankOrderKey(charas[aIndexA]);
+            const int keyB = RankOrderKey(charas[aIndexB]);
+            return keyB < keyA || (keyA == keyB && aIndexA < aIndexB);
         }
-        
-        HPC_SHOULD_NOT_REACH_HERE();
-        return false;
+    };
+
+    //------------------------------------------------------------------------------
+    /// @return 新しい順位が aLhs の方が高ければ @c true 。
+    bool IsHigherNewRank(const RankEvent& aLhs, const RankEvent& aRhs)
+    {
+        return aLhs.rank < aRhs.rank;
     }
 }
 
@@ -89,10 +119,44 @@ namespace hpc {
     //------------------------------------------------------------------------------
     /// クラスのインスタンスを生成します。
     CharaCollection::CharaCollection()
-        : mCharas()
+        : mPhysics()
+        , mCharas()
         , mCharaTypes()
         , mCount(0)
+        , mSortedIndices()
+        , mCollisionPairs()
+        , mRankOrder()
+        , mIsRankDirty(true)
+        , mRankEvents()
+        , mRankEventCount(0)
+        , mRankEventIndices()
+        , mIsSweptCollision(false)
+    {
+        for (int index = 0; index < Parameter::CharaCapacity; ++index) {
+            mCharas[index].bindPhysics(mPhysics, index);
+            mRankEventIndices[index] = -1;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// キャラ同士の衝突を、移動中も含めて連続的に判定するかどうかを設定します。
+    ///
+    /// 既定では、ゲームのルールどおり移動後の位置だけで判定します。
+    /// 連続判定にすると、速いキャラ同士が1ターンの移動中にすり抜けることがなくなりますが、
+    /// 結果はゲームのルールどおりではなくなります。
+    /// この設定はステージの情報ではないので、 reset() では変わりません。
+    ///
+    /// @param[in] aIsSwept 連続判定するなら @c true 。
+    void CharaCollection::setSweptCollision(bool aIsSwept)
+    {
+        mIsSweptCollision = aIsSwept;
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return キャラ同士の衝突を連続判定するかどうか。
+    bool CharaCollection::isSweptCollision()const
     {
+        return mIsSweptCollision;
     }
 
     //------------------------------------------------------------------------------
@@ -112,27 +176,49 @@ namespace hpc {
     }
 
     //------------------------------------------------------------------------------
-    /// 各キャラの動作を実行します。
-    void CharaCollection::procExecAction()
+    /// 各キャラの動作を実行し、移動させます。
+    ///
+    /// @param[in] aStage 現在のステージ。
+    void CharaCollection::procExecAction(const Stage& aStage)
     {
         for (int index = 0; index < count(); ++index) {
-            Chara& chara = mCharas[index];
-            
             // ゴールしていたら何もしない
-            if (chara.isGoal()) {
+            if (!mPhysics.isActive[index]) {
                 continue;
             }
             
-            chara.execAction();
-            
-            // 移動処理を行う
-            chara.move();
+            mCharas[index].execAction();
+        }
+        
+        // 移動処理を全キャラ分まとめて行う
+        // 速度分移動 ＆ フィールドの流れる速度を反映
+        const Vec2 flowVel = aStage.field().flowVel();
+        float velXs[Parameter::CharaCapacity];
+        float velYs[Parameter::CharaCapacity];
+        for (int index = 0; index < count(); ++index) {
+            const bool isActive = mPhysics.isActive[index];
+            const float nextX = mPhysics.posX[index] + (mPhysics.velX[index] + flowVel.x);
+            const float nextY = mPhysics.posY[index] + (mPhysics.velY[index] + flowVel.y);
+            mPhysics.posX[index] = isActive ? nextX : mPhysics.posX[index];
+            mPhysics.posY[index] = isActive ? nextY : mPhysics.posY[index];
+            velXs[index] = mPhysics.velX[index];
+            velYs[index] = mPhysics.velY[index];
+        }
+        
+        // 減速させる
+        Vec2::ShortenBatch(velXs, velYs, Parameter::CharaDecelSpeed(), count());
+        for (int index = 0; index < count(); ++index) {
+            const bool isActive = mPhysics.isActive[index];
+            mPhysics.velX[index] = isActive ? velXs[index] : mPhysics.velX[index];
+            mPhysics.velY[index] = isActive ? velYs[index] : mPhysics.velY[index];
         }
     }
 
     //------------------------------------------------------------------------------
     /// 各キャラ同士の衝突判定を行います。
-    void CharaCollection::procCheckColl()
+    ///
+    /// @param[in] aStage 現在のステージ。
+    void CharaCollection::procCheckColl(const Stage& aStage)
     {
         // ■衝突判定の方針について
         // 条件：静止円同士での判定。非弾性衝突。処理順に影響しない。
@@ -149,88 +235,128 @@ namespace hpc {
         // ※注意点
         // 正確さよりもをシンプルさを優先している為、衝突の仕方によっては
         // 不自然な方向に跳ね返る事があります。
+        //
+        // ■連続判定 (setSweptCollision(true) のとき)
+        // 1. で衝突していなくても、このターンの移動中に接していれば衝突とする。
+        //    接した時点の位置関係で 2. 3. を行い、めり込み補正には、接した位置まで戻す分も含める。
         
-        CalcVelSet velSet[Parameter::CharaCountMax];
+        CalcVelSet velSet[Parameter::CharaCapacity];
+        const float radius = Parameter::CharaRadius();
         
-        for (int indexA = 0; indexA < count(); ++indexA) {
-            const Chara& charaA = mCharas[indexA];
+        // 衝突しそうな組を、番号の辞書順に並べて求める
+        const int pairCount = collectCollisionPairs();
+        for (int pairIndex = 0; pairIndex < pairCount; ++pairIndex) {
+            const int indexA = static_cast<int>(mCollisionPairs[pairIndex] >> 16);
+            const int indexB = static_cast<int>(mCollisionPairs[pairIndex] & 0xFFFF);
+            const Vec2 velA(mPhysics.velX[indexA], mPhysics.velY[indexA]);
+            const Circle circleA(Vec2(mPhysics.posX[indexA], mPhysics.posY[indexA]), radius);
+            const Vec2 velB(mPhysics.velX[indexB], mPhysics.velY[indexB]);
+            const Circle circleB(Vec2(mPhysics.posX[indexB], mPhysics.posY[indexB]), radius);
             
-            // ゴールしていたら何もしない
-            if (charaA.isGoal()) {
-                continue;
+            bool isHit = Collision::IsHit(circleA, circleB);
+            // 連続判定では、移動中にすり抜けた組も衝突とする
+            bool isSweptHit = false;
+            Vec2 contactA = circleA.pos();
+            Vec2 contactB = circleB.pos();
+            if (!isHit && mIsSweptCollision) {
+                const Vec2 prevA(mPhysics.prevPosX[indexA], mPhysics.prevPosY[indexA]);
+                const Vec2 prevB(mPhysics.prevPosX[indexB], mPhysics.prevPosY[indexB]);
+                const float time = Collision::TimeOfImpact(
+                    Circle(prevA, radius)
+                    , circleA.pos()
+                    , Circle(prevB, radius)
+                    , circleB.pos()
+                    );
+                // 移動開始時から重なっていて離れていく組は除く
+                if (0.0f < time) {
+                    isHit = true;
+                    isSweptHit = true;
+                    contactA = prevA + (circleA.pos() - prevA) * time;
+                    contactB = prevB + (circleB.pos() - prevB) * time;
+                }
             }
             
-            const Vec2 velA = charaA.vel();
-            const Circle circleA = charaA.region();
-            
-            for (int indexB = indexA + 1; indexB < count(); ++indexB) {
-                const Chara& charaB = mCharas[indexB];
+            if (isHit) {
                 
-                // ゴールしていたら何もしない
-                if (charaB.isGoal()) {
-                    continue;
+                Vec2 toB = contactB - contactA;
+                const float margin = Parameter::CharaDecelSpeed();
+                const float separateHalfDist = (circleA.radius() + circleB.radius() - toB.length() + margin) / 2.0f;
+                // 完全に重なっていたら、x軸と水平に衝突したことにする
+                if (toB.isZero()) {
+                    toB.x = 1.0f;
                 }
                 
-                const Vec2 velB = charaB.vel();
-                const Circle circleB = charaB.region();
+                const Vec2 verticalA = velA.getProjected(toB);
+                const Vec2 parallelA = velA - verticalA;
+                const Vec2 verticalB = velB.getProjected(toB);
+                const Vec2 parallelB = velB - verticalB;
                 
-                if (Collision::IsHit(circleA, circleB)) {
-                    
-                    Vec2 toB = charaB.pos() - charaA.pos();
-                    const float margin = Parameter::CharaDecelSpeed();
-                    const float separateHalfDist = (circleA.radius() + circleB.radius() - toB.length() + margin) / 2.0f;
-                    // 完全に重なっていたら、x軸と水平に衝突したことにする
-                    if (toB.isZero()) {
-                        toB.x = 1.0f;
-                    }
-                    
-                    const Vec2 verticalA = velA.getProjected(toB);
-                    const Vec2 parallelA = velA - verticalA;
-                    const Vec2 verticalB = velB.getProjected(toB);
-                    const Vec2 parallelB = velB - verticalB;
-                    
-                    const float factor = Parameter::CharaReflectionFactor();
-                    const Vec2 nextVerticalA = (verticalA * (1.0f - factor) + verticalB * (1.0f + factor)) / 2.0f;
-                    const Vec2 nextVerticalB = nextVerticalA - (verticalB - verticalA) * factor;
-                    
-                    const Vec2 ofsSeparateVec = 0.0f < separateHalfDist
-                        ? toB.getNormalized(separateHalfDist)
-                        : Vec2();
-                    velSet[indexA].addVel(parallelA + nextVerticalA, -ofsSeparateVec);
-                    velSet[indexB].addVel(parallelB + nextVerticalB, ofsSeparateVec);
+                const float factor = Parameter::CharaReflectionFactor();
+                const Vec2 nextVerticalA = (verticalA * (1.0f - factor) + verticalB * (1.0f + factor)) / 2.0f;
+                const Vec2 nextVerticalB = nextVerticalA - (verticalB - verticalA) * factor;
+                
+                const Vec2 ofsSeparateVec = 0.0f < separateHalfDist
+                    ? toB.getNormalized(separateHalfDist)
+                    : Vec2();
+                Vec2 ofsA = -ofsSeparateVec;
+                Vec2 ofsB = ofsSeparateVec;
+                if (isSweptHit) {
+                    ofsA += contactA - circleA.pos();
+                    ofsB += contactB - circleB.pos();
                 }
+                velSet[indexA].addVel(parallelA + nextVerticalA, ofsA);
+                velSet[indexB].addVel(parallelB + nextVerticalB, ofsB);
             }
         }
         
         // 求めた結果を反映する
         for (int index = 0; index < count(); ++index) {
-            Chara& chara = mCharas[index];
-            
-            // ゴールしていたら何もしない
-            if (chara.isGoal()) {
+            // ゴールしていたら、衝突していなかったら何もしない
+            if (!mPhysics.isActive[index] || velSet[index].count == 0) {
                 continue;
             }
-            
-            // 衝突していなかったら何もしない
-            if (velSet[index].count == 0) {
-                continue;
-            }
-            chara.setVel(velSet[index].calculatedVel());
+            const Vec2 vel = velSet[index].calculatedVel();
+            mPhysics.velX[index] = vel.x;
+            mPhysics.velY[index] = vel.y;
             
             // めりこみ補正を反映させる
-            chara.separation(velSet[index].ofsSeparateVec);
+            mPhysics.posX[index] += velSet[index].ofsSeparateVec.x;
+            mPhysics.posY[index] += velSet[index].ofsSeparateVec.y;
         }
         
         // フィールド外に出ていたら、内側に補正する
+        // 補正した場合は速度をゼロにする
+        const Rectangle fieldRect = aStage.field().rect();
         for (int index = 0; index < count(); ++index) {
-            Chara& chara = mCharas[index];
-            
             // ゴールしていたら何もしない
-            if (chara.isGoal()) {
+            if (!mPhysics.isActive[index]) {
                 continue;
             }
             
-            chara.correctInside();
+            float x = mPhysics.posX[index];
+            float y = mPhysics.posY[index];
+            bool isCorrect = false;
+            if (x - radius < fieldRect.left) {
+                x = fieldRect.left + radius;
+                isCorrect = true;
+            } else if (fieldRect.right < x + radius) {
+                x = fieldRect.right - radius;
+                isCorrect = true;
+            }
+            if (y - radius < fieldRect.bottom) {
+                y = fieldRect.bottom + radius;
+                isCorrect = true;
+            } else if (fieldRect.top < y + radius) {
+                y = fieldRect.top - radius;
+                isCorrect = true;
+            }
+            
+            if (isCorrect) {
+                mPhysics.posX[index] = x;
+                mPhysics.posY[index] = y;
+                mPhysics.velX[index] = 0.0f;
+                mPhysics.velY[index] = 0.0f;
+            }
         }
     }
 
@@ -238,22 +364,57 @@ namespace hpc {
     /// 最終処理を行います。
     void CharaCollection::procEnd(const Stage& aStage)
     {
+        // 最初の蓮の通過判定は、全キャラ分をまとめて行う。
+        // 位置は CharaPhysics の配列をそのまま渡す。ゴールしたキャラの結果は使わない。
+        float lotusXs[Parameter::CharaCapacity] = {};
+        float lotusYs[Parameter::CharaCapacity] = {};
+        float lotusRadii[Parameter::CharaCapacity] = {};
+        float radii[Parameter::CharaCapacity] = {};
         for (int index = 0; index < count(); ++index) {
             Chara& chara = mCharas[index];
             
-            // ゴールしていたら何もしない
-            if (chara.isGoal()) {
-                continue;
+            // ゴールしていなければ、ターン経過処理を行う
+            if (mPhysics.isActive[index]) {
+                chara.updateTurn();
             }
             
-            // ターン経過処理を行う
-            chara.updateTurn();
+            const Circle& lotusRegion = aStage.lotuses()[chara.targetLotusNo()].region();
+            lotusXs[index] = lotusRegion.pos().x;
+            lotusYs[index] = lotusRegion.pos().y;
+            lotusRadii[index] = lotusRegion.radius();
+            radii[index] = Parameter::CharaRadius();
+        }
+        bool isHits[Parameter::CharaCapacity];
+        Collision::IsHitSwept(
+            lotusXs
+            , lotusYs
+            , lotusRadii
+            , mPhysics.prevPosX
+            , mPhysics.prevPosY
+            , radii
+            , mPhysics.posX
+            , mPhysics.posY
+            , count()
+            , isHits
+            );
+        
+        // 順位は、蓮を通過したキャラ(ゴールを含む)だけ上げる
+        int passedIndices[Parameter::CharaCapacity];
+        int passedCount = 0;
+        for (int index = 0; index < count(); ++index) {
+            // ゴールしていたら、目標の蓮を通過していなかったら判定終了
+            if (!mPhysics.isActive[index] || !isHits[index]) {
+                continue;
+            }
+            Chara& chara = mCharas[index];
+            chara.incTargetLotusNo();
+            passedIndices[passedCount++] = index;
             
-            // 蓮の通過判定
+            // 続けて次の蓮を通過しているか判定
+            // 円（蓮）と移動円（キャラの前回位置から今回位置への移動）で衝突する蓮を、グリッドでまとめて求めておく
+            const LotusBits hitLotusBits = aStage.lotuses().hitBits(chara.prevRegion(), chara.region().pos());
             while (!chara.isGoal()) {
-                const Lotus& lotus = aStage.lotuses()[chara.targetLotusNo()];
-                // 円（蓮）と移動円（キャラの前回位置から今回位置への移動）で衝突判定を行う
-                if (Collision::IsHit(lotus.region(), chara.prevRegion(), chara.region().pos())) {
+                if (hitLotusBits.contains(chara.targetLotusNo())) {
                     // 目標の蓮を通過したら、次の蓮との判定を行う
                     chara.incTargetLotusNo();
                 } else {
@@ -263,8 +424,50 @@ namespace hpc {
             }
         }
         
+        updateActive();
+        
         // 順位を更新
-        updateRank();
+        clearRankEvents();
+        if (mIsRankDirty) {
+            rebuildRank();
+            mIsRankDirty = false;
+        } else {
+            for (int index = 0; index < passedCount; ++index) {
+                raiseRank(passedIndices[index]);
+            }
+        }
+        finishRankEvents();
+    }
+
+    //------------------------------------------------------------------------------
+    /// 有効なすべてのキャラの、ターンごとに変わる状態を取得します。
+    ///
+    /// 位置と速度は、 CharaPhysics をまるごとコピーします。
+    ///
+    /// @param[out] aPhysics    位置と速度の書き込み先。
+    /// @param[out] aStates     状態の書き込み先。 count() 個の要素が必要です。
+    void CharaCollection::saveStates(CharaPhysics& aPhysics, CharaState* aStates)const
+    {
+        aPhysics = mPhysics;
+        for (int index = 0; index < count(); ++index) {
+            mCharas[index].saveState(aStates[index]);
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// 有効なすべてのキャラの、ターンごとに変わる状態を戻します。
+    ///
+    /// @param[in] aPhysics    saveStates() で取得した位置と速度。
+    /// @param[in] aStates     saveStates() で取得した状態。
+    void CharaCollection::restoreStates(const CharaPhysics& aPhysics, const CharaState* aStates)
+    {
+        mPhysics = aPhysics;
+        for (int index = 0; index < count(); ++index) {
+            mCharas[index].restoreState(aStates[index]);
+        }
+        // 取得したときに順位が更新済みだったかはわからないので、次のターンで求め直す
+        mIsRankDirty = true;
+        clearRankEvents();
     }
 
     //------------------------------------------------------------------------------
@@ -272,11 +475,13 @@ namespace hpc {
     /// 有効なキャラ数は 0 となります。
     void CharaCollection::reset()
     {
-        for (int index = 0; index < Parameter::CharaCountMax; ++index) {
+        for (int index = 0; index < Parameter::CharaCapacity; ++index) {
             mCharas[index].reset();
             mCharaTypes[index] = CharaType_TERM;
         }
         mCount = 0;
+        mIsRankDirty = true;
+        clearRankEvents();
     }
 
     //------------------------------------------------------------------------------
@@ -287,10 +492,14 @@ namespace hpc {
         , const CharaParam& aCharaParam
         )
     {
-        HPC_RANGE_ASSERT_MIN_UB_I(mCount, 0, Parameter::CharaCountMax);
+        HPC_RANGE_ASSERT_MIN_UB_I(mCount, 0, Parameter::CharaCapacity);
         mCharas[mCount].setup(aCharaPos, aCharaParam);
         mCharaTypes[mCount] = aCharaParam.type();
+        mSortedIndices[mCount] = mCount;
+        mRankOrder[mCount] = mCount;
         ++mCount;
+        updateActive();
+        mIsRankDirty = true;
     }
 
     //------------------------------------------------------------------------------
@@ -341,6 +550,23 @@ namespace hpc {
         return targetCount;
     }
 
+    //------------------------------------------------------------------------------
+    /// @return 直前の procEnd() で順位が変わったキャラの数。
+    int CharaCollection::rankEventCount()const
+    {
+        return mRankEventCount;
+    }
+
+    //------------------------------------------------------------------------------
+    /// @param[in] aIndex 順位の変化の番号。 rankEventCount() 未満。
+    ///
+    /// @return 直前の procEnd() での aIndex 番目の順位の変化。新しい順位の順に並びます。
+    const RankEvent& CharaCollection::rankEvent(int aIndex)const
+    {
+        HPC_RANGE_ASSERT_MIN_UB_I(aIndex, 0, mRankEventCount);
+        return mRankEvents[aIndex];
+    }
+
     //------------------------------------------------------------------------------
     /// @param[in] aIndex キャラのインデックス。
     ///
@@ -362,32 +588,170 @@ namespace hpc {
     }
 
     //------------------------------------------------------------------------------
-    /// 順位を更新します。
-    void CharaCollection::updateRank()
+    /// ゴールしていないかどうか CharaPhysics::isActive を更新します。
+    void CharaCollection::updateActive()
+    {
+        for (int index = 0; index < Parameter::CharaCapacity; ++index) {
+            mPhysics.isActive[index] = index < count() && !mCharas[index].isGoal();
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// 衝突しそうなキャラの組を mCollisionPairs に求めます。
+    ///
+    /// キャラ数が少なければゴールしていないキャラの全組を、
+    /// 多ければ x 座標で並べた mSortedIndices を使って、 x 方向に重なりうる組だけを求めます。
+    /// どちらの場合も、組は (番号の小さい方, 大きい方) の辞書順に並べるので、
+    /// 衝突の反映順は全組を調べた場合と変わりません。
+    ///
+    /// @return 求めた組の数。
+    int CharaCollection::collectCollisionPairs()
     {
-        Chara* charaArray[Parameter::CharaCountMax] = {0};
+        int pairCount = 0;
+        if (count() < SweepAndPruneCountMin) {
+            for (int indexA = 0; indexA < count(); ++indexA) {
+                if (!mPhysics.isActive[indexA]) {
+                    continue;
+                }
+                for (int indexB = indexA + 1; indexB < count(); ++indexB) {
+                    if (mPhysics.isActive[indexB]) {
+                        mCollisionPairs[pairCount++] = PackCharaPair(indexA, indexB);
+                    }
+                }
+            }
+            return pairCount;
+        }
         
-        for (int index = 0; index < count(); ++index) {
-            charaArray[index] = &mCharas[index];
+        // 前のターンの並びはほぼ整列済みなので、挿入ソートで並べ直す
+        for (int sortIndex = 1; sortIndex < count(); ++sortIndex) {
+            const int charaIndex = mSortedIndices[sortIndex];
+            const float posX = mPhysics.posX[charaIndex];
+            int insertIndex = sortIndex;
+            for (; 0 < insertIndex && posX < mPhysics.posX[mSortedIndices[insertIndex - 1]]; --insertIndex) {
+                mSortedIndices[insertIndex] = mSortedIndices[insertIndex - 1];
+            }
+            mSortedIndices[insertIndex] = charaIndex;
         }
         
-        // 順位決定
-        for (int indexA = 0; indexA < count(); ++indexA) {
-            HPC_ASSERT(charaArray[indexA] != 0);
-            for (int indexB = indexA + 1; indexB < count(); ++indexB) {
-                HPC_ASSERT(charaArray[indexB] != 0);
-                if (IsHighOrder(*charaArray[indexB], *charaArray[indexA])) {
-                    Chara* tmp = charaArray[indexA];
-                    charaArray[indexA] = charaArray[indexB];
-                    charaArray[indexB] = tmp;
+        float reach = Parameter::CharaRadius() * 2.0f * SweepAndPruneReachRate;
+        // 連続判定では、移動中に近づいた組も含める
+        if (mIsSweptCollision) {
+            float moveXMax = 0.0f;
+            for (int index = 0; index < count(); ++index) {
+                if (mPhysics.isActive[index]) {
+                    moveXMax = Math::Max(moveXMax, Math::Abs(mPhysics.posX[index] - mPhysics.prevPosX[index]));
                 }
             }
+            reach += moveXMax * 2.0f;
         }
-        
-        // 結果を反映
-        for (int index = 0; index < count(); ++index) {
-            charaArray[index]->setRank(index);
+        for (int sortIndexA = 0; sortIndexA < count(); ++sortIndexA) {
+            const int indexA = mSortedIndices[sortIndexA];
+            if (!mPhysics.isActive[indexA]) {
+                continue;
+            }
+            const float limitX = mPhysics.posX[indexA] + reach;
+            for (int sortIndexB = sortIndexA + 1; sortIndexB < count(); ++sortIndexB) {
+                const int indexB = mSortedIndices[sortIndexB];
+                if (limitX < mPhysics.posX[indexB]) {
+                    break;
+                }
+                if (mPhysics.isActive[indexB]) {
+                    mCollisionPairs[pairCount++] = indexA < indexB
+                        ? PackCharaPair(indexA, indexB)
+                        : PackCharaPair(indexB, indexA);
+                }
+            }
+        }
+        std::sort(mCollisionPairs, mCollisionPairs + pairCount);
+        return pairCount;
+    }
+
+    //------------------------------------------------------------------------------
+    /// すべてのキャラの順位を、キャラの状態から求め直します。
+    ///
+    /// 順位が変わったキャラは、 rankEvent() で取得できるよう記録します。
+    void CharaCollection::rebuildRank()
+    {
+        const RankOrderGreater greater = { mCharas };
+        std::sort(mRankOrder, mRankOrder + count(), greater);
+        for (int rank = 0; rank < count(); ++rank) {
+            setCharaRank(mRankOrder[rank], rank);
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// 順位の比較用の値が増えたキャラを、上位のキャラと1つずつ比べて順位を上げます。
+    ///
+    /// 比較用の値は蓮を通過したときとゴールしたときに増えるだけなので、
+    /// 他のキャラどうしの順序は変わらず、追い越されたキャラが1つずつ下がるだけです。
+    ///
+    /// @param[in] aCharaIndex 比較用の値が増えたキャラの番号。
+    void CharaCollection::raiseRank(int aCharaIndex)
+    {
+        const RankOrderGreater greater = { mCharas };
+        int rank = mCharas[aCharaIndex].rank();
+        HPC_ASSERT(mRankOrder[rank] == aCharaIndex);
+        while (0 < rank && greater(aCharaIndex, mRankOrder[rank - 1])) {
+            const int passedIndex = mRankOrder[rank - 1];
+            mRankOrder[rank] = passedIndex;
+            setCharaRank(passedIndex, rank);
+            --rank;
+        }
+        mRankOrder[rank] = aCharaIndex;
+        setCharaRank(aCharaIndex, rank);
+    }
+
+    //------------------------------------------------------------------------------
+    /// キャラの順位を設定します。
+    ///
+    /// このターンで初めて順位が変わるキャラは、変わる前の順位とともに記録します。
+    ///
+    /// @param[in] aCharaIndex  キャラの番号。
+    /// @param[in] aRank        新しい順位。
+    void CharaCollection::setCharaRank(int aCharaIndex, int aRank)
+    {
+        Chara& chara = mCharas[aCharaIndex];
+        if (chara.rank() == aRank) {
+            return;
+        }
+        int& eventIndex = mRankEventIndices[aCharaIndex];
+        if (eventIndex < 0) {
+            eventIndex = mRankEventCount++;
+            RankEvent& event = mRankEvents[eventIndex];
+            event.charaIndex = aCharaIndex;
+            event.prevRank = chara.rank();
+        }
+        mRankEvents[eventIndex].rank = aRank;
+        chara.setRank(aRank);
+    }
+
+    //------------------------------------------------------------------------------
+    /// 直前のターンの順位の変化の記録を消します。
+    void CharaCollection::clearRankEvents()
+    {
+        for (int index = 0; index < mRankEventCount; ++index) {
+            mRankEventIndices[mRankEvents[index].charaIndex] = -1;
+        }
+        mRankEventCount = 0;
+    }
+
+    //------------------------------------------------------------------------------
+    /// このターンの順位の変化の記録から、結局元の順位に戻ったキャラを除き、新しい順位の順に並べます。
+    ///
+    /// 記録の番号が変わるので、以降このターンでは setCharaRank() を呼べません。
+    void CharaCollection::finishRankEvents()
+    {
+        int eventCount = 0;
+        for (int index = 0; index < mRankEventCount; ++index) {
+            const RankEvent& event = mRankEvents[index];
+            if (event.prevRank != event.rank) {
+                mRankEvents[eventCount++] = event;
+            } else {
+                mRankEventIndices[event.charaIndex] = -1;
+            }
         }
+        mRankEventCount = eventCount;
+        std::sort(mRankEvents, mRankEvents + mRankEventCount, IsHigherNewRank);
     }
 }
 
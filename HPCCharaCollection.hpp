@@ -12,6 +12,7 @@
 
 #include "HPCChara.hpp"
 #include "HPCParameter.hpp"
+#include "HPCTypes.hpp"
 #include "HPCVec2.hpp"
 
 namespace hpc {
@@ -19,19 +20,35 @@ namespace hpc {
     class Random;
     class Stage;
     
+    //------------------------------------------------------------------------------
+    /// キャラの順位の変化を表します。
+    struct RankEvent
+    {
+        int charaIndex;     ///< 順位が変わったキャラの番号
+        int prevRank;       ///< 変わる前の順位
+        int rank;           ///< 変わった後の順位
+    };
+    
     //------------------------------------------------------------------------------
     /// キャラの組を表します。
     ///
     /// 1ステージのすべてのキャラは、この CharaCollection クラスに格納されます。
     /// このクラスは、回答者には公開されません。
+    ///
+    /// キャラの位置と速度は CharaPhysics にまとめて持ち、
+    /// 移動・衝突・フィールド内への補正は全キャラ分を配列のままループで処理します。
+    /// 各 Chara は CharaPhysics の自分の要素を参照するため、このクラスはコピーできません。
     class CharaCollection
     {
     public:
         CharaCollection();
 
+        void setSweptCollision(bool aIsSwept);          ///< キャラ同士の衝突を連続判定するかどうかを設定します。
+        bool isSweptCollision()const;                   ///< キャラ同士の衝突を連続判定するかどうかを返します。
+
         void procDecideAction(Random& aRandom);         ///< 動作を決定します。
-        void procExecAction();                          ///< 動作を実行します。
-        void procCheckColl();                           ///< キャラ同士の衝突判定を行います。
+        void procExecAction(const Stage& aStage);       ///< 動作を実行します。
+        void procCheckColl(const Stage& aStage);        ///< キャラ同士の衝突判定を行います。
         void procEnd(const Stage& aStage);              ///< 最終処理を行います。
         
         void reset();                                   ///< キャラデータを初期化します。
@@ -43,6 +60,12 @@ namespace hpc {
         int count()const;                               ///< 有効なキャラ数を返します。
         bool isAllHumanGoal()const;                     ///< 人間キャラが全員ゴールしたかどうかを返します。
         int goalCount()const;                           ///< ゴールしたキャラ数を返します。
+        int rankEventCount()const;                      ///< 直前のターンで順位が変わったキャラの数を返します。
+        const RankEvent& rankEvent(int aIndex)const;    ///< 直前のターンでの順位の変化を返します。
+        /// 全キャラの状態を取得します。
+        void saveStates(CharaPhysics& aPhysics, CharaState* aStates)const;
+        /// 全キャラの状態を戻します。
+        void restoreStates(const CharaPhysics& aPhysics, const CharaState* aStates);
 
         /// @name 有効なキャラへのアクセス
         //@{
@@ -51,11 +74,36 @@ namespace hpc {
         //@}
 
     private:
-        Chara mCharas[Parameter::CharaCountMax];        ///< キャラ用配列
-        CharaType mCharaTypes[Parameter::CharaCountMax];///< キャラの種類
+        CharaPhysics mPhysics;                          ///< 全キャラの位置と速度
+        Chara mCharas[Parameter::CharaCapacity];        ///< キャラ用配列
+        CharaType mCharaTypes[Parameter::CharaCapacity];///< キャラの種類
         int mCount;                                     ///< 有効なキャラ数
+        int mSortedIndices[Parameter::CharaCapacity];   ///< x 座標の順に並べたキャラの番号
+        /// 衝突しそうなキャラの組
+        uint mCollisionPairs[Parameter::CharaCapacity * (Parameter::CharaCapacity - 1) / 2];
+        int mRankOrder[Parameter::CharaCapacity];       ///< 順位の順に並べたキャラの番号
+        bool mIsRankDirty;                              ///< 蓮の通過を待たずに順位を求め直す必要があるか
+        RankEvent mRankEvents[Parameter::CharaCapacity];///< 直前のターンでの順位の変化
+        int mRankEventCount;                            ///< 直前のターンで順位が変わったキャラの数
+        int mRankEventIndices[Parameter::CharaCapacity];///< キャラごとの mRankEvents の番号。順位が変わっていなければ -1
+        bool mIsSweptCollision;                         ///< キャラ同士の衝突を連続判定するかどうか
         
-        void updateRank();
+        CharaCollection(const CharaCollection& aCharas);            ///< コピーはできません。
+        CharaCollection& operator=(const CharaCollection& aCharas); ///< コピーはできません。
+
+        /// キャラの組を 16 ビットずつに詰めるので、キャラ数の上限は 16 ビットで表せる必要がある。
+        /// 組の配列は上限の2乗に比例するので、さらに控えめに抑えておく。
+        typedef char CharaCapacityCheck[
+            Parameter::CharaCountMax <= Parameter::CharaCapacity && Parameter::CharaCapacity <= 1024 ? 1 : -1
+            ];
+
+        void updateActive();                            ///< ゴールしていないかどうかを更新します。
+        int collectCollisionPairs();                    ///< 衝突しそうなキャラの組を求めます。
+        void rebuildRank();                             ///< 順位をすべて求め直します。
+        void raiseRank(int aCharaIndex);                ///< 順位の比較用の値が増えたキャラの順位を上げます。
+        void setCharaRank(int aCharaIndex, int aRank);  ///< キャラの順位を設定し、変化を記録します。
+        void clearRankEvents();                         ///< 順位の変化の記録を消します。
+        void finishRankEvents();                        ///< 順位の変化の記録を新しい順位の順に並べます。
     };
 }
 //------------------------------------------------------------------------------
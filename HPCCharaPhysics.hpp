@@ -0,0 +1,38 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    CharaPhysics 構造体
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "HPCParameter.hpp"
+
+namespace hpc {
+
+    //------------------------------------------------------------------------------
+    /// 全キャラの位置と速度を、要素ごとの配列にまとめた POD です。
+    ///
+    /// CharaCollection が1つ持ち、各 Chara は自分の番号の要素を参照します。
+    /// 同じ種類の値が連続して並ぶので、移動・衝突・フィールド内への補正を
+    /// 全キャラ分まとめて短いループで処理できます。
+    /// また、代入や memcpy の1回でまるごとコピーできます。
+    ///
+    /// キャラの半径は全キャラ共通の Parameter::CharaRadius() なので持ちません。
+    struct CharaPhysics
+    {
+        float posX[Parameter::CharaCapacity];       ///< 位置
+        float posY[Parameter::CharaCapacity];       ///< 位置
+        float prevPosX[Parameter::CharaCapacity];   ///< 前回位置
+        float prevPosY[Parameter::CharaCapacity];   ///< 前回位置
+        float velX[Parameter::CharaCapacity];       ///< 速度
+        float velY[Parameter::CharaCapacity];       ///< 速度
+        bool isActive[Parameter::CharaCapacity];    ///< ゴールしていないかどうか
+    };
+}
+//------------------------------------------------------------------------------
+// EOF
@@ -11,6 +11,133 @@
 
 #include "HPCCollision.hpp"
 #include "HPCMath.hpp"
+#include "HPCSimd.hpp"
+
+namespace {
+    using namespace hpc;
+
+#ifdef HPC_SIMD_SSE2
+    //------------------------------------------------------------------------------
+    /// 比較結果のマスクを bool の配列に書き出します。
+    void StoreMask(int aMask, int aCount, bool* aResults)
+    {
+        for (int index = 0; index < aCount; ++index) {
+            aResults[index] = ((aMask >> index) & 1) != 0;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// Collision::IsHit(const Circle&, const Circle&, const Vec2&) を4要素まとめて行います。
+    ///
+    /// 演算の順序はスカラー版と同じにしています。
+    ///
+    /// @return 衝突している要素のビットが立ったマスク。
+    int IsHitSwept4(
+        __m128 aX0
+        , __m128 aY0
+        , __m128 aR0
+        , __m128 aX1
+        , __m128 aY1
+        , __m128 aR1
+        , __m128 aPX1
+        , __m128 aPY1
+        )
+    {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        const __m128 radius = _mm_add_ps(aR0, aR1);
+
+        // 動いていない要素は、静止している円の判定
+        const __m128 isStatic = _mm_and_ps(_mm_cmpeq_ps(aX1, aPX1), _mm_cmpeq_ps(aY1, aPY1));
+        const __m128 dx = _mm_sub_ps(aX1, aX0);
+        const __m128 dy = _mm_sub_ps(aY1, aY0);
+        const __m128 squareDist = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        const __m128 staticHit = _mm_cmple_ps(squareDist, _mm_mul_ps(radius, radius));
+
+        // 円と線分の距離
+        const __m128 segX = _mm_sub_ps(aPX1, aX1);
+        const __m128 segY = _mm_sub_ps(aPY1, aY1);
+        const __m128 c1ToC0X = _mm_sub_ps(aX0, aX1);
+        const __m128 c1ToC0Y = _mm_sub_ps(aY0, aY1);
+        const __m128 cross = _mm_sub_ps(_mm_mul_ps(segX, c1ToC0Y), _mm_mul_ps(segY, c1ToC0X));
+        const __m128 segLength = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(segX, segX), _mm_mul_ps(segY, segY)));
+        const __m128 dist = _mm_div_ps(_mm_andnot_ps(signMask, cross), segLength);
+        const __m128 isFar = _mm_cmpgt_ps(dist, radius);
+
+        // 線分の延長線上で交差していないか
+        const __m128 p1ToC0X = _mm_sub_ps(aX0, aPX1);
+        const __m128 p1ToC0Y = _mm_sub_ps(aY0, aPY1);
+        const __m128 dot0 = _mm_add_ps(_mm_mul_ps(c1ToC0X, segX), _mm_mul_ps(c1ToC0Y, segY));
+        const __m128 dot1 = _mm_add_ps(_mm_mul_ps(p1ToC0X, segX), _mm_mul_ps(p1ToC0Y, segY));
+        const __m128 isOpposite = _mm_cmple_ps(_mm_mul_ps(dot0, dot1), zero);
+        const __m128 length0 = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(c1ToC0X, c1ToC0X), _mm_mul_ps(c1ToC0Y, c1ToC0Y)));
+        const __m128 length1 = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(p1ToC0X, p1ToC0X), _mm_mul_ps(p1ToC0Y, p1ToC0Y)));
+        const __m128 isInside = _mm_or_ps(_mm_cmpge_ps(radius, length0), _mm_cmpge_ps(radius, length1));
+        const __m128 sweptHit = _mm_andnot_ps(isFar, _mm_or_ps(isOpposite, isInside));
+
+        const __m128 hit = _mm_or_ps(_mm_and_ps(isStatic, staticHit), _mm_andnot_ps(isStatic, sweptHit));
+        return _mm_movemask_ps(hit);
+    }
+#endif
+
+#ifdef HPC_SIMD_AVX2
+    //------------------------------------------------------------------------------
+    /// Collision::IsHit(const Circle&, const Circle&, const Vec2&) を8要素まとめて行います。
+    ///
+    /// 演算の順序はスカラー版と同じにしています。
+    ///
+    /// @return 衝突している要素のビットが立ったマスク。
+    int IsHitSwept8(
+        __m256 aX0
+        , __m256 aY0
+        , __m256 aR0
+        , __m256 aX1
+        , __m256 aY1
+        , __m256 aR1
+        , __m256 aPX1
+        , __m256 aPY1
+        )
+    {
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 signMask = _mm256_set1_ps(-0.0f);
+        const __m256 radius = _mm256_add_ps(aR0, aR1);
+
+        const __m256 isStatic = _mm256_and_ps(
+            _mm256_cmp_ps(aX1, aPX1, _CMP_EQ_OQ)
+            , _mm256_cmp_ps(aY1, aPY1, _CMP_EQ_OQ)
+            );
+        const __m256 dx = _mm256_sub_ps(aX1, aX0);
+        const __m256 dy = _mm256_sub_ps(aY1, aY0);
+        const __m256 squareDist = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+        const __m256 staticHit = _mm256_cmp_ps(squareDist, _mm256_mul_ps(radius, radius), _CMP_LE_OQ);
+
+        const __m256 segX = _mm256_sub_ps(aPX1, aX1);
+        const __m256 segY = _mm256_sub_ps(aPY1, aY1);
+        const __m256 c1ToC0X = _mm256_sub_ps(aX0, aX1);
+        const __m256 c1ToC0Y = _mm256_sub_ps(aY0, aY1);
+        const __m256 cross = _mm256_sub_ps(_mm256_mul_ps(segX, c1ToC0Y), _mm256_mul_ps(segY, c1ToC0X));
+        const __m256 segLength = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(segX, segX), _mm256_mul_ps(segY, segY)));
+        const __m256 dist = _mm256_div_ps(_mm256_andnot_ps(signMask, cross), segLength);
+        const __m256 isFar = _mm256_cmp_ps(dist, radius, _CMP_GT_OQ);
+
+        const __m256 p1ToC0X = _mm256_sub_ps(aX0, aPX1);
+        const __m256 p1ToC0Y = _mm256_sub_ps(aY0, aPY1);
+        const __m256 dot0 = _mm256_add_ps(_mm256_mul_ps(c1ToC0X, segX), _mm256_mul_ps(c1ToC0Y, segY));
+        const __m256 dot1 = _mm256_add_ps(_mm256_mul_ps(p1ToC0X, segX), _mm256_mul_ps(p1ToC0Y, segY));
+        const __m256 isOpposite = _mm256_cmp_ps(_mm256_mul_ps(dot0, dot1), zero, _CMP_LE_OQ);
+        const __m256 length0 = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(c1ToC0X, c1ToC0X), _mm256_mul_ps(c1ToC0Y, c1ToC0Y)));
+        const __m256 length1 = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(p1ToC0X, p1ToC0X), _mm256_mul_ps(p1ToC0Y, p1ToC0Y)));
+        const __m256 isInside = _mm256_or_ps(
+            _mm256_cmp_ps(radius, length0, _CMP_GE_OQ)
+            , _mm256_cmp_ps(radius, length1, _CMP_GE_OQ)
+            );
+        const __m256 sweptHit = _mm256_andnot_ps(isFar, _mm256_or_ps(isOpposite, isInside));
+
+        const __m256 hit = _mm256_or_ps(_mm256_and_ps(isStatic, staticHit), _mm256_andnot_ps(isStatic, sweptHit));
+        return _mm256_movemask_ps(hit);
+    }
+#endif
+}
 
 namespace hpc {
 
@@ -68,6 +195,233 @@ namespace hpc {
         }
         return false;
     }
+
+    //------------------------------------------------------------------------------
+    /// 2つの円が、同じ時間をかけてそれぞれ直線上を等速で移動するとき、最初に接する時刻を求めます。
+    ///
+    /// 移動開始を時刻 0 、移動後を時刻 1 とします。
+    /// 1ターンの移動中に、すり抜けてしまう組も求められます。
+    ///
+    /// @param[in] aC0    1つ目の円。移動開始時の状態を設定します。
+    /// @param[in] aP0    1つ目の円の移動後の位置。
+    /// @param[in] aC1    2つ目の円。移動開始時の状態を設定します。
+    /// @param[in] aP1    2つ目の円の移動後の位置。
+    ///
+    /// @return 最初に接する [0, 1] の範囲の時刻。移動開始時に接していれば 0 。
+    ///         移動中に接しなければ負の値を返します。
+    float Collision::TimeOfImpact(const Circle& aC0, const Vec2& aP0, const Circle& aC1, const Vec2& aP1)
+    {
+        // aC0 から見た aC1 の相対的な動きとして、
+        // |toC1 + relMove * t| = radius となる最小の t を求める。
+        const float radius = aC0.radius() + aC1.radius();
+        const Vec2 toC1 = aC1.pos() - aC0.pos();
+        const Vec2 relMove = (aP1 - aC1.pos()) - (aP0 - aC0.pos());
+        const float c = toC1.squareLength() - radius * radius;
+        if (c <= 0.0f) {
+            return 0.0f;
+        }
+        const float a = relMove.squareLength();
+        const float halfB = toC1.dot(relMove);
+        // 相対的に動いていない、または離れていく場合は接しない
+        if (a == 0.0f || 0.0f <= halfB) {
+            return -1.0f;
+        }
+        const float discriminant = halfB * halfB - a * c;
+        if (discriminant < 0.0f) {
+            return -1.0f;
+        }
+        // 小さい方の解を、桁落ちしない形で求める
+        const float t = c / (-halfB + Math::Sqrt(discriminant));
+        return t <= 1.0f ? t : -1.0f;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 円の中に点が含まれるかどうかを、複数の点についてまとめて判定します。
+    /// 円周上の点も含まれるとみなします。
+    ///
+    /// 結果は、点と円の中心との距離の二乗を Vec2::squareDist() で求め、
+    /// 半径の二乗と比較した場合と一致します。
+    ///
+    /// @param[in] aCircle  円。
+    /// @param[in] aXs      点の x 座標の配列。
+    /// @param[in] aYs      点の y 座標の配列。
+    /// @param[in] aCount   点の数。
+    /// @param[out] aResults 判定結果の配列。 aCount 個の要素が必要です。
+    void Collision::IsHitPoints(
+        const Circle& aCircle
+        , const float* aXs
+        , const float* aYs
+        , int aCount
+        , bool* aResults
+        )
+    {
+        const float x = aCircle.pos().x;
+        const float y = aCircle.pos().y;
+        const float squareRadius = aCircle.radius() * aCircle.radius();
+        int index = 0;
+#ifdef HPC_SIMD_SSE2
+        {
+            const __m128 cx = _mm_set1_ps(x);
+            const __m128 cy = _mm_set1_ps(y);
+            const __m128 squareRadius4 = _mm_set1_ps(squareRadius);
+            for (; index + 4 <= aCount; index += 4) {
+                const __m128 dx = _mm_sub_ps(_mm_loadu_ps(aXs + index), cx);
+                const __m128 dy = _mm_sub_ps(_mm_loadu_ps(aYs + index), cy);
+                const __m128 squareDist = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+                StoreMask(_mm_movemask_ps(_mm_cmple_ps(squareDist, squareRadius4)), 4, aResults + index);
+            }
+        }
+#endif
+        for (; index < aCount; ++index) {
+            const float dx = aXs[index] - x;
+            const float dy = aYs[index] - y;
+            aResults[index] = dx * dx + dy * dy <= squareRadius;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// 静止している円と、動いている円との衝突を、複数の組についてまとめて判定します。
+    ///
+    /// 要素ごとの結果は IsHit(const Circle&, const Circle&, const Vec2&) と一致します。
+    ///
+    /// @param[in] aX0s      静止している円の x 座標の配列。
+    /// @param[in] aY0s      静止している円の y 座標の配列。
+    /// @param[in] aRadius0s 静止している円の半径の配列。
+    /// @param[in] aX1s      動いている円の、移動開始時の x 座標の配列。
+    /// @param[in] aY1s      動いている円の、移動開始時の y 座標の配列。
+    /// @param[in] aRadius1s 動いている円の半径の配列。
+    /// @param[in] aPX1s     動いている円の、移動後の x 座標の配列。
+    /// @param[in] aPY1s     動いている円の、移動後の y 座標の配列。
+    /// @param[in] aCount    組の数。
+    /// @param[out] aResults 判定結果の配列。 aCount 個の要素が必要です。
+    void Collision::IsHitSwept(
+        const float* aX0s
+        , const float* aY0s
+        , const float* aRadius0s
+        , const float* aX1s
+        , const float* aY1s
+        , const float* aRadius1s
+        , const float* aPX1s
+        , const float* aPY1s
+        , int aCount
+        , bool* aResults
+        )
+    {
+        int index = 0;
+#ifdef HPC_SIMD_AVX2
+        for (; index + 8 <= aCount; index += 8) {
+            const int mask = IsHitSwept8(
+                _mm256_loadu_ps(aX0s + index)
+                , _mm256_loadu_ps(aY0s + index)
+                , _mm256_loadu_ps(aRadius0s + index)
+                , _mm256_loadu_ps(aX1s + index)
+                , _mm256_loadu_ps(aY1s + index)
+                , _mm256_loadu_ps(aRadius1s + index)
+                , _mm256_loadu_ps(aPX1s + index)
+                , _mm256_loadu_ps(aPY1s + index)
+                );
+            StoreMask(mask, 8, aResults + index);
+        }
+#endif
+#ifdef HPC_SIMD_SSE2
+        for (; index + 4 <= aCount; index += 4) {
+            const int mask = IsHitSwept4(
+                _mm_loadu_ps(aX0s + index)
+                , _mm_loadu_ps(aY0s + index)
+                , _mm_loadu_ps(aRadius0s + index)
+                , _mm_loadu_ps(aX1s + index)
+                , _mm_loadu_ps(aY1s + index)
+                , _mm_loadu_ps(aRadius1s + index)
+                , _mm_loadu_ps(aPX1s + index)
+                , _mm_loadu_ps(aPY1s + index)
+                );
+            StoreMask(mask, 4, aResults + index);
+        }
+#endif
+        for (; index < aCount; ++index) {
+            aResults[index] = IsHit(
+                Circle(Vec2(aX0s[index], aY0s[index]), aRadius0s[index])
+                , Circle(Vec2(aX1s[index], aY1s[index]), aRadius1s[index])
+                , Vec2(aPX1s[index], aPY1s[index])
+                );
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// 1つの静止している円と、同じ大きさの動いている円との衝突を、まとめて判定します。
+    ///
+    /// 要素ごとの結果は IsHit(const Circle&, const Circle&, const Vec2&) と一致します。
+    ///
+    /// @param[in] aC0       静止している円。
+    /// @param[in] aRadius1  動いている円の半径。
+    /// @param[in] aX1s      動いている円の、移動開始時の x 座標の配列。
+    /// @param[in] aY1s      動いている円の、移動開始時の y 座標の配列。
+    /// @param[in] aPX1s     動いている円の、移動後の x 座標の配列。
+    /// @param[in] aPY1s     動いている円の、移動後の y 座標の配列。
+    /// @param[in] aCount    判定する数。
+    /// @param[out] aResults 判定結果の配列。 aCount 個の要素が必要です。
+    void Collision::IsHitSwept(
+        const Circle& aC0
+        , float aRadius1
+        , const float* aX1s
+        , const float* aY1s
+        , const float* aPX1s
+        , const float* aPY1s
+        , int aCount
+        , bool* aResults
+        )
+    {
+        int index = 0;
+#ifdef HPC_SIMD_AVX2
+        {
+            const __m256 x0 = _mm256_set1_ps(aC0.pos().x);
+            const __m256 y0 = _mm256_set1_ps(aC0.pos().y);
+            const __m256 radius0 = _mm256_set1_ps(aC0.radius());
+            const __m256 radius1 = _mm256_set1_ps(aRadius1);
+            for (; index + 8 <= aCount; index += 8) {
+                const int mask = IsHitSwept8(
+                    x0
+                    , y0
+                    , radius0
+                    , _mm256_loadu_ps(aX1s + index)
+                    , _mm256_loadu_ps(aY1s + index)
+                    , radius1
+                    , _mm256_loadu_ps(aPX1s + index)
+                    , _mm256_loadu_ps(aPY1s + index)
+                    );
+                StoreMask(mask, 8, aResults + index);
+            }
+        }
+#endif
+#ifdef HPC_SIMD_SSE2
+        {
+            const __m128 x0 = _mm_set1_ps(aC0.pos().x);
+            const __m128 y0 = _mm_set1_ps(aC0.pos().y);
+            const __m128 radius0 = _mm_set1_ps(aC0.radius());
+            const __m128 radius1 = _mm_set1_ps(aRadius1);
+            for (; index + 4 <= aCount; index += 4) {
+                const int mask = IsHitSwept4(
+                    x0
+                    , y0
+                    , radius0
+                    , _mm_loadu_ps(aX1s + index)
+                    , _mm_loadu_ps(aY1s + index)
+                    , radius1
+                    , _mm_loadu_ps(aPX1s + index)
+                    , _mm_loadu_ps(aPY1s + index)
+                    );
+                StoreMask(mask, 4, aResults + index);
+            }
+        }
+#endif
+        for (; index < aCount; ++index) {
+            aResults[index] = IsHit(
+                aC0
+                , Circle(Vec2(aX1s[index], aY1s[index]), aRadius1)
+                , Vec2(aPX1s[index], aPY1s[index])
+                );
+        }
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -25,6 +25,46 @@ namespace hpc {
         static bool IsHit(const Circle& aC0, const Circle& aC1);
         /// 静止している円と、移動している円が衝突するかどうかを返します。
         static bool IsHit(const Circle& aC0, const Circle& aC1, const Vec2& aP1);
+        /// 2つの移動している円が最初に接する時刻を返します。
+        static float TimeOfImpact(const Circle& aC0, const Vec2& aP0, const Circle& aC1, const Vec2& aP1);
+
+        /// @name 複数の判定をまとめて行う関数
+        /// 座標と半径は、要素ごとの配列で渡します。
+        /// 結果は、1つずつ IsHit() を呼んだ場合と完全に一致します。
+        //@{
+        /// 円の中に点が含まれるかどうかをまとめて判定します。
+        static void IsHitPoints(
+            const Circle& aCircle
+            , const float* aXs
+            , const float* aYs
+            , int aCount
+            , bool* aResults
+            );
+        /// 静止している円と、移動している円が衝突するかどうかをまとめて判定します。
+        static void IsHitSwept(
+            const float* aX0s
+            , const float* aY0s
+            , const float* aRadius0s
+            , const float* aX1s
+            , const float* aY1s
+            , const float* aRadius1s
+            , const float* aPX1s
+            , const float* aPY1s
+            , int aCount
+            , bool* aResults
+            );
+        /// 1つの静止している円と、同じ大きさの移動している円が衝突するかどうかをまとめて判定します。
+        static void IsHitSwept(
+            const Circle& aC0
+            , float aRadius1
+            , const float* aX1s
+            , const float* aY1s
+            , const float* aPX1s
+            , const float* aPY1s
+            , int aCount
+            , bool* aResults
+            );
+        //@}
 
     private:
         Collision();
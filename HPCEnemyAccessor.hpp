@@ -35,7 +35,7 @@ namespace hpc {
         const Chara& operator[](int aIndex)const;       ///< 有効な敵キャラへの参照を返します。
 
     private:
-        const Chara* mEnemies[Parameter::CharaCountMax - 1]; ///< 敵キャラのポインタ配列
+        const Chara* mEnemies[Parameter::CharaCapacity - 1]; ///< 敵キャラのポインタ配列
         int mCount;                                         ///< 有効な敵キャラ数
     };
 }
@@ -13,6 +13,8 @@
 
 #include "HPCCommon.hpp"
 #include "HPCLevelDesigner.hpp"
+#include "HPCParallelRunner.hpp"
+#include "HPCStageCache.hpp"
 
 namespace hpc {
 
@@ -37,11 +39,14 @@ namespace hpc {
         HPC_ASSERT_MSG(isValidStage(), "Index indicates an invalid Stage (#%d)", mCurrentStageIndex);
         
         // ステージの生成を行います。
+        if (mCurrentStageIndex == 0) {
+            StageCache::Prepare(mRandSet.system());
+        }
         LevelDesigner::Setup(mCurrentStageIndex, mStage, mRandSet.system());
 
         mStage.start();
         mRecord.writeStartStage(mCurrentStageIndex, mStage);
-        mRecord.writeTurn(mStage.lastTurnResult());
+        mRecord.writeTurn(mStage);
     }
 
     //------------------------------------------------------------------------------
@@ -53,7 +58,7 @@ namespace hpc {
         HPC_ASSERT_MSG(isValidStage(), "Index indicates an invalid Stage (#%d)", mCurrentStageIndex);
 
         mStage.runTurn(mRandSet.game());
-        mRecord.writeTurn(mStage.lastTurnResult());
+        mRecord.writeTurn(mStage);
     }
 
     //------------------------------------------------------------------------------
@@ -92,6 +97,52 @@ namespace hpc {
         return (0 <= mCurrentStageIndex && mCurrentStageIndex < Parameter::GameStageCount);
     }
 
+    //------------------------------------------------------------------------------
+    /// すべてのステージを並列に実行し、記録します。
+    ///
+    /// 各ステージは、乱数から導出したステージごとの乱数で実行されるため、ワーカー数によらず同じ結果が得られます。
+    /// ゲーム用の乱数の使い方が startStage() から順に実行した場合とは異なるので、結果もそれとは異なります。
+    /// 順に実行した場合の各ステージ開始時の乱数の状態は、前のステージを実行し終えるまで決まらないためです。
+    /// 詳しくは ParallelRunner を参照してください。
+    ///
+    /// @param[in] aWorkerCount ワーカー数。
+    /// @param[in] aTimer       制限時間を判定するタイマー。
+    ///
+    /// @pre まだステージを1つも実行していない必要があります。
+    /// @post すべてのステージを終えた状態になります。
+    void Game::runParallel(int aWorkerCount, const Timer& aTimer)
+    {
+        HPC_ASSERT_MSG(mCurrentStageIndex == 0, "Stages are already running (#%d)", mCurrentStageIndex);
+
+        ParallelRunner::Run(aWorkerCount, mRandSet, mRecord, aTimer, mStage.charas().isSweptCollision());
+        mCurrentStageIndex = Parameter::GameStageCount;
+    }
+
+    //------------------------------------------------------------------------------
+    /// キャラ同士の衝突を連続判定するかどうかを設定します。
+    ///
+    /// startStage() で実行するステージと、 runParallel() で実行するステージの両方に適用します。
+    ///
+    /// @param[in] aIsSwept 連続判定するなら @c true 。
+    void Game::setSweptCollision(bool aIsSwept)
+    {
+        mStage.charas().setSweptCollision(aIsSwept);
+    }
+
+    //------------------------------------------------------------------------------
+    /// ステージを実行する代わりに、リプレイファイルから記録を読み込みます。
+    ///
+    /// @param[in] aFileName リプレイファイル名。
+    ///
+    /// @return 読み込みに成功したら @c true を返します。
+    ///
+    /// @post すべてのステージを終えた状態になります。
+    bool Game::readReplay(const char* aFileName)
+    {
+        mCurrentStageIndex = Parameter::GameStageCount;
+        return mRecord.readReplay(aFileName);
+    }
+
     //------------------------------------------------------------------------------
     /// 内部に格納されているゲームの記録を返します。
     ///
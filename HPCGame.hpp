@@ -14,11 +14,15 @@
 #include "HPCRandomSet.hpp"
 #include "HPCRecord.hpp"
 #include "HPCStage.hpp"
+#include "HPCTimer.hpp"
 
 namespace hpc {
 
     //------------------------------------------------------------------------------
     /// ゲーム全体を表します。
+    ///
+    /// startStage() から順に実行する場合、ゲーム用の乱数は全ステージで1つの乱数列を続けて使います。
+    /// runParallel() はステージごとに Random::substream() を使うため、結果は順に実行した場合とは異なります。
     class Game 
     {
     public:
@@ -29,6 +33,9 @@ namespace hpc {
         StageState state()const;           ///< ステージ内での現在の状態を表します。
         void onStageDone();                 ///< ステージ終了を通知します。
         bool isValidStage()const;          ///< 現在のステージが有効なものかどうかを返します。
+        void runParallel(int aWorkerCount, const Timer& aTimer); ///< 残りのステージを並列に実行します。
+        void setSweptCollision(bool aIsSwept); ///< キャラ同士の衝突を連続判定するかどうかを設定します。
+        bool readReplay(const char* aFileName);            ///< リプレイファイルから記録を読み込みます。
 
         const Record& record()const;       ///< 記録へのアクセサ
 
@@ -17,11 +17,16 @@
 #include "HPCCommon.hpp"
 #include "HPCLevelGrid.hpp"
 #include "HPCMath.hpp"
+#include "HPCProfiler.hpp"
 #include "HPCRandom.hpp"
+#include "HPCStageCache.hpp"
 
 namespace {
     using namespace hpc;
 
+    /// SetupLarge() で使う配置用グリッドの作業領域
+    LevelGridStorage sLargeGridStorage;
+
     //------------------------------------------------------------------------------
     /// 各ステージごとのグリッドサイズを取得します。
     ///
@@ -54,15 +59,6 @@ namespace {
         }
     }
 
-    //------------------------------------------------------------------------------
-    /// フィールドのステージ生成用グリッドサイズを取得します。
-    ///
-    /// @return フィールドの1グリッドの大きさを返します。
-    float FieldGridSize()
-    {
-        return Parameter::CharaRadius() * 2.0f;
-    }
-
     //------------------------------------------------------------------------------
     /// フィールドの流れる速度を取得します。
     ///
@@ -106,10 +102,10 @@ namespace {
     /// @return グリッドから作成される実際の矩形を表す Rectangle
     Rectangle GridToRect(const IntVec2& aGridPos, const IntVec2& aGridSize)
     {
-        const float left = FieldGridSize() * aGridPos.x;
-        const float bottom = FieldGridSize() * aGridPos.y;
-        const float width = FieldGridSize() * aGridSize.x;
-        const float height = FieldGridSize() * aGridSize.y;
+        const float left = LevelDesigner::FieldGridSize() * aGridPos.x;
+        const float bottom = LevelDesigner::FieldGridSize() * aGridPos.y;
+        const float width = LevelDesigner::FieldGridSize() * aGridSize.x;
+        const float height = LevelDesigner::FieldGridSize() * aGridSize.y;
 
         return Rectangle(left, left + width, bottom, bottom + height);
     }
@@ -217,6 +213,96 @@ namespace {
         const Rectangle rect = GridToRect(aGridPos, IntVec2(aWidth, aHeight));
         return rect.center();
     }
+
+    //------------------------------------------------------------------------------
+    /// キャラを初期位置に配置します。
+    ///
+    /// 初期位置はキャラによって異なるが、最初の蓮までの距離は同じです。
+    /// 初期位置は、最初の蓮からフィールドの広い方へ向けて、重なり合わないように並べます。
+    ///
+    /// @param[in]      aCharaCount  プレイヤーを含めたキャラ数。
+    /// @param[in]      aCpuStrength CPU の強さ。
+    /// @param[in,out]  aStage       蓮とフィールドを用意したステージ情報。キャラが追加されます。
+    /// @param[in,out]  aRandom      乱数
+    void SetupCharas(int aCharaCount, int aCpuStrength, Stage& aStage, Random& aRandom)
+    {
+        HPC_RANGE_ASSERT_MIN_MAX_I(aCharaCount, 1, Parameter::CharaCountMax);
+        
+        Vec2 posArray[Parameter::CharaCountMax];
+        
+        // 配列に座標をセット
+        {
+            const Vec2 targetPos = aStage.lotuses()[0].pos();
+            const Rectangle fieldRect = aStage.field().rect();
+            const float largeSignX = targetPos.x - fieldRect.left < fieldRect.right - targetPos.x ? 1.0f : -1.0f;
+            const float largeSignY = targetPos.y - fieldRect.bottom < fieldRect.top - targetPos.y ? 1.0f : -1.0f;
+            const float rotSign = largeSignX * largeSignY;
+            const float unitRotDeg = 90.0f / (Parameter::CharaCountMax);
+            const int fieldHalfLenI = static_cast<int>(
+                Math::Min(fieldRect.width() / 2.0f, fieldRect.height() / 2.0f) - 1.0f
+                );
+            HPC_ASSERT(0 < fieldHalfLenI);
+            
+            Vec2 baseVec(
+                // 最低3グリッド離れれば、初期配置で重なり合う事はない
+                aRandom.randMinMax(
+                    Math::Max(
+                        3 * static_cast<int>(LevelDesigner::FieldGridSize())
+                        , fieldHalfLenI / 2
+                        )
+                    , fieldHalfLenI
+                    ) * largeSignX
+                , 0.0f
+                );
+            
+            for (int index = 0; index < Parameter::CharaCountMax; ++index) {
+                posArray[index] = targetPos + baseVec;
+                baseVec.rotate(
+                    Math::DegToRad(
+                        float(unitRotDeg * rotSign)
+                        )
+                    );
+            }
+        }
+        
+        // 配列をシャッフル
+        for (int index = 0; index < Parameter::CharaCountMax; ++index) {
+            const int randIndex = aRandom.randMinTerm(index, Parameter::CharaCountMax);
+            const Vec2 tmp = posArray[index];
+            posArray[index] = posArray[randIndex];
+            posArray[randIndex] = tmp;
+        }
+        
+        // 初期配置で重なり合わない事を保証する
+        {
+            const float necessaryDist = Parameter::CharaRadius() * 2 + 0.125f;
+            for (int indexA = 0; indexA < Parameter::CharaCountMax; ++indexA) {
+                for (int indexB = indexA + 1; indexB < Parameter::CharaCountMax; ++indexB) {
+                    if (posArray[indexA].dist(posArray[indexB]) < necessaryDist) {
+                        HPC_ASSERT_MSG(false, "CharaInitPos is overlapped.");
+                    }
+                }
+            }
+        }
+        
+        for (int index = 0; index < aCharaCount; ++index) {
+            if (index == 0) {
+                // 0番は人間
+                aStage.charas().setupAddChara(
+                    posArray[index]
+                    , CharaParam::CreateHuman()
+                    );
+            } else {
+                // それ以外はCPU
+                aStage.charas().setupAddChara(
+                    posArray[index]
+                    , CharaParam::CreateCpu(
+                        aCpuStrength
+                        )
+                    );
+            }
+        }
+    }
 }
 
 namespace hpc {
@@ -229,6 +315,11 @@ namespace hpc {
     /// @param[in,out]  aRandom 乱数
     void LevelDesigner::Setup(int aNumber, Stage& aStage, Random& aRandom)
     {
+        ProfileSample sample(ProfileScope_StageSetup);
+        // 同じ乱数の状態から生成したことがあれば、保存した生成結果を使う
+        if (StageCache::Restore(aNumber, aStage, aRandom)) {
+            return;
+        }
         aStage.reset();
 
         HPC_RANGE_ASSERT_MIN_UB_I(aNumber, 0, Parameter::GameStageCount);
@@ -260,89 +351,110 @@ namespace hpc {
                 , Parameter::LotusBaseRadius() * size
                 );
         }
+        aStage.lotuses().setupEnd();
 
         // キャラの初期位置
-        // 初期位置はキャラによって異なるが、最初の蓮までの距離は同じ
-        {
-            const int charaCount = BattleCharaCount(aNumber);
-            
-            Vec2 posArray[Parameter::CharaCountMax];
-            
-            // 配列に座標をセット
-            {
-                const Vec2 targetPos = aStage.lotuses()[0].pos();
-                const Rectangle fieldRect = aStage.field().rect();
-                const float largeSignX = targetPos.x - fieldRect.left < fieldRect.right - targetPos.x ? 1.0f : -1.0f;
-                const float largeSignY = targetPos.y - fieldRect.bottom < fieldRect.top - targetPos.y ? 1.0f : -1.0f;
-                const float rotSign = largeSignX * largeSignY;
-                const float unitRotDeg = 90.0f / (Parameter::CharaCountMax);
-                const int fieldHalfLenI = static_cast<int>(
-                    Math::Min(fieldRect.width() / 2.0f, fieldRect.height() / 2.0f) - 1.0f
-                    );
-                HPC_ASSERT(0 < fieldHalfLenI);
-                
-                Vec2 baseVec(
-                    // 最低3グリッド離れれば、初期配置で重なり合う事はない
-                    aRandom.randMinMax(
-                        Math::Max(
-                            3 * static_cast<int>(FieldGridSize())
-                            , fieldHalfLenI / 2
-                            )
-                        , fieldHalfLenI
-                        ) * largeSignX
-                    , 0.0f
-                    );
-                
-                for (int index = 0; index < Parameter::CharaCountMax; ++index) {
-                    posArray[index] = targetPos + baseVec;
-                    baseVec.rotate(
-                        Math::DegToRad(
-                            float(unitRotDeg * rotSign)
-                            )
-                        );
+        SetupCharas(BattleCharaCount(aNumber), GetCpuStrength(aNumber), aStage, aRandom);
+    }
+
+    //------------------------------------------------------------------------------
+    /// 負荷試験用に、 Setup() したステージへ CPU キャラを追加します。
+    ///
+    /// 追加するキャラは、フィールド内の既存のキャラと重ならない位置にランダムに置きます。
+    /// 置ける場所が見つからなければ、 aCharaCount 人に満たなくても追加をやめます。
+    /// ゲームのルールの範囲外の人数になるため、記録やリプレイはできません。
+    ///
+    /// @param[in]      aNumber     ステージ番号
+    /// @param[in]      aCharaCount 追加後のキャラ数(プレイヤー含む)
+    /// @param[in,out]  aStage      Setup() したステージ情報。キャラが追加されます。
+    /// @param[in,out]  aRandom     乱数
+    void LevelDesigner::AddCrowd(int aNumber, int aCharaCount, Stage& aStage, Random& aRandom)
+    {
+        HPC_RANGE_ASSERT_MIN_UB_I(aNumber, 0, Parameter::GameStageCount);
+        HPC_RANGE_ASSERT_MIN_MAX_I(aCharaCount, 0, Parameter::CharaCapacity);
+        
+        // 位置は 1/8 単位で選ぶ
+        const int posDiv = 8;
+        const float radius = Parameter::CharaRadius();
+        const float necessaryDist = radius * 2 + 0.125f;
+        const Rectangle fieldRect = aStage.field().rect();
+        const int stepCountX = static_cast<int>((fieldRect.width() - radius * 2) * posDiv);
+        const int stepCountY = static_cast<int>((fieldRect.height() - radius * 2) * posDiv);
+        HPC_ASSERT(0 < stepCountX && 0 < stepCountY);
+        
+        const int cpuStrength = GetCpuStrength(aNumber);
+        CharaCollection& charas = aStage.charas();
+        const int tryCountMax = 64 * aCharaCount;
+        for (int tryCount = 0; tryCount < tryCountMax && charas.count() < aCharaCount; ++tryCount) {
+            const Vec2 pos(
+                fieldRect.left + radius + static_cast<float>(aRandom.randMinMax(0, stepCountX)) / posDiv
+                , fieldRect.bottom + radius + static_cast<float>(aRandom.randMinMax(0, stepCountY)) / posDiv
+                );
+            bool isOverlapped = false;
+            for (int index = 0; index < charas.count(); ++index) {
+                if (pos.dist(charas[index].pos()) < necessaryDist) {
+                    isOverlapped = true;
+                    break;
                 }
             }
-            
-            // 配列をシャッフル
-            for (int index = 0; index < Parameter::CharaCountMax; ++index) {
-                const int randIndex = aRandom.randMinTerm(index, Parameter::CharaCountMax);
-                const Vec2 tmp = posArray[index];
-                posArray[index] = posArray[randIndex];
-                posArray[randIndex] = tmp;
-            }
-            
-            // 初期配置で重なり合わない事を保証する
-            {
-                const float necessaryDist = Parameter::CharaRadius() * 2 + 0.125f;
-                for (int indexA = 0; indexA < Parameter::CharaCountMax; ++indexA) {
-                    for (int indexB = indexA + 1; indexB < Parameter::CharaCountMax; ++indexB) {
-                        if (posArray[indexA].dist(posArray[indexB]) < necessaryDist) {
-                            HPC_ASSERT_MSG(false, "CharaInitPos is overlapped.");
-                        }
-                    }
-                }
+            if (!isOverlapped) {
+                charas.setupAddChara(pos, CharaParam::CreateCpu(cpuStrength));
             }
-            
-            const int cpuStrength = GetCpuStrength(aNumber);
-            
-            for (int index = 0; index < charaCount; ++index) {
-                if (index == 0) {
-                    // 0番は人間
-                    aStage.charas().setupAddChara(
-                        posArray[index]
-                        , CharaParam::CreateHuman()
-                        );
-                } else {
-                    // それ以外はCPU
-                    aStage.charas().setupAddChara(
-                        posArray[index]
-                        , CharaParam::CreateCpu(
-                            cpuStrength
-                            )
-                        );
-                }
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// 負荷試験用に、ゲームのルールより大きなステージを生成します。
+    ///
+    /// 蓮の大きさと CPU の強さは、最後のステージと同じ決め方です。
+    /// 蓮同士が重ならないこと・キャラの初期位置が重ならないことは Setup() と同じく保証します。
+    /// 蓮を置ける場所がなくなったら、 aLotusCount 個に満たなくても追加をやめます。
+    /// 蓮の数が Parameter::LotusCountMax を超えると、記録やリプレイはできません。
+    ///
+    /// @param[in]      aGridSize   フィールドのグリッド数。1辺 LargeGridSizeMin から LargeGridSizeMax まで。
+    /// @param[in]      aLotusCount 蓮の個数。 LargeLotusCountMin から Parameter::LotusCapacity まで。
+    /// @param[in]      aFlowVel    フィールドの流れる速度。
+    /// @param[in,out]  aStage      ステージ情報。関数を呼ぶと書き換えられます。
+    /// @param[in,out]  aRandom     乱数
+    void LevelDesigner::SetupLarge(const IntVec2& aGridSize, int aLotusCount, const Vec2& aFlowVel, Stage& aStage, Random& aRandom)
+    {
+        ProfileSample sample(ProfileScope_StageSetup);
+        aStage.reset();
+
+        HPC_RANGE_ASSERT_MIN_MAX_I(aGridSize.x, LargeGridSizeMin, LargeGridSizeMax);
+        HPC_RANGE_ASSERT_MIN_MAX_I(aGridSize.y, LargeGridSizeMin, LargeGridSizeMax);
+        HPC_RANGE_ASSERT_MIN_MAX_I(aLotusCount, LargeLotusCountMin, Parameter::LotusCapacity);
+        const int lastNumber = Parameter::GameStageCount - 1;
+        LevelGrid grid(aGridSize, GetEdgeInhibitMargin(), aRandom, sLargeGridStorage);
+        aStage.field().setup(GridToRect(IntVec2(), aGridSize), aFlowVel);
+        
+        // 蓮を配置する。最初の蓮は必ず置ける
+        aStage.lotuses().reset();
+        for (int index = 0; index < aLotusCount; ++index) {
+            const int size = GetRandomLotusSize(lastNumber, aRandom);
+            const int occupyGridSize = Math::Ceil(Parameter::LotusBaseRadius() * 2 * size / FieldGridSize()) + 1;
+            IntVec2 gridPos;
+            if (!grid.trySetRandomOccupied(occupyGridSize, occupyGridSize, gridPos)) {
+                break;
             }
+            aStage.lotuses().setupAddLotus(
+                GridCenterToVec2(gridPos, occupyGridSize, occupyGridSize)
+                , Parameter::LotusBaseRadius() * size
+                );
         }
+        aStage.lotuses().setupEnd();
+        HPC_ASSERT(0 < aStage.lotuses().count());
+        
+        SetupCharas(Parameter::CharaCountMax, GetCpuStrength(lastNumber), aStage, aRandom);
+    }
+
+    //------------------------------------------------------------------------------
+    /// フィールドのステージ生成用グリッドサイズを取得します。
+    ///
+    /// @return フィールドの1グリッドの大きさを返します。
+    float LevelDesigner::FieldGridSize()
+    {
+        return Parameter::CharaRadius() * 2.0f;
     }
 }
 
@@ -10,8 +10,11 @@
 //------------------------------------------------------------------------------
 #pragma once
 
+#include "HPCIntVec2.hpp"
+#include "HPCLevelGrid.hpp"
 #include "HPCRandom.hpp"
 #include "HPCStage.hpp"
+#include "HPCVec2.hpp"
 
 namespace hpc {
 
@@ -20,8 +23,22 @@ namespace hpc {
     class LevelDesigner
     {
     public:
+        static const int LargeGridSizeMin = 10;     ///< SetupLarge() で指定できるグリッドの1辺の最小数
+        /// SetupLarge() で指定できるグリッドの1辺の最大数
+        static const int LargeGridSizeMax = LevelGridStorage::CellSizeMax;
+        /// SetupLarge() で指定できる蓮の最小数
+        ///
+        /// AI は前後の蓮を結んで経路を作るため、蓮が1つだけのステージは遊べません。
+        static const int LargeLotusCountMin = 2;
+
         /// ステージのマップを生成します。
         static void Setup(int aNumber, Stage& aStage, Random& aRandom);
+        /// 負荷試験用に、ステージへ CPU キャラを追加します。
+        static void AddCrowd(int aNumber, int aCharaCount, Stage& aStage, Random& aRandom);
+        /// 負荷試験用に、大きなステージのマップを生成します。
+        static void SetupLarge(const IntVec2& aGridSize, int aLotusCount, const Vec2& aFlowVel, Stage& aStage, Random& aRandom);
+        /// フィールドのステージ生成用グリッドサイズを取得します。
+        static float FieldGridSize();
 
     private:
         LevelDesigner();
@@ -54,34 +54,59 @@ namespace {
 namespace hpc {
 
     //------------------------------------------------------------------------------
-    /// クラスのインスタンスを生成します。
+    /// インスタンス内の領域を使うグリッドを生成します。
     ///
-    /// 値はすべてゼロで初期化されます。
-    LevelGrid::Cell::Cell()
-        : index(0)
-        , pos()
-        , isOccupied(false)
+    /// @param[in]     aSize グリッドのサイズ。1辺 CellSizeMax まで。
+    /// @param[in]     aInhibitMargin 領域確保禁止マージン。
+    /// @param[in,out] aRand 乱数オブジェクト。
+    LevelGrid::LevelGrid(const IntVec2& aSize, const int aInhibitMargin, Random& aRand)
+        : mSize(aSize)
+        , mSurface(mSize.x * mSize.y)
+        , mRowWordCount(1)
+        , mRandom(aRand)
+        , mRandArray(mLocalRandArray)
+        , mRowBits(mLocalRowBits)
+        , mSearchCursorCount(0)
     {
+        HPC_RANGE_ASSERT_MIN_MAX_I(mSize.x, 1, CellSizeMax);
+        HPC_RANGE_ASSERT_MIN_MAX_I(mSize.y, 1, CellSizeMax);
+        setup(aInhibitMargin);
     }
 
     //------------------------------------------------------------------------------
-    /// クラスのインスタンスを生成します。
+    /// 渡された作業領域を使うグリッドを生成します。
+    ///
+    /// 同じ大きさなら、インスタンス内の領域を使う場合と同じ乱数の使い方・同じ配置になります。
     ///
-    /// @param[in]     aSize グリッドのサイズ。
+    /// @param[in]     aSize グリッドのサイズ。1辺 LevelGridStorage::CellSizeMax まで。
     /// @param[in]     aInhibitMargin 領域確保禁止マージン。
     /// @param[in,out] aRand 乱数オブジェクト。
-    LevelGrid::LevelGrid(const IntVec2& aSize, const int aInhibitMargin, Random& aRand)
+    /// @param[in,out] aStorage 作業領域。グリッドを使い終わるまで、他のグリッドに渡さないでください。
+    LevelGrid::LevelGrid(const IntVec2& aSize, const int aInhibitMargin, Random& aRand, LevelGridStorage& aStorage)
         : mSize(aSize)
         , mSurface(mSize.x * mSize.y)
+        , mRowWordCount((mSize.x + 31) / 32)
         , mRandom(aRand)
+        , mRandArray(aStorage.randArray)
+        , mRowBits(aStorage.rowBits)
+        , mSearchCursorCount(0)
     {
-        HPC_RANGE_ASSERT_MIN_MAX_I(mSize.x, 1, CellSizeMax);
-        HPC_RANGE_ASSERT_MIN_MAX_I(mSize.y, 1, CellSizeMax);
+        HPC_RANGE_ASSERT_MIN_MAX_I(mSize.x, 1, LevelGridStorage::CellSizeMax);
+        HPC_RANGE_ASSERT_MIN_MAX_I(mSize.y, 1, LevelGridStorage::CellSizeMax);
+        setup(aInhibitMargin);
+    }
 
+    //------------------------------------------------------------------------------
+    /// 乱数配列を生成し、領域確保禁止マージンに該当する範囲を確保済みにします。
+    ///
+    /// @param[in] aInhibitMargin 領域確保禁止マージン。
+    void LevelGrid::setup(const int aInhibitMargin)
+    {
+        for (int word = 0; word < mSize.y * mRowWordCount; ++word) {
+            mRowBits[word] = 0;
+        }
         for (int index = 0; index < mSurface; ++index) {
-            mCells[index].pos = indexToAxis(index);
-            mCells[index].index = index;
-            mRandArray[index] = &mCells[index];
+            mRandArray[index] = index;
         }
         // 乱数配列の生成
         ShuffleArray(mRandArray, mSurface, mRandom);
@@ -113,11 +138,9 @@ namespace hpc {
     /// @param[in] aY セルの y 座標
     void LevelGrid::setOccupied(int aX, int aY)
     {
-        const int index = axisToIndex(aX, aY);
-        HPC_ASSERT(mCells[index].pos.x == aX);
-        HPC_ASSERT(mCells[index].pos.y == aY);
-
-        mCells[index].isOccupied = true;
+        HPC_RANGE_ASSERT_MIN_UB_I(aX, 0, mSize.x);
+        HPC_RANGE_ASSERT_MIN_UB_I(aY, 0, mSize.y);
+        mRowBits[aY * mRowWordCount + (aX >> 5)] |= 1u << (aX & 31);
     }
 
     //------------------------------------------------------------------------------
@@ -143,24 +166,57 @@ namespace hpc {
     /// 引数に与えた aWidth × aHeight の矩形に対し、
     /// セルを確保できるかどうか検査し、確保可能な場合はその左下を表すインデックスを返します。
     ///
+    /// ランダムな並び順で最初に見つかったセルを返します。
+    /// 同じ大きさで前回探索したときに確保できなかったセルは、調べ直さずに飛ばします。
+    ///
     /// @param[in] aWidth   占有する横幅。
     /// @param[in] aHeight  占有する高さ。
     ///
-    /// @return 利用可能な乱数値をもつセルのインデックス。
-    int LevelGrid::findAvailableRandCell(int aWidth, int aHeight)const
+    /// @return 利用可能な乱数値をもつセルのインデックス。見つからなければ -1 を返します。
+    int LevelGrid::findAvailableRandCell(int aWidth, int aHeight)
     {
-        for (int index = 0; index < mSurface; ++index) {
-            // 利用不可能なら次へ
-            if (mRandArray[index]->isOccupied) {
-                continue;
-            }
+        const int cursorIndex = searchCursorIndex(aWidth, aHeight);
+        const int first = 0 <= cursorIndex ? mSearchCursors[cursorIndex] : 0;
+        for (int index = first; index < mSurface; ++index) {
             // 占有可能か調べる
-            if (isAvailable(mRandArray[index]->pos.x, mRandArray[index]->pos.y, aWidth, aHeight)) {
-                return mRandArray[index]->index;
+            const IntVec2 pos = indexToAxis(mRandArray[index]);
+            if (isAvailable(pos.x, pos.y, aWidth, aHeight)) {
+                if (0 <= cursorIndex) {
+                    mSearchCursors[cursorIndex] = index;
+                }
+                return mRandArray[index];
             }
         }
-        HPC_SHOULD_NOT_REACH_HERE();
-        return 0;
+        if (0 <= cursorIndex) {
+            mSearchCursors[cursorIndex] = mSurface;
+        }
+        return -1;
+    }
+
+    //------------------------------------------------------------------------------
+    /// aWidth × aHeight の矩形を探索するときに、 mRandArray のどこから調べればよいかを保持する
+    /// mSearchCursors の番号を返します。
+    ///
+    /// 初めての大きさなら、先頭から調べるよう登録します。
+    ///
+    /// @param[in] aWidth   探索する矩形の横幅。
+    /// @param[in] aHeight  探索する矩形の高さ。
+    ///
+    /// @return mSearchCursors の番号。登録できる数を超えた場合は -1 を返し、探索のたびに先頭から調べます。
+    int LevelGrid::searchCursorIndex(int aWidth, int aHeight)
+    {
+        const IntVec2 size(aWidth, aHeight);
+        for (int index = 0; index < mSearchCursorCount; ++index) {
+            if (mSearchSizes[index] == size) {
+                return index;
+            }
+        }
+        if (mSearchCursorCount >= SearchCursorCountMax) {
+            return -1;
+        }
+        mSearchSizes[mSearchCursorCount] = size;
+        mSearchCursors[mSearchCursorCount] = 0;
+        return mSearchCursorCount++;
     }
 
     //------------------------------------------------------------------------------
@@ -169,11 +225,7 @@ namespace hpc {
     /// @return 取得した位置を表す IntVec2 
     IntVec2 LevelGrid::setRandomOccupied()
     {
-        const int index = findAvailableRandCell(1, 1);
-        HPC_ASSERT(!mCells[index].isOccupied);
-        mCells[index].isOccupied = true;
-
-        return mCells[index].pos;
+        return setRandomOccupied(1, 1);
     }
 
     //------------------------------------------------------------------------------
@@ -186,20 +238,36 @@ namespace hpc {
     /// @return 取得した箇所の左下端を表す IntVec2
     IntVec2 LevelGrid::setRandomOccupied(int aWidth, int aHeight)
     {
-        const int index = findAvailableRandCell(aWidth, aHeight);
-        const IntVec2 pos = mCells[index].pos;
-        for (int ix = pos.x; ix < pos.x + aWidth; ++ix) {
-            for (int iy = pos.y; iy < pos.y + aHeight; ++iy) {
-                HPC_RANGE_ASSERT_MIN_UB_I(ix, 0, mSize.x);
-                HPC_RANGE_ASSERT_MIN_UB_I(iy, 0, mSize.y);
-                const int cellIndex = axisToIndex(ix, iy);
-                HPC_ASSERT(!mCells[cellIndex].isOccupied);
-                mCells[cellIndex].isOccupied = true;
-            }
+        IntVec2 pos;
+        if (!trySetRandomOccupied(aWidth, aHeight, pos)) {
+            HPC_SHOULD_NOT_REACH_HERE();
         }
         return pos;
     }
 
+    //------------------------------------------------------------------------------
+    /// セルのうち、aWidth × aHeight サイズのセルを確保可能であれば確保して
+    /// その位置を求めます。
+    ///
+    /// 確保できるかどうかわからない大きさや数を扱う場合に使います。
+    ///
+    /// @param[in]  aWidth  確保するセルの横幅。
+    /// @param[in]  aHeight 確保するセルの高さ。
+    /// @param[out] aPos    取得した箇所の左下端。確保できなかった場合は変更しません。
+    ///
+    /// @return 確保できた場合は @c true を返します。
+    bool LevelGrid::trySetRandomOccupied(int aWidth, int aHeight, IntVec2& aPos)
+    {
+        const int index = findAvailableRandCell(aWidth, aHeight);
+        if (index < 0) {
+            return false;
+        }
+        aPos = indexToAxis(index);
+        HPC_ASSERT(isAvailable(aPos.x, aPos.y, aWidth, aHeight));
+        setOccupied(aPos.x, aPos.y, aWidth, aHeight);
+        return true;
+    }
+
     //------------------------------------------------------------------------------
     /// 引数に渡した位置 (aX, aY) が利用可能かどうかを返します。
     ///
@@ -214,11 +282,7 @@ namespace hpc {
             return false;
         }
 
-        const Cell& cell = mCells[axisToIndex(aX, aY)];
-        HPC_ASSERT(cell.pos.x == aX);
-        HPC_ASSERT(cell.pos.y == aY);
-
-        return !cell.isOccupied;
+        return (mRowBits[aY * mRowWordCount + (aX >> 5)] & (1u << (aX & 31))) == 0;
     }
 
     //------------------------------------------------------------------------------
@@ -236,12 +300,46 @@ namespace hpc {
         HPC_RANGE_ASSERT_MIN_UB_I(aY, 0, mSize.y);
         HPC_LB_ASSERT_I(aWidth, 0);
         HPC_LB_ASSERT_I(aHeight, 0);
-        for (int ix = aX; ix < aX + aWidth; ++ix) {
-            for (int iy = aY; iy < aY + aHeight; ++iy) {
-                if (!isAvailable(ix, iy)) {
-                    return false;
-                }
+        if (aWidth == 0 || aHeight == 0) {
+            return true;
+        }
+        // 範囲外にはみ出す場合
+        if (mSize.x < aX + aWidth || mSize.y < aY + aHeight) {
+            return false;
+        }
+        
+        // 各行の、矩形にかかるビットがすべて空いているか調べる
+        for (int iy = aY; iy < aY + aHeight; ++iy) {
+            if (!isRowAvailable(aX, iy, aWidth)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 行 aY のうち、 aX から aWidth 個のセルがすべて利用可能かどうかを返します。
+    ///
+    /// 範囲はグリッドに収まっている必要があります。
+    ///
+    /// @param[in] aX     検査する範囲の左端の x 座標
+    /// @param[in] aY     検査する行の y 座標
+    /// @param[in] aWidth 検査する範囲の横幅。 1 以上。
+    ///
+    /// @return 利用可能なら @c true を返し、そうでなければ @c false を返します。
+    bool LevelGrid::isRowAvailable(int aX, int aY, int aWidth)const
+    {
+        const uint* const row = &mRowBits[aY * mRowWordCount];
+        const int right = aX + aWidth;
+        for (int x = aX; x < right; ) {
+            // uint 1つに収まる分ずつ調べる
+            const int bit = x & 31;
+            const int bitCount = Math::Min(32 - bit, right - x);
+            const uint mask = (bitCount == 32 ? ~0u : (1u << bitCount) - 1u) << bit;
+            if ((row[x >> 5] & mask) != 0) {
+                return false;
             }
+            x += bitCount;
         }
         return true;
     }
@@ -12,45 +12,78 @@
 
 #include "HPCIntVec2.hpp"
 #include "HPCRandom.hpp"
+#include "HPCTypes.hpp"
 
 namespace hpc {
 
+    //------------------------------------------------------------------------------
+    /// 大きな LevelGrid が使う作業領域です。
+    ///
+    /// new, delete を使うことは出来ないので、保持できる最大の大きさの領域を持ちます。
+    /// 大きいので、このクラスのインスタンスは static な変数として用意してください。
+    struct LevelGridStorage
+    {
+        static const int CellSizeMax = 1024;                    ///< グリッドの1辺の最大数
+        static const int RowWordCountMax = CellSizeMax / 32;    ///< 1行のビット列の uint の数の最大値
+
+        int randArray[CellSizeMax * CellSizeMax];               ///< ランダムな並び順
+        uint rowBits[CellSizeMax * RowWordCountMax];            ///< 行ごとの、使用中のセルを表すビット列
+    };
+
     //------------------------------------------------------------------------------
     /// マップ生成のためのグリッドを提供します。
     ///
     /// グリッドの位置は左下を原点とした (0, 0) からはじまる xy 要素で表されます。
     /// 但し、内部データとしては各セルは通し番号をもつ一次元の配列として保持されます。
+    ///
+    /// 矩形が空いているかを行ごとのビット列でまとめて調べ、
+    /// ランダムな並び順の探索は、確保する大きさごとに前回の続きから再開します。
+    /// セルは使用中になるだけで空くことはないので、一度確保できなかった位置は以後も確保できません。
+    ///
+    /// 1辺が CellSizeMax までのグリッドはインスタンス内の領域を使います。
+    /// それより大きなグリッドは、 LevelGridStorage を渡して生成してください。
     class LevelGrid
     {
     public:
+        static const int CellSizeMax = 26; ///< インスタンス内の領域で扱えるグリッドの最大数
+
         LevelGrid(const IntVec2& aSize, int aInhibitMargin, Random& aRand);
+        LevelGrid(const IntVec2& aSize, int aInhibitMargin, Random& aRand, LevelGridStorage& aStorage);
 
         void setOccupied(int x, int y);                             ///< 一点を使用状態にマークします。
         void setOccupied(int x, int y, int width, int height);      ///< 矩形を使用状態にマークします。
         IntVec2 setRandomOccupied();                                ///< 開いているところ一点をランダムでマークします。
         IntVec2 setRandomOccupied(int width, int height);           ///< 開いているところを指定サイズの矩形でランダムにマークします。
+        /// 開いているところがあれば、指定サイズの矩形でランダムにマークします。
+        bool trySetRandomOccupied(int width, int height, IntVec2& pos);
         bool isAvailable(int x, int y)const;                        ///< 一点が空いているかを返します。
         bool isAvailable(int x, int y, int width, int hegith)const; ///< 指定サイズの矩形が空いているかを返します。
 
     private:
-        static const int CellSizeMax = 26; ///< グリッドの最大数
-
-        /// グリッドの各セル情報を表します。
-        struct Cell {
-            Cell();
-            
-            int index;              ///< セルのインデックス (通し番号)
-            IntVec2 pos;            ///< セルの位置
-            bool isOccupied;        ///< 占有されているかどうか
-        };
+        static const int SearchCursorCountMax = 8; ///< 前回の続きから探索できる、確保する大きさの種類の最大数
 
         const IntVec2 mSize;        ///< 縦横の長さ
         const int mSurface;         ///< 面積 (セルの総数)。
+        const int mRowWordCount;    ///< 1行のビット列の uint の数
         Random& mRandom;
-        Cell mCells[CellSizeMax * CellSizeMax];          ///< グリッドの各セル
-        Cell* mRandArray[CellSizeMax * CellSizeMax];     ///< ランダムな並び順。
+        int* mRandArray;            ///< ランダムな並び順。セルのインデックスを持ちます。
+        uint* mRowBits;             ///< 行ごとの、使用中のセルを表すビット列。 x 番目のビットが x 座標のセル。
+        int mLocalRandArray[CellSizeMax * CellSizeMax];  ///< インスタンス内のランダムな並び順の領域
+        uint mLocalRowBits[CellSizeMax];                 ///< インスタンス内の行ごとのビット列の領域
+        IntVec2 mSearchSizes[SearchCursorCountMax];      ///< 探索した矩形の大きさ
+        int mSearchCursors[SearchCursorCountMax];        ///< 大きさごとの、次に調べる mRandArray の位置
+        int mSearchCursorCount;                          ///< 探索した矩形の大きさの種類の数
+
+        /// インスタンス内の領域では、1行を uint 1つのビット列で表す
+        typedef char CellSizeMaxCheck[CellSizeMax <= 32 ? 1 : -1];
+
+        LevelGrid(const LevelGrid& aGrid);              ///< コピーはできません。
+        LevelGrid& operator=(const LevelGrid& aGrid);   ///< コピーはできません。
 
-        int findAvailableRandCell(int width, int height)const;  ///< 利用可能なセルを探します。
+        void setup(int aInhibitMargin);                         ///< 乱数配列と確保禁止範囲を用意します。
+        int findAvailableRandCell(int width, int height);       ///< 利用可能なセルを探します。
+        int searchCursorIndex(int width, int height);           ///< 探索を再開する位置の番号を返します。
+        bool isRowAvailable(int x, int y, int width)const;      ///< 1行のうち指定範囲が空いているかを返します。
         int axisToIndex(int x, int y)const;                     ///< 座標をインデックスに変換します。
         IntVec2 indexToAxis(int index)const;                    ///< インデックスを座標に変換します。
     };
@@ -11,6 +11,7 @@
 
 #include "HPCLotusCollection.hpp"
 
+#include "HPCCollision.hpp"
 #include "HPCCommon.hpp"
 #include "HPCStage.hpp"
 
@@ -21,6 +22,8 @@ namespace hpc {
     LotusCollection::LotusCollection()
         : mLotuses()
         , mCount(0)
+        , mGrid()
+        , mGridCount(0)
     {
     }
 
@@ -37,6 +40,8 @@ namespace hpc {
         }
         
         mCount = aRhs.count();
+        mGrid = aRhs.mGrid;
+        mGridCount = aRhs.mGridCount;
     }
 
     //------------------------------------------------------------------------------
@@ -44,20 +49,34 @@ namespace hpc {
     /// 有効な蓮数は 0 となります。
     void LotusCollection::reset()
     {
-        for (int index = 0; index < Parameter::LotusCountMax; ++index) {
+        for (int index = 0; index < Parameter::LotusCapacity; ++index) {
             mLotuses[index].reset();
         }
         mCount = 0;
+        mGrid.reset();
+        mGridCount = 0;
     }
 
     //------------------------------------------------------------------------------
     /// 蓮を追加します。
     ///
+    /// グリッドには登録しないので、すべて追加したら setupEnd() を呼び出してください。
     void LotusCollection::setupAddLotus(const Vec2& aLotusPos, const float aRadius)
     {
+        HPC_RANGE_ASSERT_MIN_UB_I(mCount, 0, Parameter::LotusCapacity);
         mLotuses[mCount++].reset(aLotusPos, aRadius);
     }
 
+    //------------------------------------------------------------------------------
+    /// 蓮の追加を終え、追加したすべての蓮をグリッドに登録します。
+    ///
+    /// 追加するたびに作り直すと蓮の数の2乗に比例する時間がかかるため、最後に一度だけ構成します。
+    void LotusCollection::setupEnd()
+    {
+        mGrid.build(mLotuses, mCount);
+        mGridCount = mCount;
+    }
+
     //------------------------------------------------------------------------------
     /// @return 現在有効な蓮数
     int LotusCollection::count()const
@@ -65,6 +84,32 @@ namespace hpc {
         return mCount;
     }
 
+    //------------------------------------------------------------------------------
+    /// 移動する円と衝突する蓮を、すべての蓮の中から求めます。
+    ///
+    /// グリッドで候補を絞り込んでから、候補ごとに Collision::IsHit() で判定します。
+    /// 結果は、すべての蓮について Collision::IsHit() を呼んだ場合と一致します。
+    ///
+    /// @param[in] aRegion  移動前の円。
+    /// @param[in] aPos     移動後の円の中心。
+    ///
+    /// @return 衝突する蓮の番号の集合。
+    LotusBits LotusCollection::hitBits(const Circle& aRegion, const Vec2& aPos)const
+    {
+        HPC_ASSERT_MSG(mGridCount == mCount, "setupEnd() is not called after adding lotuses.");
+        const LotusBits candidates = mGrid.candidateBits(aRegion.pos(), aPos, aRegion.radius());
+        LotusBits bits;
+        for (int word = 0; word < LotusBits::WordCount; ++word) {
+            uint wordBits = candidates.words[word];
+            for (int index = word * 32; wordBits != 0; ++index, wordBits >>= 1) {
+                if ((wordBits & 1u) != 0 && Collision::IsHit(mLotuses[index].region(), aRegion, aPos)) {
+                    bits.add(index);
+                }
+            }
+        }
+        return bits;
+    }
+
     //------------------------------------------------------------------------------
     /// @param[in] aIndex 有効な蓮のインデックス。
     ///
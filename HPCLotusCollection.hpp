@@ -10,8 +10,11 @@
 //------------------------------------------------------------------------------
 #pragma once
 
+#include "HPCCircle.hpp"
 #include "HPCLotus.hpp"
+#include "HPCLotusGrid.hpp"
 #include "HPCParameter.hpp"
+#include "HPCTypes.hpp"
 #include "HPCVec2.hpp"
 
 namespace hpc {
@@ -23,6 +26,10 @@ namespace hpc {
     ///
     /// 1ステージのすべての蓮は、この LotusCollection クラスに
     /// 格納されます。
+    ///
+    /// 蓮は LotusGrid にも登録され、移動したキャラがどの蓮を通過したかを
+    /// 蓮の数によらずほぼ一定の時間で求められます。
+    /// グリッドは setupEnd() でまとめて構成するので、蓮をすべて追加したら呼び出してください。
     class LotusCollection
     {
     public:
@@ -31,8 +38,10 @@ namespace hpc {
         void set(const LotusCollection& aRhs);              ///< 蓮データを設定します。
         void reset();                                       ///< 蓮データを初期化します。
         void setupAddLotus(const Vec2& aPos, float aRadius);///< 蓮を追加します。
+        void setupEnd();                                    ///< 蓮の追加を終え、グリッドを構成します。
 
         int count()const;                                   ///< 有効な蓮数を返します。
+        LotusBits hitBits(const Circle& aRegion, const Vec2& aPos)const; ///< 移動する円と衝突する蓮を返します。
 
         /// @name 有効な蓮へのアクセス
         //@{
@@ -41,8 +50,10 @@ namespace hpc {
         //@}
 
     private:
-        Lotus mLotuses[Parameter::LotusCountMax];   ///< 蓮用配列
+        Lotus mLotuses[Parameter::LotusCapacity];   ///< 蓮用配列
         int mCount;                                 ///< 蓮数
+        LotusGrid mGrid;                            ///< 蓮を登録したグリッド
+        int mGridCount;                             ///< グリッドに登録した蓮数
     };
 }
 //------------------------------------------------------------------------------
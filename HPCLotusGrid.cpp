@@ -0,0 +1,200 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    HPCLotusGrid.hpp の実装
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+
+#include "HPCLotusGrid.hpp"
+
+#include "HPCCommon.hpp"
+#include "HPCLevelDesigner.hpp"
+#include "HPCMath.hpp"
+
+namespace {
+
+    /// 問い合わせる範囲を広げる、セルの大きさに対する割合
+    // 衝突判定の計算誤差で、外接矩形の外側でも衝突とみなされる場合があるので、少し余裕を持たせる
+    const float QueryMarginRate = 1.0f / 16.0f;
+}
+
+namespace hpc {
+
+    //------------------------------------------------------------------------------
+    /// 空の集合を生成します。
+    LotusBits::LotusBits()
+    {
+        clear();
+    }
+
+    //------------------------------------------------------------------------------
+    /// 空の集合にします。
+    void LotusBits::clear()
+    {
+        for (int word = 0; word < WordCount; ++word) {
+            words[word] = 0;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// 蓮を加えます。
+    ///
+    /// @param[in] aIndex 加える蓮の番号。
+    void LotusBits::add(int aIndex)
+    {
+        HPC_RANGE_ASSERT_MIN_UB_I(aIndex, 0, Parameter::LotusCapacity);
+        words[aIndex >> 5] |= 1u << (aIndex & 31);
+    }
+
+    //------------------------------------------------------------------------------
+    /// 別の集合の蓮をすべて加えます。
+    ///
+    /// @param[in] aBits 加える集合。
+    void LotusBits::merge(const LotusBits& aBits)
+    {
+        for (int word = 0; word < WordCount; ++word) {
+            words[word] |= aBits.words[word];
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// @param[in] aIndex 調べる蓮の番号。
+    ///
+    /// @return aIndex 番目の蓮を含むかどうか。
+    bool LotusBits::contains(int aIndex)const
+    {
+        HPC_RANGE_ASSERT_MIN_UB_I(aIndex, 0, Parameter::LotusCapacity);
+        return (words[aIndex >> 5] & (1u << (aIndex & 31))) != 0;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 蓮が1つもないグリッドを生成します。
+    LotusGrid::LotusGrid()
+        : mOrigin()
+        , mCellSize(1.0f)
+        , mWidth(1)
+        , mHeight(1)
+        , mCells()
+    {
+    }
+
+    //------------------------------------------------------------------------------
+    /// 蓮が1つもない状態にします。
+    void LotusGrid::reset()
+    {
+        mOrigin = Vec2();
+        mCellSize = 1.0f;
+        mWidth = 1;
+        mHeight = 1;
+        mCells[0].clear();
+    }
+
+    //------------------------------------------------------------------------------
+    /// 蓮を登録し直します。
+    ///
+    /// グリッドの範囲は、すべての蓮の外接矩形を囲むように決めます。
+    /// 1辺のセル数が CellCountMax を超える場合は、セルを大きくします。
+    ///
+    /// @param[in] aLotuses 蓮の配列。
+    /// @param[in] aCount   蓮の数。
+    void LotusGrid::build(const Lotus* aLotuses, int aCount)
+    {
+        HPC_RANGE_ASSERT_MIN_MAX_I(aCount, 0, Parameter::LotusCapacity);
+        reset();
+        if (aCount == 0) {
+            return;
+        }
+
+        Vec2 minPos = aLotuses[0].pos();
+        Vec2 maxPos = aLotuses[0].pos();
+        for (int index = 0; index < aCount; ++index) {
+            const Lotus& lotus = aLotuses[index];
+            minPos.x = Math::Min(minPos.x, lotus.pos().x - lotus.radius());
+            minPos.y = Math::Min(minPos.y, lotus.pos().y - lotus.radius());
+            maxPos.x = Math::Max(maxPos.x, lotus.pos().x + lotus.radius());
+            maxPos.y = Math::Max(maxPos.y, lotus.pos().y + lotus.radius());
+        }
+        const float extent = Math::Max(maxPos.x - minPos.x, maxPos.y - minPos.y);
+        mOrigin = minPos;
+        mCellSize = Math::Max(LevelDesigner::FieldGridSize(), extent / CellCountMax);
+        mWidth = Math::LimitMinMax(Math::Ceil((maxPos.x - minPos.x) / mCellSize), 1, CellCountMax);
+        mHeight = Math::LimitMinMax(Math::Ceil((maxPos.y - minPos.y) / mCellSize), 1, CellCountMax);
+        for (int cell = 0; cell < mWidth * mHeight; ++cell) {
+            mCells[cell].clear();
+        }
+
+        for (int index = 0; index < aCount; ++index) {
+            const Lotus& lotus = aLotuses[index];
+            const int left = cellX(lotus.pos().x - lotus.radius());
+            const int right = cellX(lotus.pos().x + lotus.radius());
+            const int bottom = cellY(lotus.pos().y - lotus.radius());
+            const int top = cellY(lotus.pos().y + lotus.radius());
+            for (int y = bottom; y <= top; ++y) {
+                for (int x = left; x <= right; ++x) {
+                    mCells[y * mWidth + x].add(index);
+                }
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// 線分を aRadius だけ広げた範囲と重なるかもしれない蓮を求めます。
+    ///
+    /// 線分の外接矩形を広げた範囲のセルを調べるので、 1 ターンの移動のような
+    /// 短い線分であれば、蓮の数によらずほぼ一定の時間で求まります。
+    ///
+    /// @param[in] aPos0    線分の始点。
+    /// @param[in] aPos1    線分の終点。
+    /// @param[in] aRadius  範囲を広げる大きさ。キャラの半径など。
+    ///
+    /// @return 範囲と重なるかもしれない蓮の番号の集合。
+    ///         実際に重なる蓮はすべて含まれます。
+    LotusBits LotusGrid::candidateBits(const Vec2& aPos0, const Vec2& aPos1, float aRadius)const
+    {
+        const float margin = aRadius + mCellSize * QueryMarginRate;
+        const int left = cellX(Math::Min(aPos0.x, aPos1.x) - margin);
+        const int right = cellX(Math::Max(aPos0.x, aPos1.x) + margin);
+        const int bottom = cellY(Math::Min(aPos0.y, aPos1.y) - margin);
+        const int top = cellY(Math::Max(aPos0.y, aPos1.y) + margin);
+        LotusBits bits;
+        for (int y = bottom; y <= top; ++y) {
+            for (int x = left; x <= right; ++x) {
+                bits.merge(mCells[y * mWidth + x]);
+            }
+        }
+        return bits;
+    }
+
+    //------------------------------------------------------------------------------
+    /// @param[in] aX x 座標。
+    ///
+    /// @return aX を含むセルの列。範囲の外なら端の列を返します。
+    int LotusGrid::cellX(float aX)const
+    {
+        const float cell = (aX - mOrigin.x) / mCellSize;
+        if (!(cell > 0.0f)) {
+            return 0;
+        }
+        return cell < mWidth ? static_cast<int>(cell) : mWidth - 1;
+    }
+
+    //------------------------------------------------------------------------------
+    /// @param[in] aY y 座標。
+    ///
+    /// @return aY を含むセルの行。範囲の外なら端の行を返します。
+    int LotusGrid::cellY(float aY)const
+    {
+        const float cell = (aY - mOrigin.y) / mCellSize;
+        if (!(cell > 0.0f)) {
+            return 0;
+        }
+        return cell < mHeight ? static_cast<int>(cell) : mHeight - 1;
+    }
+}
+
+//------------------------------------------------------------------------------
+// EOF
@@ -0,0 +1,77 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    LotusGrid クラス
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "HPCLotus.hpp"
+#include "HPCParameter.hpp"
+#include "HPCTypes.hpp"
+#include "HPCVec2.hpp"
+
+namespace hpc {
+
+    //------------------------------------------------------------------------------
+    /// 蓮の番号の集合を、番号ごとに1ビットで表します。
+    ///
+    /// index 番目の蓮は、 words[index / 32] の (1 << (index % 32)) で表します。
+    /// 蓮の数の上限が 32 以下なら、 uint 1つ分の大きさです。
+    struct LotusBits
+    {
+        static const int WordCount = (Parameter::LotusCapacity + 31) / 32; ///< ビット列の uint の数
+
+        LotusBits();
+
+        void clear();                               ///< 空の集合にします。
+        void add(int aIndex);                       ///< 蓮を加えます。
+        void merge(const LotusBits& aBits);         ///< 別の集合の蓮をすべて加えます。
+        bool contains(int aIndex)const;             ///< 蓮を含むかを返します。
+
+        uint words[WordCount];                      ///< ビット列
+    };
+
+    //------------------------------------------------------------------------------
+    /// 蓮を格子状のセルに登録し、ある範囲と重なるかもしれない蓮を素早く求めます。
+    ///
+    /// セルの大きさは、ステージ生成のグリッドと同じ LevelDesigner::FieldGridSize() です。
+    /// 各セルには、そのセルと外接矩形が重なる蓮の番号をビットの集合で持ちます。
+    /// 範囲の外の座標は端のセルに含めるので、蓮の外に出たキャラについても正しく求まります。
+    ///
+    /// 求まるのは候補であり、実際に重なるかどうかは呼び出し側で判定してください。
+    class LotusGrid
+    {
+    public:
+        static const int CellCountMax = 32;         ///< 1辺のセル数の最大値
+
+        LotusGrid();
+
+        void reset();                               ///< 蓮が1つもない状態にします。
+        void build(const Lotus* aLotuses, int aCount); ///< 蓮を登録し直します。
+
+        /// 線分を aRadius だけ広げた範囲と重なるかもしれない蓮の番号を、ビットの集合で返します。
+        LotusBits candidateBits(const Vec2& aPos0, const Vec2& aPos1, float aRadius)const;
+
+    private:
+        int cellX(float aX)const;                  ///< x 座標を含むセルの列を返します。
+        int cellY(float aY)const;                  ///< y 座標を含むセルの行を返します。
+
+        /// 蓮の数の上限は、ゲームのルールの最大数以上で、セルごとの集合が大きくなりすぎない程度に抑える。
+        typedef char LotusCapacityCheck[
+            Parameter::LotusCountMax <= Parameter::LotusCapacity && Parameter::LotusCapacity <= 1024 ? 1 : -1
+            ];
+
+        Vec2 mOrigin;                               ///< 左下のセルの左下の座標
+        float mCellSize;                            ///< セルの1辺の長さ
+        int mWidth;                                 ///< 横のセル数
+        int mHeight;                                ///< 縦のセル数
+        LotusBits mCells[CellCountMax * CellCountMax]; ///< セルごとの蓮の番号の集合
+    };
+}
+//------------------------------------------------------------------------------
+// EOF
@@ -9,9 +9,18 @@
 
 //------------------------------------------------------------------------------
 
+#include <cstdlib>
 #include <cstring>
+#include "HPCBatchRunner.hpp"
+#include "HPCBatchStats.hpp"
 #include "HPCCommon.hpp"
+#include "HPCLevelDesigner.hpp"
+#include "HPCParallelRunner.hpp"
+#include "HPCProfiler.hpp"
+#include "HPCModelCheck.hpp"
+#include "HPCSimdCheck.hpp"
 #include "HPCSimulation.hpp"
+#include "HPCStageCache.hpp"
 
 //------------------------------------------------------------------------------
 namespace {
@@ -21,12 +30,51 @@ namespace {
         Operation_NoDebug,                  ///< デバッグなし
         Operation_OutputJson,               ///< JSON の出力
         Operation_OutputJsonCompressed,     ///< 圧縮された JSON の出力
+        Operation_OutputReplay,             ///< リプレイファイルの出力
+        Operation_ConvertReplay,            ///< リプレイファイルから JSON への変換
+        Operation_ConvertReplayCompressed,  ///< リプレイファイルから圧縮された JSON への変換
+        Operation_DebugReplay,              ///< リプレイファイルのデバッグ
+        Operation_Batch,                    ///< 複数のシードによる実行
+        Operation_Crowd,                    ///< 人数を増やしたステージの実行
+        Operation_Large,                    ///< 大きなステージの実行
+        Operation_SimdCheck,                ///< まとめて計算する関数と先読みに使う計算の検証
 
         Operation_TERM
     };
+
+    //------------------------------------------------------------------------------
+    /// 操作種類がステージの実行を必要とするかどうかを返します。
+    bool NeedsRun(Operation aOperation)
+    {
+        return aOperation != Operation_ConvertReplay
+            && aOperation != Operation_ConvertReplayCompressed
+            && aOperation != Operation_DebugReplay;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 引数をステージ番号として読み取ります。
+    ///
+    /// @param[in] aText        引数。
+    /// @param[out] aStageIndex 読み取ったステージ番号。
+    ///
+    /// @return 有効なステージ番号であれば @c true を返します。
+    bool ParseStageIndex(const char* aText, int& aStageIndex)
+    {
+        char* end = 0;
+        const long value = std::strtol(aText, &end, 10);
+        if (end == aText || *end != '\0' || value < 0 || hpc::Parameter::GameStageCount <= value) {
+            return false;
+        }
+        aStageIndex = static_cast<int>(value);
+        return true;
+    }
+
     // new, delete を使うことは出来ないので static な変数として
     // Simulation クラスを用意します。
     hpc::Simulation sSim;
+    hpc::SeedList sSeeds;               ///< -b で実行するシードの一覧
+    hpc::BatchResultWriter sResultWriter; ///< -b の実行結果の書き出し先
+    hpc::BatchStats sBatchStats;        ///< -b の実行結果の集計
 }
 
 //------------------------------------------------------------------------------
@@ -40,35 +88,321 @@ namespace {
 ///  ------------|----------------------------------------------
 ///   -n         | デバッグを行いません。
 ///   -j         | デバッグを行わず、結果を JSON で出力します。
+///   -r [file]  | デバッグを行わず、結果をリプレイファイル file に出力します。
+///   -rj [file] | 実行せずに、リプレイファイル file を JSON に変換して出力します。
+///   -rjd [file]| -rj と同様ですが、整形された JSON を出力します。
+///   -rd [file] | 実行せずに、リプレイファイル file をデバッガで参照します。
+///   -w [N]     | ステージを N 個のワーカーで並列に実行します。 0 の場合はプロセッサ数を使用します。
+///   -p         | 処理ごとの実行時間を計測し、最後に集計を標準エラー出力に表示します。
+///   -sc        | キャラ同士の衝突を、移動中も含めて連続的に判定します。
+///   -cd [dir]  | 生成したステージをディレクトリ dir に保存し、同じシードでは生成せずに読み込みます。結果は指定しない場合と同じです。
+///   -b [file]  | シードの一覧 file の各シードで実行し、ステージごとの結果を CSV で出力します。
+///              | 最後に、得点と実行時間の集計を標準エラー出力に表示します。
+///   -sr [A] [B]| -b で実行するステージを、 A から B までに限定します。
+///   -o [file]  | -b の結果を、標準出力の代わりに CSV 形式でファイル file に出力します。
+///   -ob [file] | -b の結果を、バイナリ形式でファイル file に出力します。
+///   -cr [N]    | 各ステージを CPU キャラを加えた N 人で、記録せずに実行し、ステージごとの実行時間を CSV で出力します。
+///              | N の上限は Parameter::CharaCapacity で、ビルド時に HPC_CHARA_CAPACITY で変更できます。
+///   -ls [W H L]| 横 W 、縦 H グリッドのフィールドに蓮を L 個置いたステージを、記録せずに実行し、
+///              | ステージごとの生成時間と実行時間を CSV で出力します。
+///              | L は 2 以上で、上限は Parameter::LotusCapacity です。上限はビルド時に HPC_LOTUS_CAPACITY で変更できます。
+///   -lf [X] [Y]| -ls のフィールドの流れる速度を (X, Y) にします。指定しない場合は流れません。
+///   -st        | 実行せずに、 SIMD 命令でまとめて計算する関数がスカラー版と一致するかと、
+///              | 先読みに使う計算とステージの状態の復元が、1ターンずつ進めた結果と一致するかを調べます。
+///              | 一致しなければ 1 を返します。詳細は SimdCheck, ModelCheck を参照してください。
+///
+/// -w, -p, -sc, -cd は他のオプションと組み合わせて指定できます。
+/// -sc はゲームのルールとは異なる判定になるため、結果も指定しない場合とは異なります。
+/// -sr, -o, -ob は -b と組み合わせて指定します。 -sr は -cr, -ls とも組み合わせられます。
+/// -ls に -sr を組み合わせた場合、ステージ番号は生成し直す回数を数えるだけに使います。
+/// シードの一覧と結果の形式は SeedList, BatchResultFormat を参照してください。
+/// -w と -b は、ゲーム用の乱数をステージごとに独立した乱数列に分けて使用するため、ワーカー数によらず同じ結果になります。
+/// ただし、全ステージで1つの乱数列を続けて使う、 -w も -b も指定しない実行とは結果が異なります。
+/// 順に実行する場合の各ステージ開始時の乱数の状態は、前のステージを最後まで実行しないと決まらないためです。
+/// 評価と同じ得点を確かめるときは、 -w を指定せずに実行してください。
+/// -b に -w を組み合わせると、ワーカーが異常終了しても、そのワーカーが実行中だった分担だけを除いて実行を続けます。
 ///
 int main(int argc, const char* argv[])
 {
     Operation operation = Operation_Normal;
-    
-    // 引数は 1 つまで有効。
-    if (argc > 2) {
-        HPC_PRINT("Invalid Argument.\n");
-        return 0;
-    }
+    int workerCount = -1;   // 負の値の場合は並列に実行しない。
+    bool doProfile = false;
+    const char* fileName = 0;
+    int firstStage = 0;
+    int lastStage = hpc::Parameter::GameStageCount - 1;
+    const char* resultFileName = 0;
+    hpc::BatchResultFormat resultFormat = hpc::BatchResultFormat_Csv;
+    bool hasBatchOption = false;    // -b と組み合わせるオプションが指定されたか
+    bool hasStageRange = false;     // -sr が指定されたか
+    int crowdCharaCount = 0;
+    hpc::IntVec2 largeGridSize;
+    int largeLotusCount = 0;
+    hpc::Vec2 largeFlowVel;
+    bool hasLargeFlow = false;      // -lf が指定されたか
+
     // 引数がある場合、引数を記録する。
-    else if (argc > 1) {
-        if (!std::strcmp(argv[1], "-n")) {
+    // 操作種類を表す引数は 1 つまで有効。
+    bool hasOperation = false;
+    for (int index = 1; index < argc; ++index) {
+        if (!std::strcmp(argv[index], "-w")) {
+            if (index + 1 >= argc) {
+                HPC_PRINT("Invalid Argument: -w requires the number of workers.\n");
+                return 0;
+            }
+            ++index;
+            workerCount = std::atoi(argv[index]);
+            if (workerCount < 0) {
+                HPC_PRINT("Invalid Argument: %s is invalid number of workers.\n", argv[index]);
+                return 0;
+            }
+            if (workerCount == 0) {
+                workerCount = hpc::ParallelRunner::DefaultWorkerCount();
+            }
+            continue;
+        }
+        if (!std::strcmp(argv[index], "-p")) {
+            doProfile = true;
+            continue;
+        }
+        if (!std::strcmp(argv[index], "-sc")) {
+            sSim.setSweptCollision(true);
+            continue;
+        }
+        if (!std::strcmp(argv[index], "-cd")) {
+            if (index + 1 >= argc) {
+                HPC_PRINT("Invalid Argument: -cd requires a directory name.\n");
+                return 0;
+            }
+            ++index;
+            hpc::StageCache::SetDirectory(argv[index]);
+            continue;
+        }
+        if (!std::strcmp(argv[index], "-sr")) {
+            if (index + 2 >= argc) {
+                HPC_PRINT("Invalid Argument: -sr requires the first and last stage.\n");
+                return 0;
+            }
+            if (
+                !ParseStageIndex(argv[index + 1], firstStage)
+                || !ParseStageIndex(argv[index + 2], lastStage)
+                || lastStage < firstStage
+            ) {
+                HPC_PRINT("Invalid Argument: %s %s is invalid stage range.\n", argv[index + 1], argv[index + 2]);
+                return 0;
+            }
+            index += 2;
+            hasStageRange = true;
+            continue;
+        }
+        if (!std::strcmp(argv[index], "-lf")) {
+            if (index + 2 >= argc) {
+                HPC_PRINT("Invalid Argument: -lf requires the flow velocity X and Y.\n");
+                return 0;
+            }
+            largeFlowVel = hpc::Vec2(
+                static_cast<float>(std::atof(argv[index + 1]))
+                , static_cast<float>(std::atof(argv[index + 2]))
+                );
+            index += 2;
+            hasLargeFlow = true;
+            continue;
+        }
+        if (!std::strcmp(argv[index], "-o") || !std::strcmp(argv[index], "-ob")) {
+            if (index + 1 >= argc) {
+                HPC_PRINT("Invalid Argument: %s requires a file name.\n", argv[index]);
+                return 0;
+            }
+            resultFormat = std::strcmp(argv[index], "-o") ? hpc::BatchResultFormat_Binary : hpc::BatchResultFormat_Csv;
+            ++index;
+            resultFileName = argv[index];
+            hasBatchOption = true;
+            continue;
+        }
+
+        if (hasOperation) {
+            HPC_PRINT("Invalid Argument.\n");
+            return 0;
+        }
+        hasOperation = true;
+        if (!std::strcmp(argv[index], "-n")) {
             operation = Operation_NoDebug;
         }
-        else if (!std::strcmp(argv[1], "-j")) {
+        else if (!std::strcmp(argv[index], "-j")) {
             operation = Operation_OutputJsonCompressed;
         }
-        else if (!std::strcmp(argv[1], "-jd")) {
+        else if (!std::strcmp(argv[index], "-jd")) {
             operation = Operation_OutputJson;
         }
+        else if (!std::strcmp(argv[index], "-r")) {
+            operation = Operation_OutputReplay;
+        }
+        else if (!std::strcmp(argv[index], "-rj")) {
+            operation = Operation_ConvertReplayCompressed;
+        }
+        else if (!std::strcmp(argv[index], "-rjd")) {
+            operation = Operation_ConvertReplay;
+        }
+        else if (!std::strcmp(argv[index], "-rd")) {
+            operation = Operation_DebugReplay;
+        }
+        else if (!std::strcmp(argv[index], "-b")) {
+            operation = Operation_Batch;
+        }
+        else if (!std::strcmp(argv[index], "-cr")) {
+            operation = Operation_Crowd;
+            if (index + 1 >= argc) {
+                HPC_PRINT("Invalid Argument: -cr requires the number of charas.\n");
+                return 0;
+            }
+            ++index;
+            crowdCharaCount = std::atoi(argv[index]);
+            if (crowdCharaCount < hpc::Parameter::CharaCountMin || hpc::Parameter::CharaCapacity < crowdCharaCount) {
+                HPC_PRINT(
+                    "Invalid Argument: %s is invalid number of charas (%d - %d).\n"
+                    , argv[index]
+                    , hpc::Parameter::CharaCountMin
+                    , hpc::Parameter::CharaCapacity
+                    );
+                return 0;
+            }
+        }
+        else if (!std::strcmp(argv[index], "-st")) {
+            operation = Operation_SimdCheck;
+        }
+        else if (!std::strcmp(argv[index], "-ls")) {
+            operation = Operation_Large;
+            if (index + 3 >= argc) {
+                HPC_PRINT("Invalid Argument: -ls requires the grid width, height and the number of lotuses.\n");
+                return 0;
+            }
+            largeGridSize = hpc::IntVec2(std::atoi(argv[index + 1]), std::atoi(argv[index + 2]));
+            largeLotusCount = std::atoi(argv[index + 3]);
+            const int sizeMin = hpc::LevelDesigner::LargeGridSizeMin;
+            const int sizeMax = hpc::LevelDesigner::LargeGridSizeMax;
+            if (
+                largeGridSize.x < sizeMin || sizeMax < largeGridSize.x
+                || largeGridSize.y < sizeMin || sizeMax < largeGridSize.y
+            ) {
+                HPC_PRINT(
+                    "Invalid Argument: %s %s is invalid grid size (%d - %d).\n"
+                    , argv[index + 1]
+                    , argv[index + 2]
+                    , sizeMin
+                    , sizeMax
+                    );
+                return 0;
+            }
+            const int lotusCountMin = hpc::LevelDesigner::LargeLotusCountMin;
+            if (largeLotusCount < lotusCountMin || hpc::Parameter::LotusCapacity < largeLotusCount) {
+                HPC_PRINT(
+                    "Invalid Argument: %s is invalid number of lotuses (%d - %d).\n"
+                    , argv[index + 3]
+                    , lotusCountMin
+                    , hpc::Parameter::LotusCapacity
+                    );
+                return 0;
+            }
+            index += 3;
+        }
         else {
-            HPC_PRINT("Invalid Argument: %s is unknown command.\n", argv[1]);
+            HPC_PRINT("Invalid Argument: %s is unknown command.\n", argv[index]);
             return 0;
         }
+
+        // ファイルを扱う操作は、ファイル名を続けて指定する。
+        if (
+            operation == Operation_OutputReplay
+            || operation == Operation_ConvertReplay
+            || operation == Operation_ConvertReplayCompressed
+            || operation == Operation_DebugReplay
+            || operation == Operation_Batch
+        ) {
+            if (index + 1 >= argc) {
+                HPC_PRINT("Invalid Argument: %s requires a file name.\n", argv[index]);
+                return 0;
+            }
+            ++index;
+            fileName = argv[index];
+        }
+    }
+    if (hasBatchOption && operation != Operation_Batch) {
+        HPC_PRINT("Invalid Argument: -o and -ob require -b.\n");
+        return 0;
+    }
+    if (hasStageRange && operation != Operation_Batch && operation != Operation_Crowd && operation != Operation_Large) {
+        HPC_PRINT("Invalid Argument: -sr requires -b, -cr or -ls.\n");
+        return 0;
+    }
+    if (hasLargeFlow && operation != Operation_Large) {
+        HPC_PRINT("Invalid Argument: -lf requires -ls.\n");
+        return 0;
     }
+
     // プログラムの実行
     {
-        sSim.run();
+        hpc::Profiler::SetEnabled(doProfile);
+        if (operation == Operation_SimdCheck) {
+            const bool isSimdMatched = hpc::SimdCheck::Run();
+            const bool isModelMatched = hpc::ModelCheck::Run();
+            return isSimdMatched && isModelMatched ? 0 : 1;
+        }
+        if (operation == Operation_DebugReplay) {
+            // ファイル全体は読み込まず、デバッガから必要な記録だけを参照する。
+            if (!sSim.debugReplay(fileName)) {
+                HPC_PRINT("Failed to read the replay file: %s\n", fileName);
+                return 1;
+            }
+            return 0;
+        }
+        if (operation == Operation_Batch) {
+            if (!sSeeds.load(fileName)) {
+                HPC_PRINT("Failed to read the seed list: %s (line %d)\n", fileName, sSeeds.errorLine());
+                return 1;
+            }
+            const bool isOpened = resultFileName != 0
+                ? sResultWriter.open(resultFileName, resultFormat)
+                : sResultWriter.openStdout();
+            if (!isOpened) {
+                HPC_PRINT("Failed to write the result file: %s\n", resultFileName);
+                return 1;
+            }
+            sSim.runBatch(workerCount, sSeeds, firstStage, lastStage, sResultWriter, sBatchStats);
+            if (!sResultWriter.close()) {
+                HPC_PRINT("Failed to write the result file: %s\n", resultFileName != 0 ? resultFileName : "stdout");
+                return 1;
+            }
+            sBatchStats.print();
+            if (doProfile) {
+                sSim.outputProfile();
+            }
+            return 0;
+        }
+        if (operation == Operation_Crowd) {
+            sSim.runCrowd(crowdCharaCount, firstStage, lastStage);
+            if (doProfile) {
+                sSim.outputProfile();
+            }
+            return 0;
+        }
+        if (operation == Operation_Large) {
+            sSim.runLarge(largeGridSize, largeLotusCount, largeFlowVel, firstStage, lastStage);
+            if (doProfile) {
+                sSim.outputProfile();
+            }
+            return 0;
+        }
+        if (!NeedsRun(operation)) {
+            if (!sSim.loadReplay(fileName)) {
+                HPC_PRINT("Failed to read the replay file: %s\n", fileName);
+                return 1;
+            }
+        }
+        else if (workerCount < 0) {
+            sSim.run();
+        }
+        else {
+            sSim.runParallel(workerCount);
+        }
 
         switch (operation) {
         case Operation_Normal:
@@ -85,13 +419,30 @@ int main(int argc, const char* argv[])
             break;
 
         case Operation_OutputJsonCompressed:
+        case Operation_ConvertReplayCompressed:
             sSim.outputJson(true);
             break;
 
+        case Operation_ConvertReplay:
+            sSim.outputJson(false);
+            break;
+
+        case Operation_OutputReplay:
+            sSim.outputResult();
+            if (!sSim.outputReplay(fileName)) {
+                HPC_PRINT("Failed to write the replay file: %s\n", fileName);
+                return 1;
+            }
+            break;
+
         default:
             HPC_SHOULD_NOT_REACH_HERE();
             break;
         }
+
+        if (doProfile) {
+            sSim.outputProfile();
+        }
     }
 
     return 0;
@@ -0,0 +1,328 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    HPCModelCheck.hpp の実装
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+
+#include "HPCModelCheck.hpp"
+
+#include <cstring>
+#include "HPCCircle.hpp"
+#include "HPCCollision.hpp"
+#include "HPCCommon.hpp"
+#include "HPCLevelDesigner.hpp"
+#include "HPCMath.hpp"
+#include "HPCParameter.hpp"
+#include "HPCRandom.hpp"
+#include "HPCRandomSeed.hpp"
+#include "HPCRandomSet.hpp"
+#include "HPCStage.hpp"
+#include "HPCTurnResult.hpp"
+#include "HPCVec2.hpp"
+
+namespace hpc {
+
+    // Answer.cpp で定義します。
+    Vec2 AnswerTrajectoryPos(const Vec2& aPos, const Vec2& aVel, const Vec2& aFlowVel, int aTurn);
+    int AnswerTrajectoryTurnInRegion(const Vec2& aPos, const Vec2& aVel, const Vec2& aFlowVel, const Circle& aRegion, int aMaxTurn);
+    int AnswerTrajectoryContactTurn(const Vec2& aPos0, const Vec2& aVel0, const Vec2& aPos1, const Vec2& aVel1, const Vec2& aFlowVel, int aMaxTurn);
+}
+
+namespace {
+
+    using namespace hpc;
+
+    /// 座標を取る範囲の大きさ
+    const int CoordRange = 128;
+
+    /// 速さの最大値
+    const float SpeedMax = 2.0f;
+
+    /// 1/64 刻みの値の分母
+    const float CoordUnit = 64.0f;
+
+    /// 蓮の半径の最大値
+    const float RegionRadiusMax = 8.0f;
+
+    /// 軌道から蓮までの距離を、半径の和からずらす幅の最大値（ RegionOffsetUnit 分の1単位）
+    const int RegionOffsetRange = 256;
+
+    /// 軌道から蓮までの距離をずらす幅の分母
+    const float RegionOffsetUnit = 4096.0f;
+
+    /// 2人目と重なるかを調べるターン数の最大値（ GetNextAction が敵を調べるターン数）
+    const int ContactTurnMax = 5;
+
+    // new, delete を使うことは出来ないので static な変数として用意します。
+    Stage sStage;                                               ///< 状態の保存と復元を調べるステージ
+    StageSnapshot sSnapshot;                                    ///< 保存した状態
+    TurnResult sSavedResult;                                    ///< 保存した時点の TurnResult
+    TurnResult sTurnResults[ModelCheck::SnapshotTurnCount];     ///< 保存した状態から進めた各ターンの TurnResult
+
+    //------------------------------------------------------------------------------
+    /// GetNextAction が予想する、アクセルを踏まなかった場合の aTurn ターン後の位置を1ターンずつ求めます。
+    ///
+    /// 1ターン目は今の速度で、2ターン目からは「今の速さ - CharaDecelSpeed」の速さで、流れとあわせて進みます。
+    /// 今の速さを CharaDecelSpeed で割ったターン数（切り捨て）で止まり、その後は動きません。
+    Vec2 StepTrajectoryPos(const Vec2& aPos, const Vec2& aVel, const Vec2& aFlowVel, int aTurn)
+    {
+        const float speed = aVel.length();
+        const int turnCount = Math::Min(aTurn, static_cast<int>(speed / Parameter::CharaDecelSpeed()));
+        Vec2 pos = aPos;
+        Vec2 vel = aVel;
+        for (int turn = 1; turn <= turnCount; ++turn) {
+            pos = pos + vel + aFlowVel;
+            vel.normalize();
+            vel *= speed - Parameter::CharaDecelSpeed();
+        }
+        return pos;
+    }
+
+    //------------------------------------------------------------------------------
+    /// StepTrajectoryPos() の位置で1ターンずつ移動を IsHit で調べて、 aMaxTurn ターン以内で初めて aRegion に触れるターンを求めます。
+    ///
+    /// @return 触れるターン。止まるまでに触れなければ -1 。
+    int StepTrajectoryTurnInRegion(const Vec2& aPos, const Vec2& aVel, const Vec2& aFlowVel, const Circle& aRegion, int aMaxTurn)
+    {
+        const int turnCount = Math::Min(aMaxTurn, static_cast<int>(aVel.length() / Parameter::CharaDecelSpeed()));
+        Vec2 prevPos = aPos;
+        for (int turn = 1; turn <= turnCount; ++turn) {
+            const Vec2 pos = StepTrajectoryPos(aPos, aVel, aFlowVel, turn);
+            if (Collision::IsHit(aRegion, Circle(prevPos, Parameter::CharaRadius()), pos)) {
+                return turn;
+            }
+            prevPos = pos;
+        }
+        return -1;
+    }
+
+    //------------------------------------------------------------------------------
+    /// StepTrajectoryPos() の位置で1ターンずつ IsHit で調べて、 aMaxTurn ターン以内のターンの終わりで初めて2人が重なるターンを求めます。
+    ///
+    /// @return 重なるターン。重ならなければ -1 。
+    int StepTrajectoryContactTurn(const Vec2& aPos0, const Vec2& aVel0, const Vec2& aPos1, const Vec2& aVel1, const Vec2& aFlowVel, int aMaxTurn)
+    {
+        const float charaRadius = Parameter::CharaRadius();
+        for (int turn = 1; turn <= aMaxTurn; ++turn) {
+            const Vec2 pos0 = StepTrajectoryPos(aPos0, aVel0, aFlowVel, turn);
+            const Vec2 pos1 = StepTrajectoryPos(aPos1, aVel1, aFlowVel, turn);
+            if (Collision::IsHit(Circle(pos0, charaRadius), Circle(pos1, charaRadius))) {
+                return turn;
+            }
+        }
+        return -1;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 乱数で作った位置と速度から、 Answer.cpp の予想を、1ターンずつ求めた予想とビット単位で比べます。
+    ///
+    /// 位置は、止まった後の数ターンまでを比べます。
+    /// 蓮に触れるターンは、軌道のどこかの位置から蓮の半径とキャラの半径の和に近い距離に蓮を置いて、
+    /// 境界の近くで結果がずれないかを比べます。
+    /// 2人目と重なるターンも同じく、2人目がどこかのターンで1人目からキャラの直径に近い距離にいるようにして比べます。
+    /// 流れの速度は LevelDesigner が作るものと同じく、 0 か、 y 方向に 1/64 刻みの値にします。
+    ///
+    /// @return 一致しなかったものがあれば 1 、なければ 0 。
+    int CheckTrajectory(int aCase, Random& aRandom)
+    {
+        const Vec2 startPos(
+            aRandom.randTerm(CoordRange * static_cast<int>(CoordUnit)) / CoordUnit
+            , aRandom.randTerm(CoordRange * static_cast<int>(CoordUnit)) / CoordUnit
+            );
+        Vec2 startVel(aRandom.randTerm(static_cast<int>(SpeedMax * CoordUnit) + 1) / CoordUnit, 0.0f);
+        startVel.rotate(Math::DegToRad(static_cast<float>(aRandom.randTerm(360))));
+        const int flowLevel = aRandom.randTerm(6);
+        const Vec2 flowVel(0.0f, flowLevel == 0 ? 0.0f : (flowLevel + 2) / CoordUnit);
+
+        // 止まった後に動かないことを確かめるため、少し先まで調べる
+        const int stopTurn = static_cast<int>(startVel.length() / Parameter::CharaDecelSpeed());
+        for (int turn = 0; turn <= stopTurn + 4; ++turn) {
+            const Vec2 expected = StepTrajectoryPos(startPos, startVel, flowVel, turn);
+            const Vec2 pos = AnswerTrajectoryPos(startPos, startVel, flowVel, turn);
+            if (pos.x != expected.x || pos.y != expected.y) {
+                HPC_PRINT(
+                    "  Trajectory: case %d, turn %d: (%a, %a) (%a, %a) (%a, %a) -> (%a, %a) expected (%a, %a)\n"
+                    , aCase
+                    , turn
+                    , startPos.x
+                    , startPos.y
+                    , startVel.x
+                    , startVel.y
+                    , flowVel.x
+                    , flowVel.y
+                    , pos.x
+                    , pos.y
+                    , expected.x
+                    , expected.y
+                    );
+                return 1;
+            }
+        }
+
+        const float regionRadius = 1.0f + aRandom.randTerm(static_cast<int>(RegionRadiusMax * CoordUnit)) / CoordUnit;
+        Vec2 toRegion(
+            Parameter::CharaRadius() + regionRadius
+            + (aRandom.randTerm(2 * RegionOffsetRange + 1) - RegionOffsetRange) / RegionOffsetUnit
+            , 0.0f
+            );
+        toRegion.rotate(Math::DegToRad(static_cast<float>(aRandom.randTerm(360))));
+        const Vec2 regionPos = StepTrajectoryPos(startPos, startVel, flowVel, aRandom.randTerm(stopTurn + 1)) + toRegion;
+        const Circle region(regionPos, regionRadius);
+        const int maxTurn = aRandom.randTerm(stopTurn + 3);
+        const int expectedTurn = StepTrajectoryTurnInRegion(startPos, startVel, flowVel, region, maxTurn);
+        const int turn = AnswerTrajectoryTurnInRegion(startPos, startVel, flowVel, region, maxTurn);
+        if (turn != expectedTurn) {
+            HPC_PRINT(
+                "  Trajectory::firstTurnInRegion: case %d: (%a, %a) (%a, %a) (%a, %a) (%a, %a) %a %d -> %d expected %d\n"
+                , aCase
+                , startPos.x
+                , startPos.y
+                , startVel.x
+                , startVel.y
+                , flowVel.x
+                , flowVel.y
+                , regionPos.x
+                , regionPos.y
+                , regionRadius
+                , maxTurn
+                , turn
+                , expectedTurn
+                );
+            return 1;
+        }
+
+        Vec2 otherVel(aRandom.randTerm(static_cast<int>(SpeedMax * CoordUnit) + 1) / CoordUnit, 0.0f);
+        otherVel.rotate(Math::DegToRad(static_cast<float>(aRandom.randTerm(360))));
+        Vec2 toOther(
+            Parameter::CharaRadius() * 2.0f
+            + (aRandom.randTerm(2 * RegionOffsetRange + 1) - RegionOffsetRange) / RegionOffsetUnit
+            , 0.0f
+            );
+        toOther.rotate(Math::DegToRad(static_cast<float>(aRandom.randTerm(360))));
+        // 2人目がcontactTurnターン後に1人目の近くにいるように、そこから速度を逆にたどった位置から始める
+        const int contactTurn = 1 + aRandom.randTerm(ContactTurnMax);
+        const Vec2 otherPos = StepTrajectoryPos(startPos, startVel, flowVel, contactTurn) + toOther
+            - (StepTrajectoryPos(Vec2(), otherVel, flowVel, contactTurn));
+        const int contactMaxTurn = 1 + aRandom.randTerm(ContactTurnMax + 2);
+        const int expectedContactTurn = StepTrajectoryContactTurn(startPos, startVel, otherPos, otherVel, flowVel, contactMaxTurn);
+        const int contactTurnResult = AnswerTrajectoryContactTurn(startPos, startVel, otherPos, otherVel, flowVel, contactMaxTurn);
+        if (contactTurnResult != expectedContactTurn) {
+            HPC_PRINT(
+                "  Trajectory::firstContactTurn: case %d: (%a, %a) (%a, %a) (%a, %a) (%a, %a) (%a, %a) %d -> %d expected %d\n"
+                , aCase
+                , startPos.x
+                , startPos.y
+                , startVel.x
+                , startVel.y
+                , otherPos.x
+                , otherPos.y
+                , otherVel.x
+                , otherVel.y
+                , flowVel.x
+                , flowVel.y
+                , contactMaxTurn
+                , contactTurnResult
+                , expectedContactTurn
+                );
+            return 1;
+        }
+        return 0;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 2つの TurnResult が、ステージにいるキャラの分だけビット単位で一致するかを返します。
+    bool IsSameTurnResult(const TurnResult& aLhs, const TurnResult& aRhs, int aCharaCount)
+    {
+        return aLhs.state == aRhs.state
+            && std::memcmp(aLhs.charas, aRhs.charas, sizeof(aLhs.charas[0]) * aCharaCount) == 0;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 1つのステージで、保存した状態から進めた結果と、復元してから進めた結果を比べます。
+    ///
+    /// ステージは LevelDesigner が作るものを順番に使います。
+    /// 比べるターン数は、ステージがその前に終わった場合はそこまでです。
+    ///
+    /// @return 一致しなかったターンがあれば 1 、なければ 0 。
+    int CheckSnapshot(int aStageIndex, RandomSet& aRandSet)
+    {
+        LevelDesigner::Setup(aStageIndex, sStage, aRandSet.system());
+        sStage.start();
+        Random& random = aRandSet.game();
+        for (int turn = 0; turn < ModelCheck::SnapshotWarmupTurnCount; ++turn) {
+            if (sStage.lastTurnResult().state != StageState_Playing) {
+                break;
+            }
+            sStage.runTurn(random);
+        }
+
+        sStage.saveSnapshot(sSnapshot, random);
+        sSavedResult.set(sStage.lastTurnResult());
+        int turnCount = 0;
+        while (turnCount < ModelCheck::SnapshotTurnCount && sStage.lastTurnResult().state == StageState_Playing) {
+            sStage.runTurn(random);
+            sTurnResults[turnCount].set(sStage.lastTurnResult());
+            ++turnCount;
+        }
+
+        sStage.restoreSnapshot(sSnapshot, random);
+        const int charaCount = sStage.charas().count();
+        for (int turn = 0; turn <= turnCount; ++turn) {
+            if (turn > 0) {
+                sStage.runTurn(random);
+            }
+            const TurnResult& expected = turn == 0 ? sSavedResult : sTurnResults[turn - 1];
+            if (!IsSameTurnResult(sStage.lastTurnResult(), expected, charaCount)) {
+                HPC_PRINT("  Snapshot: stage %d, turn %d after the snapshot\n", aStageIndex, turn);
+                return 1;
+            }
+        }
+        return 0;
+    }
+}
+
+namespace hpc {
+
+    //------------------------------------------------------------------------------
+    /// すべての計算を調べ、計算ごとの結果を表示します。
+    ///
+    /// 一致しなかったケースは、入力の値とともに表示します。
+    ///
+    /// @return すべての結果が一致した場合は @c true 。
+    bool ModelCheck::Run()
+    {
+        const RandomSeed seed;
+        Random random(seed.x, seed.y);
+        int mismatchCount = 0;
+        for (int caseIndex = 0; caseIndex < TrajectoryCaseCount; ++caseIndex) {
+            mismatchCount += CheckTrajectory(caseIndex, random);
+        }
+        HPC_PRINT(
+            "%-30s %d cases, %d mismatches\n"
+            , "Trajectory"
+            , TrajectoryCaseCount
+            , mismatchCount
+            );
+
+        RandomSet randSet(seed);
+        int snapshotMismatchCount = 0;
+        for (int stageIndex = 0; stageIndex < SnapshotStageCount; ++stageIndex) {
+            snapshotMismatchCount += CheckSnapshot(stageIndex, randSet);
+        }
+        HPC_PRINT(
+            "%-30s %d stages, %d mismatches\n"
+            , "Stage::restoreSnapshot"
+            , SnapshotStageCount
+            , snapshotMismatchCount
+            );
+        return mismatchCount == 0 && snapshotMismatchCount == 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+// EOF
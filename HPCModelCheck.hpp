@@ -0,0 +1,50 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    ModelCheck クラス
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+#pragma once
+
+namespace hpc {
+
+    //------------------------------------------------------------------------------
+    /// 先読みに使う計算が、1ターンずつ進めた結果と一致するかを調べます。
+    ///
+    /// 調べる計算は以下のとおりです。
+    ///
+    ///   計算                          | 比べる相手
+    ///  -------------------------------|----------------------------------------------
+    ///   アクセルを踏まない軌道の予想  | GetNextAction が予想する移動と減速を1ターンずつ行った位置
+    ///   予想した軌道が蓮に触れるターン| 上の位置で1ターン分の移動ごとに Collision::IsHit で調べた結果
+    ///   予想した軌道で敵と重なるターン| 上の位置で各ターンの終わりに Collision::IsHit で調べた結果
+    ///   状態の保存と復元              | Stage::saveSnapshot() で保存してから進めた各ターンの TurnResult
+    ///
+    /// 軌道の予想は、 Answer.cpp が定義する AnswerTrajectoryPos(), AnswerTrajectoryTurnInRegion(), AnswerTrajectoryContactTurn() を呼び出して、
+    /// Answer.cpp の Trajectory そのものを調べます。結果はビット単位で比べます。
+    ///
+    /// 状態の保存と復元は、ステージを SnapshotWarmupTurnCount ターン進めて保存し、
+    /// SnapshotTurnCount ターン進めた結果と、復元してから同じだけ進めた結果をビット単位で比べます。
+    /// 回答者の Answer が内部に持つ状態は復元されないので、同じ状態から同じ動作を返す Answer が前提です。
+    ///
+    /// SimdCheck と同じく、決まったシードの乱数で入力を作るので、毎回同じ入力で調べます。
+    class ModelCheck
+    {
+    public:
+        static const int TrajectoryCaseCount = 20000;   ///< 軌道を調べる回数
+        static const int SnapshotStageCount = 10;       ///< 状態の保存と復元を調べるステージ数
+        static const int SnapshotWarmupTurnCount = 20;  ///< 状態を保存するまでに進めるターン数
+        static const int SnapshotTurnCount = 50;        ///< 保存した状態から進めて比べるターン数
+
+        static bool Run();  ///< すべての計算を調べ、結果を表示します。
+
+    private:
+        ModelCheck();
+    };
+}
+//------------------------------------------------------------------------------
+// EOF
@@ -0,0 +1,435 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    HPCParallelRunner.hpp の実装
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+
+#include "HPCParallelRunner.hpp"
+
+#include <cstdio>
+#include "HPCCommon.hpp"
+#include "HPCLevelDesigner.hpp"
+#include "HPCMath.hpp"
+#include "HPCProfiler.hpp"
+#include "HPCReplay.hpp"
+#include "HPCStageCache.hpp"
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define HPC_PARALLEL_RUNNER_USE_FORK
+#endif
+
+namespace {
+    using namespace hpc;
+
+    // new, delete を使うことは出来ないので static な変数として用意します。
+    // ワーカーとして動くプロセスは、それぞれこれらの複製を使用します。
+    Stage sStage;                                           ///< 実行用のステージ
+    Stage sScratchStage;                                    ///< 乱数導出用のステージ
+    RecordStage sRecordStage;                               ///< 実行用の記録
+    unsigned char sRecordArenaBuffer[TurnStream::ArenaSizeMax]; ///< 実行用の記録の、ターンごとの記録を格納する領域
+    Arena sRecordArena(sRecordArenaBuffer, sizeof(sRecordArenaBuffer)); ///< sRecordArenaBuffer から確保する Arena
+    RandomSet sStageRandSets[Parameter::GameStageCount];    ///< ステージごとの乱数
+    ReplayWriter sRecordWriter;                             ///< 実行結果への記録の書き込み用
+    /// 呼び出し元のプロセスで実行する仕事の実行結果。 double の配列にして 8 バイト境界に揃えます。
+    double sResultBuffer[(ParallelRunner::ResultSizeMax + sizeof(double) - 1) / sizeof(double)];
+
+    //------------------------------------------------------------------------------
+    /// Run() の仕事として、1つのステージを実行し、記録をリプレイファイルの1ステージ分の形式で書き込みます。
+    ///
+    /// RecordStage はターンごとの記録をプロセスごとの領域に格納するため、この形式に変換して受け渡します。
+    int RunStageJob(int aJobIndex, const Timer& aGameTimer, void* aResult, void*)
+    {
+        const RecordStage& record = ParallelRunner::RunScratchStage(aJobIndex, aGameTimer);
+        sRecordWriter.open(aResult, ParallelRunner::ResultSizeMax);
+        record.writeReplay(sRecordWriter);
+        const int size = sRecordWriter.position();
+        return sRecordWriter.close() ? size : -1;
+    }
+
+    //------------------------------------------------------------------------------
+    /// Run() の仕事の実行結果を読み込み、 aContext の Record に記録します。
+    void CommitStageJob(int aJobIndex, const void* aResult, int aResultSize, void* aContext)
+    {
+        HPC_ASSERT_MSG(aResult != 0, "Stage #%d is not recorded", aJobIndex);
+        sRecordArena.reset();
+        ReplayReader reader(aResult, aResultSize);
+        const bool isRead = sRecordStage.readReplay(reader);
+        HPC_ASSERT_MSG(isRead, "Stage #%d has a broken record", aJobIndex);
+        static_cast<Record*>(aContext)->writeStage(aJobIndex, sRecordStage);
+    }
+
+    //------------------------------------------------------------------------------
+    /// 呼び出し元のプロセスで、 aFirstJobIndex 以降の仕事を順番に実行します。
+    ///
+    /// ゲームのタイマーを共有しない場合は、ゲームの最初の仕事で CPU 時間のタイマーを開始します。
+    void RunJobsSerial(const ParallelJobs& aJobs, int aFirstJobIndex)
+    {
+        Timer gameTimer(Parameter::GameTimeLimitSec);
+        for (int index = aFirstJobIndex; index < aJobs.jobCount; ++index) {
+            if (index == aFirstJobIndex || index % aJobs.gameJobCount == 0) {
+                gameTimer.start();
+            }
+            const Timer& timer = aJobs.gameTimer != 0 ? *aJobs.gameTimer : gameTimer;
+            const int size = aJobs.run(index, timer, sResultBuffer, aJobs.context);
+            aJobs.commit(index, size >= 0 ? sResultBuffer : 0, size, aJobs.context);
+        }
+    }
+
+#ifdef HPC_PARALLEL_RUNNER_USE_FORK
+    //------------------------------------------------------------------------------
+    /// ワーカー間で共有する領域の先頭部分です。
+    struct SharedHeader
+    {
+        volatile int nextJobIndex;                              ///< 次に実行する仕事の番号
+        ProfileEntry profiles[ParallelRunner::WorkerCountMax][ProfileScope_TERM]; ///< ワーカーごとの処理時間の集計
+    };
+
+    //------------------------------------------------------------------------------
+    /// 仕事1つ分の実行結果の格納先の先頭部分です。この後に実行結果が続きます。
+    struct JobSlot
+    {
+        volatile int isDone;    ///< 実行結果を書き込み終えたか
+        int resultSize;         ///< 実行結果のバイト数
+    };
+
+    //------------------------------------------------------------------------------
+    /// バイト数を 8 バイト境界に切り上げます。
+    size_t AlignSize(size_t aSize)
+    {
+        return (aSize + 7) & ~static_cast<size_t>(7);
+    }
+
+    //------------------------------------------------------------------------------
+    /// ワーカー間で共有する領域の配置です。
+    ///
+    /// 先頭の SharedHeader の後に、ゲームごとの開始時刻と、仕事ごとの JobSlot と実行結果が続きます。
+    /// 開始時刻は Timer::MonotonicSec() のマイクロ秒単位の値で、 0 はまだ開始していないことを表します。
+    struct SharedLayout
+    {
+        unsigned char* memory;      ///< 共有する領域の先頭
+        size_t gameBeginOffset;     ///< ゲームごとの開始時刻の位置
+        size_t slotOffset;          ///< 最初の JobSlot の位置
+        size_t slotSize;            ///< JobSlot と実行結果1つ分のバイト数
+        size_t size;                ///< 共有する領域のバイト数
+
+        SharedHeader& header()const
+        {
+            return *reinterpret_cast<SharedHeader*>(memory);
+        }
+        volatile long long& gameBeginUsec(int aGameIndex)const
+        {
+            return reinterpret_cast<volatile long long*>(memory + gameBeginOffset)[aGameIndex];
+        }
+        JobSlot& slot(int aJobIndex)const
+        {
+            return *reinterpret_cast<JobSlot*>(memory + slotOffset + slotSize * aJobIndex);
+        }
+        unsigned char* result(int aJobIndex)const
+        {
+            return memory + slotOffset + slotSize * aJobIndex + AlignSize(sizeof(JobSlot));
+        }
+    };
+
+    //------------------------------------------------------------------------------
+    /// ゲームの制限時間を、実時間で判定するように開始します。
+    ///
+    /// ゲームの開始時刻はそのゲームの仕事を最初に実行したプロセスが決め、
+    /// 同じゲームの仕事を実行するワーカーはすべて同じ締め切りで判定します。
+    void StartGameTimer(Timer& aTimer, volatile long long& aBeginUsec)
+    {
+        // 0 はまだ開始していないことを表すので、必ず 1 以上にする。
+        const long long nowUsec = static_cast<long long>(Timer::MonotonicSec() * 1.0e6) + 1;
+        __sync_val_compare_and_swap(&aBeginUsec, 0LL, nowUsec);
+        aTimer.setClock(TimerClock_Wall);
+        aTimer.startAt(static_cast<double>(aBeginUsec - 1) * 1.0e-6);
+    }
+
+    //------------------------------------------------------------------------------
+    /// ワーカーとして仕事を実行します。
+    ///
+    /// 共有領域から仕事の番号を1つずつ取り出し、なくなるまで実行を続けます。
+    /// 処理時間の集計は、このワーカーで計測した分だけを共有領域に書き出します。
+    void RunWorker(const SharedLayout& aLayout, int aWorker, const ParallelJobs& aJobs)
+    {
+        // HPC_ASSERT などの出力が、呼び出し元の標準出力に混ざらないようにする。
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+        Profiler::Reset();
+        SharedHeader& header = aLayout.header();
+        while (true) {
+            const int index = __sync_fetch_and_add(&header.nextJobIndex, 1);
+            if (index >= aJobs.jobCount) {
+                break;
+            }
+            Timer gameTimer(Parameter::GameTimeLimitSec);
+            if (aJobs.gameTimer == 0) {
+                StartGameTimer(gameTimer, aLayout.gameBeginUsec(index / aJobs.gameJobCount));
+            }
+            const Timer& timer = aJobs.gameTimer != 0 ? *aJobs.gameTimer : gameTimer;
+            JobSlot& slot = aLayout.slot(index);
+            const int size = aJobs.run(index, timer, aLayout.result(index), aJobs.context);
+            if (size < 0) {
+                continue;
+            }
+            slot.resultSize = size;
+            __sync_synchronize();
+            slot.isDone = 1;
+        }
+        for (int scope = 0; scope < ProfileScope_TERM; ++scope) {
+            header.profiles[aWorker][scope] = Profiler::Entry(static_cast<ProfileScope>(scope));
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// ワーカーを生成して仕事を実行し、実行結果を仕事の番号順に受け取ります。
+    ///
+    /// ワーカーが実行しなかった仕事は、呼び出し元のプロセスで実行します。
+    /// ワーカーが異常終了して実行結果のない仕事は、 isRetried なら実行し直し、そうでなければ失敗として受け取ります。
+    ///
+    /// @return 共有する領域を用意できず、仕事を1つも実行していない場合は @c false を返します。
+    bool RunJobsForked(int aWorkerCount, const ParallelJobs& aJobs)
+    {
+        const int gameCount = (aJobs.jobCount + aJobs.gameJobCount - 1) / aJobs.gameJobCount;
+        SharedLayout layout;
+        layout.gameBeginOffset = AlignSize(sizeof(SharedHeader));
+        layout.slotOffset = layout.gameBeginOffset + AlignSize(sizeof(long long) * gameCount);
+        layout.slotSize = AlignSize(sizeof(JobSlot)) + AlignSize(aJobs.resultSizeMax);
+        layout.size = layout.slotOffset + layout.slotSize * aJobs.jobCount;
+        void* const memory = mmap(
+            0
+            , layout.size
+            , PROT_READ | PROT_WRITE
+            , MAP_SHARED | MAP_ANONYMOUS
+            , -1
+            , 0
+            );
+        if (memory == MAP_FAILED) {
+            return false;
+        }
+        // 匿名の共有領域は 0 で初期化されています。
+        layout.memory = static_cast<unsigned char*>(memory);
+        SharedHeader& header = layout.header();
+
+        // 子プロセスに出力バッファが複製されないよう、生成前に出力しておく。
+        std::fflush(stdout);
+        const int workerCount = Math::Min(aWorkerCount, Math::Min(aJobs.jobCount, static_cast<int>(ParallelRunner::WorkerCountMax)));
+        for (int worker = 0; worker < workerCount; ++worker) {
+            const pid_t pid = fork();
+            if (pid == 0) {
+                RunWorker(layout, worker, aJobs);
+                _exit(0);
+            }
+        }
+        while (wait(0) > 0) {
+        }
+        for (int worker = 0; worker < workerCount; ++worker) {
+            Profiler::Merge(header.profiles[worker]);
+        }
+
+        const int claimedCount = Math::Min(static_cast<int>(header.nextJobIndex), aJobs.jobCount);
+        for (int index = 0; index < aJobs.jobCount; ++index) {
+            const JobSlot& slot = layout.slot(index);
+            if (slot.isDone) {
+                aJobs.commit(index, layout.result(index), slot.resultSize, aJobs.context);
+                continue;
+            }
+            if (index < claimedCount && !aJobs.isRetried) {
+                aJobs.commit(index, 0, 0, aJobs.context);
+                continue;
+            }
+            Timer gameTimer(Parameter::GameTimeLimitSec);
+            if (aJobs.gameTimer == 0) {
+                StartGameTimer(gameTimer, layout.gameBeginUsec(index / aJobs.gameJobCount));
+            }
+            const Timer& timer = aJobs.gameTimer != 0 ? *aJobs.gameTimer : gameTimer;
+            const int size = aJobs.run(index, timer, sResultBuffer, aJobs.context);
+            aJobs.commit(index, size >= 0 ? sResultBuffer : 0, size, aJobs.context);
+        }
+        munmap(memory, layout.size);
+        return true;
+    }
+#endif
+}
+
+namespace hpc {
+
+    //------------------------------------------------------------------------------
+    /// 実行環境で利用できるワーカー数を返します。
+    ///
+    /// @return オンラインのプロセッサ数。取得できない場合は 1 を返します。
+    int ParallelRunner::DefaultWorkerCount()
+    {
+#ifdef HPC_PARALLEL_RUNNER_USE_FORK
+        const long count = sysconf(_SC_NPROCESSORS_ONLN);
+        if (count > 0) {
+            return count < WorkerCountMax ? static_cast<int>(count) : WorkerCountMax;
+        }
+#endif
+        return 1;
+    }
+
+    //------------------------------------------------------------------------------
+    /// ステージごとの乱数を導出します。
+    ///
+    /// システム用の乱数は、ステージ生成を順番に再現して各ステージ開始時の状態を求めます。
+    /// ゲーム用の乱数は、ステージ番号の Random::substream() を使用します。
+    /// ステージごとの区間は重ならず、ほかのステージの乱数を導出しなくても同じ値になります。
+    /// StageCache が有効な場合、ステージ生成は再現せずに保存した乱数の状態を使います。
+    ///
+    /// @param[in] aRandSet         導出元の乱数。導出した分だけ状態が進みます。
+    /// @param[out] aStageRandSets  ステージごとの乱数。 Parameter::GameStageCount 個の要素が必要です。
+    void ParallelRunner::DeriveStageRandoms(RandomSet& aRandSet, RandomSet* aStageRandSets)
+    {
+        HPC_ASSERT(aStageRandSets != 0);
+        StageCache::Prepare(aRandSet.system());
+        for (int index = 0; index < Parameter::GameStageCount; ++index) {
+            aStageRandSets[index] = RandomSet(aRandSet.system(), aRandSet.game().substream(index));
+            if (!StageCache::Advance(index, aRandSet.system())) {
+                LevelDesigner::Setup(index, sScratchStage, aRandSet.system());
+            }
+        }
+        aRandSet.game().jump(Parameter::GameStageCount, Random::SubstreamShift);
+    }
+
+    //------------------------------------------------------------------------------
+    /// 1つのステージを最初から最後まで実行し、記録します。
+    ///
+    /// @param[in] aStageIndex  ステージ番号。
+    /// @param[in] aRandSet     このステージで使用する乱数。
+    /// @param[in] aStage       実行に使用するステージ。
+    /// @param[out] aRecord     記録先。実行前にリセットされます。
+    /// @param[in] aTimer       制限時間を判定するタイマー。
+    void ParallelRunner::RunStage(
+        int aStageIndex
+        , RandomSet& aRandSet
+        , Stage& aStage
+        , RecordStage& aRecord
+        , const Timer& aTimer
+        )
+    {
+        HPC_RANGE_ASSERT_MIN_UB_I(aStageIndex, 0, Parameter::GameStageCount);
+
+        LevelDesigner::Setup(aStageIndex, aStage, aRandSet.system());
+        aStage.start();
+        aRecord.reset();
+        aRecord.writeStart(aStage);
+        aRecord.writeTurn(aStage);
+        while (aStage.lastTurnResult().state == StageState_Playing && aTimer.isInTime()) {
+            aStage.runTurn(aRandSet.game());
+            aRecord.writeTurn(aStage);
+        }
+        aRecord.writeEnd(aStage);
+    }
+
+    //------------------------------------------------------------------------------
+    /// 仕事を、ワーカーで分け合って実行します。
+    ///
+    /// ワーカーは共有する領域から仕事の番号を順に取り出して実行し、実行結果を共有する領域に書き込みます。
+    /// 実行結果は、すべてのワーカーが終了した後に、仕事の番号順に aJobs.commit に渡します。
+    ///
+    /// aJobs.gameTimer が 0 の場合、ゲームごとにそのゲームの最初の仕事を始めた時点でタイマーを開始します。
+    /// ワーカーで実行する場合は実時間で、すべてのワーカーで締め切りは共通です。
+    /// 呼び出し元のプロセスで実行する場合は CPU 時間で判定します。
+    ///
+    /// @param[in] aWorkerCount ワーカー数。1 以下の場合は呼び出し元のプロセスで実行します。
+    /// @param[in] aJobs        実行する仕事の一覧。
+    void ParallelRunner::RunJobs(int aWorkerCount, const ParallelJobs& aJobs)
+    {
+        HPC_LB_ASSERT_I(aJobs.jobCount, -1);
+        HPC_LB_ASSERT_I(aJobs.gameJobCount, 0);
+        HPC_RANGE_ASSERT_MIN_MAX_I(aJobs.resultSizeMax, 0, ResultSizeMax);
+        HPC_ASSERT(aJobs.run != 0 && aJobs.commit != 0);
+
+#ifdef HPC_PARALLEL_RUNNER_USE_FORK
+        if (aWorkerCount > 1 && RunJobsForked(aWorkerCount, aJobs)) {
+            return;
+        }
+#endif
+        RunJobsSerial(aJobs, 0);
+    }
+
+    //------------------------------------------------------------------------------
+    /// すべてのステージを実行し、結果をステージ順に記録します。
+    ///
+    /// ワーカーが異常終了した場合、そのワーカーが実行しきれなかったステージは
+    /// 呼び出し元のプロセスで実行し直します。
+    ///
+    /// @note ワーカーはコピーされた aTimer で制限時間を判定します。
+    ///       aTimer を TimerClock_Wall に設定しておけば、すべてのワーカーで締め切りは共通です。
+    ///
+    /// @param[in] aWorkerCount ワーカー数。1 以下の場合は呼び出し元のプロセスで実行します。
+    /// @param[in] aRandSet     導出元の乱数。
+    /// @param[out] aRecord     記録先。
+    /// @param[in] aTimer       制限時間を判定するタイマー。
+    /// @param[in] aIsSweptCollision キャラ同士の衝突を連続判定するなら @c true 。
+    void ParallelRunner::Run(
+        int aWorkerCount
+        , RandomSet& aRandSet
+        , Record& aRecord
+        , const Timer& aTimer
+        , bool aIsSweptCollision
+        )
+    {
+        DeriveScratchRandoms(aRandSet);
+        SetSweptCollision(aIsSweptCollision);
+        sRecordStage.setArena(sRecordArena);
+
+        ParallelJobs jobs;
+        jobs.jobCount = Parameter::GameStageCount;
+        jobs.gameJobCount = Parameter::GameStageCount;
+        jobs.resultSizeMax = ResultSizeMax;
+        jobs.gameTimer = &aTimer;
+        jobs.isRetried = true;
+        jobs.run = RunStageJob;
+        jobs.commit = CommitStageJob;
+        jobs.context = &aRecord;
+        RunJobs(aWorkerCount, jobs);
+    }
+
+    //------------------------------------------------------------------------------
+    /// RunScratchStage() で、キャラ同士の衝突を連続判定するかどうかを設定します。
+    ///
+    /// @param[in] aIsSwept 連続判定するなら @c true 。ワーカーにも引き継がれます。
+    void ParallelRunner::SetSweptCollision(bool aIsSwept)
+    {
+        sStage.charas().setSweptCollision(aIsSwept);
+    }
+
+    //------------------------------------------------------------------------------
+    /// RunScratchStage() で使う、ステージごとの乱数を導出します。
+    ///
+    /// @param[in] aRandSet 導出元の乱数。導出した分だけ状態が進みます。
+    void ParallelRunner::DeriveScratchRandoms(RandomSet& aRandSet)
+    {
+        DeriveStageRandoms(aRandSet, sStageRandSets);
+    }
+
+    //------------------------------------------------------------------------------
+    /// DeriveScratchRandoms() で導出した乱数で、1つのステージを実行します。
+    ///
+    /// 導出した乱数は変更しないので、同じステージを何度実行しても同じ結果になります。
+    ///
+    /// @param[in] aStageIndex          ステージ番号。
+    /// @param[in] aTimer               制限時間を判定するタイマー。
+    ///
+    /// @return 実行したステージの記録。次に呼び出すまで有効です。
+    const RecordStage& ParallelRunner::RunScratchStage(int aStageIndex, const Timer& aTimer)
+    {
+        HPC_RANGE_ASSERT_MIN_UB_I(aStageIndex, 0, Parameter::GameStageCount);
+        RandomSet randSet = sStageRandSets[aStageIndex];
+        sRecordStage.setArena(sRecordArena);
+        sRecordArena.reset();
+        RunStage(aStageIndex, randSet, sStage, sRecordStage, aTimer);
+        return sRecordStage;
+    }
+}
+
+//------------------------------------------------------------------------------
+// EOF
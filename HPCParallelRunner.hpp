@@ -0,0 +1,117 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    ParallelRunner クラス
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "HPCParameter.hpp"
+#include "HPCRandomSet.hpp"
+#include "HPCRecord.hpp"
+#include "HPCRecordStage.hpp"
+#include "HPCStage.hpp"
+#include "HPCTimer.hpp"
+
+namespace hpc {
+
+    //------------------------------------------------------------------------------
+    /// ParallelJobs の仕事を1つ実行する関数です。
+    ///
+    /// @param[in] aJobIndex    仕事の番号。
+    /// @param[in] aGameTimer   この仕事が属するゲームの制限時間を判定するタイマー。
+    /// @param[out] aResult     実行結果の格納先。 ParallelJobs::resultSizeMax バイトまで書き込めます。
+    /// @param[in] aContext     ParallelJobs::context の値。
+    ///
+    /// @return 書き込んだ実行結果のバイト数。失敗した場合は負の値を返します。
+    typedef int (*ParallelJobFunc)(int aJobIndex, const Timer& aGameTimer, void* aResult, void* aContext);
+
+    //------------------------------------------------------------------------------
+    /// ParallelJobs の仕事1つ分の実行結果を受け取る関数です。仕事の番号順に呼び出されます。
+    ///
+    /// @param[in] aJobIndex    仕事の番号。
+    /// @param[in] aResult      実行結果。仕事を実行したワーカーが異常終了した場合は 0 です。
+    /// @param[in] aResultSize  実行結果のバイト数。
+    /// @param[in] aContext     ParallelJobs::context の値。
+    typedef void (*ParallelCommitFunc)(int aJobIndex, const void* aResult, int aResultSize, void* aContext);
+
+    //------------------------------------------------------------------------------
+    /// ParallelRunner::RunJobs() で実行する仕事の一覧を表します。
+    ///
+    /// 仕事は番号順に gameJobCount 個ずつ、1つのゲームとしてまとめられます。
+    /// 同じゲームの仕事は、1つの制限時間を共有します。
+    struct ParallelJobs
+    {
+        int jobCount;               ///< 仕事の数
+        int gameJobCount;           ///< 1つのゲームに含まれる仕事の数
+        int resultSizeMax;          ///< 仕事1つ分の実行結果のバイト数の最大値
+        const Timer* gameTimer;     ///< すべての仕事で共有するタイマー。 0 ならゲームごとに開始します。
+        bool isRetried;             ///< 異常終了したワーカーの仕事を、呼び出し元のプロセスで実行し直すか
+        ParallelJobFunc run;        ///< 仕事を実行する関数
+        ParallelCommitFunc commit;  ///< 実行結果を受け取る関数
+        void* context;              ///< run, commit に渡す値
+    };
+
+    //------------------------------------------------------------------------------
+    /// 複数のステージを並列に実行する機能を提供します。
+    ///
+    /// 各ステージはそれぞれ独立した乱数列で実行されるため、
+    /// ワーカー数によらず同じ結果が得られます。
+    ///
+    /// Game::startStage() から順に実行する場合とは、ゲーム用の乱数の使い方が異なるため結果も異なります。
+    /// 順に実行する場合は1つの乱数列を全ステージで続けて使い、 CPU キャラはゴールするまで毎ターン乱数を引きます。
+    /// CPU キャラがゴールするターンはプレイヤーとの衝突や Answer の動作で変わるので、
+    /// あるステージの開始時の乱数の状態は、それより前のステージを最後まで実行しないと決まりません。
+    /// ステージを並列に実行しながら、順に実行した場合と同じ状態から始めることはできないため、
+    /// 順に実行した場合と同じ得点が必要なときは、このクラスを使わずに実行してください。
+    ///
+    /// ワーカーの生成と仕事の分配は RunJobs() が受け持ち、 Run() と BatchRunner はこれを使います。
+    /// ワーカーで使うステージと記録は、 RunScratchStage() が使う static な変数を共有します。
+    ///
+    /// @note Answer.cpp はファイルスコープの変数に状態を持つため、
+    ///       スレッドではなくプロセス単位でワーカーを用意します。
+    ///       プロセスを生成できない環境では、呼び出し元のプロセスで順番に実行します。
+    class ParallelRunner
+    {
+    public:
+        static const int WorkerCountMax = Parameter::GameStageCount;        ///< ワーカー数の最大値
+        static const int ResultSizeMax = RecordStage::ReplaySizeMax;        ///< 仕事1つ分の実行結果のバイト数の最大値
+
+        static int DefaultWorkerCount();    ///< 実行環境で利用できるワーカー数を返します。
+
+        /// ステージごとの乱数を導出します。
+        static void DeriveStageRandoms(RandomSet& aRandSet, RandomSet* aStageRandSets);
+        /// 1つのステージを最初から最後まで実行します。
+        static void RunStage(
+            int aStageIndex
+            , RandomSet& aRandSet
+            , Stage& aStage
+            , RecordStage& aRecord
+            , const Timer& aTimer
+            );
+        /// 仕事を、ワーカーで分け合って実行します。
+        static void RunJobs(int aWorkerCount, const ParallelJobs& aJobs);
+        /// すべてのステージを実行し、結果をステージ順に記録します。
+        static void Run(
+            int aWorkerCount
+            , RandomSet& aRandSet
+            , Record& aRecord
+            , const Timer& aTimer
+            , bool aIsSweptCollision
+            );
+
+        static void SetSweptCollision(bool aIsSwept);       ///< RunScratchStage() でキャラ同士の衝突を連続判定するかを設定します。
+        static void DeriveScratchRandoms(RandomSet& aRandSet); ///< RunScratchStage() で使うステージごとの乱数を導出します。
+        /// DeriveScratchRandoms() で導出した乱数で、1つのステージを実行します。
+        static const RecordStage& RunScratchStage(int aStageIndex, const Timer& aTimer);
+
+    private:
+        ParallelRunner();
+    };
+}
+//------------------------------------------------------------------------------
+// EOF
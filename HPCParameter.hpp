@@ -10,6 +10,18 @@
 //------------------------------------------------------------------------------
 #pragma once
 
+/// 1ステージで同時に動かせるキャラ数の上限を、ビルド時に指定します。
+/// 指定しない場合は、ゲームのルールどおり Parameter::CharaCountMax と同じ 4 です。
+#ifndef HPC_CHARA_CAPACITY
+    #define HPC_CHARA_CAPACITY 4
+#endif
+
+/// 1ステージに置ける蓮の数の上限を、ビルド時に指定します。
+/// 指定しない場合は、ゲームのルールどおり Parameter::LotusCountMax と同じ 20 です。
+#ifndef HPC_LOTUS_CAPACITY
+    #define HPC_LOTUS_CAPACITY 20
+#endif
+
 namespace hpc {
 
     //------------------------------------------------------------------------------
@@ -33,6 +45,10 @@ namespace hpc {
         //@{
         static const int CharaCountMin = 2;             ///< キャラ最小数(プレイヤー含む)
         static const int CharaCountMax = 4;             ///< キャラ最大数(プレイヤー含む)
+        /// 1ステージで同時に動かせるキャラ数の上限(プレイヤー含む)
+        /// 群衆での負荷試験用に、 HPC_CHARA_CAPACITY で CharaCountMax より増やせます。
+        /// 記録とリプレイは CharaCountMax 人までです。
+        static const int CharaCapacity = HPC_CHARA_CAPACITY;
         static const int CharaAccelCountMax = 9;        ///< 加速回数の最大数
         static const int CharaInitAccelCount = 9;       ///< 加速回数の初期値
         static float CharaAccelSpeed();                 ///< 加速度
@@ -49,6 +65,10 @@ namespace hpc {
         ///@name 蓮
         //@{
         static const int LotusCountMax = 20;            ///< 最大数
+        /// 1ステージに置ける蓮の数の上限
+        /// 大きなステージでの負荷試験用に、 HPC_LOTUS_CAPACITY で LotusCountMax より増やせます。
+        /// 記録とリプレイは LotusCountMax 個までです。
+        static const int LotusCapacity = HPC_LOTUS_CAPACITY;
         static float LotusBaseRadius();                 ///< 基準となる半径
         //@}
 
@@ -0,0 +1,210 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    HPCProfiler.hpp の実装
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+
+#include "HPCProfiler.hpp"
+
+#include <cstdio>
+#include "HPCCommon.hpp"
+
+namespace {
+    using namespace hpc;
+
+    /// 処理の名前
+    const char* const ScopeNames[ProfileScope_TERM] = {
+        "StageSetup",
+        "AnswerInit",
+        "DecideAction",
+        "AnswerAction",
+        "ExecAction",
+        "CheckColl",
+        "End",
+        "RecordWrite",
+    };
+
+    // new, delete を使うことは出来ないので static な変数として用意します。
+    bool sIsEnabled = false;                        ///< 計測するかどうか
+    ProfileEntry sEntries[ProfileScope_TERM];       ///< 処理ごとの集計
+}
+
+namespace hpc {
+
+    //------------------------------------------------------------------------------
+    /// 集計を初期化し、計測回数 0 回の状態にします。
+    void ProfileEntry::reset()
+    {
+        count = 0;
+        totalSec = 0.0;
+        minSec = 0.0;
+        maxSec = 0.0;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 計測した時間を1つ加えます。
+    ///
+    /// @param[in] aSec 計測した時間を秒で指定。
+    void ProfileEntry::add(double aSec)
+    {
+        if (count == 0 || aSec < minSec) {
+            minSec = aSec;
+        }
+        if (count == 0 || maxSec < aSec) {
+            maxSec = aSec;
+        }
+        ++count;
+        totalSec += aSec;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 別の集計を加えます。
+    ///
+    /// @param[in] aEntry 加える集計。計測回数 0 回の場合は何もしません。
+    void ProfileEntry::merge(const ProfileEntry& aEntry)
+    {
+        if (aEntry.count == 0) {
+            return;
+        }
+        if (count == 0 || aEntry.minSec < minSec) {
+            minSec = aEntry.minSec;
+        }
+        if (count == 0 || maxSec < aEntry.maxSec) {
+            maxSec = aEntry.maxSec;
+        }
+        count += aEntry.count;
+        totalSec += aEntry.totalSec;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 計測するかどうかを設定します。
+    ///
+    /// @param[in] aIsEnabled 計測する場合は @c true を指定。
+    void Profiler::SetEnabled(bool aIsEnabled)
+    {
+        sIsEnabled = aIsEnabled;
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return 計測する場合は @c true を返します。
+    bool Profiler::IsEnabled()
+    {
+        return sIsEnabled;
+    }
+
+    //------------------------------------------------------------------------------
+    /// すべての処理の集計を初期化します。
+    void Profiler::Reset()
+    {
+        for (int index = 0; index < ProfileScope_TERM; ++index) {
+            sEntries[index].reset();
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// 計測した時間を1つ加えます。
+    ///
+    /// @param[in] aScope   計測した処理。
+    /// @param[in] aSec     計測した時間を秒で指定。
+    void Profiler::Add(ProfileScope aScope, double aSec)
+    {
+        HPC_ENUM_ASSERT(ProfileScope, aScope);
+        sEntries[aScope].add(aSec);
+    }
+
+    //------------------------------------------------------------------------------
+    /// @param[in] aScope 処理。
+    ///
+    /// @return 処理の集計。
+    const ProfileEntry& Profiler::Entry(ProfileScope aScope)
+    {
+        HPC_ENUM_ASSERT(ProfileScope, aScope);
+        return sEntries[aScope];
+    }
+
+    //------------------------------------------------------------------------------
+    /// 別のプロセスで集計したものを加えます。
+    ///
+    /// @param[in] aEntries 処理ごとの集計。 ProfileScope_TERM 個の要素が必要です。
+    void Profiler::Merge(const ProfileEntry* aEntries)
+    {
+        HPC_ASSERT(aEntries != 0);
+        for (int index = 0; index < ProfileScope_TERM; ++index) {
+            sEntries[index].merge(aEntries[index]);
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// @param[in] aScope 処理。
+    ///
+    /// @return 処理の名前。
+    const char* Profiler::Name(ProfileScope aScope)
+    {
+        HPC_ENUM_ASSERT(ProfileScope, aScope);
+        return ScopeNames[aScope];
+    }
+
+    //------------------------------------------------------------------------------
+    /// 処理ごとの集計を表にして出力します。
+    ///
+    /// JSON などの出力と混ざらないよう、標準エラー出力に出力します。
+    /// 割合は、合計時間を実時間で割ったものです。
+    /// 並列に実行した場合、ワーカーの合計時間を足し合わせるため 100% を超えることがあります。
+    ///
+    /// @param[in] aWallSec 全体の実時間。
+    /// @param[in] aCpuSec  全体の CPU 時間。
+    void Profiler::Print(double aWallSec, double aCpuSec)
+    {
+        std::fprintf(stderr, "[Profile] Wall: %.4f sec, CPU: %.4f sec\n", aWallSec, aCpuSec);
+        std::fprintf(
+            stderr
+            , "%-14s %9s %10s %7s %10s %10s %10s\n"
+            , "Scope", "Count", "Total[s]", "Ratio", "Mean[us]", "Min[us]", "Max[us]"
+            );
+        for (int index = 0; index < ProfileScope_TERM; ++index) {
+            const ProfileEntry& entry = sEntries[index];
+            const double ratio = aWallSec > 0.0 ? entry.totalSec / aWallSec * 100.0 : 0.0;
+            const double mean = entry.count > 0 ? entry.totalSec / entry.count : 0.0;
+            std::fprintf(
+                stderr
+                , "%-14s %9d %10.4f %6.1f%% %10.2f %10.2f %10.2f\n"
+                , ScopeNames[index]
+                , entry.count
+                , entry.totalSec
+                , ratio
+                , mean * 1.0e6
+                , entry.minSec * 1.0e6
+                , entry.maxSec * 1.0e6
+                );
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// 計測を開始します。
+    ///
+    /// Profiler が無効な場合は、時刻を取得しません。
+    ///
+    /// @param[in] aScope 計測する処理。
+    ProfileSample::ProfileSample(ProfileScope aScope)
+        : mScope(aScope)
+        , mBeginSec(Profiler::IsEnabled() ? Timer::MonotonicSec() : -1.0)
+    {
+    }
+
+    //------------------------------------------------------------------------------
+    /// 計測を終了し、経過した時間を Profiler に加えます。
+    ProfileSample::~ProfileSample()
+    {
+        if (mBeginSec >= 0.0) {
+            Profiler::Add(mScope, Timer::MonotonicSec() - mBeginSec);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+// EOF
@@ -0,0 +1,88 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    Profiler クラス
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "HPCTimer.hpp"
+
+namespace hpc {
+
+    //------------------------------------------------------------------------------
+    /// 実行時間を計測する処理の種類を表します。
+    enum ProfileScope
+    {
+        ProfileScope_StageSetup,        ///< ステージの生成 (LevelDesigner::Setup)
+        ProfileScope_AnswerInit,        ///< Answer::Init
+        ProfileScope_DecideAction,      ///< 動作の決定 (CharaCollection::procDecideAction)
+        ProfileScope_AnswerAction,      ///< Answer::GetNextAction。 DecideAction の内数です。
+        ProfileScope_ExecAction,        ///< 動作の実行 (CharaCollection::procExecAction)
+        ProfileScope_CheckColl,         ///< 衝突判定 (CharaCollection::procCheckColl)
+        ProfileScope_End,               ///< 最終処理 (CharaCollection::procEnd)
+        ProfileScope_RecordWrite,       ///< 記録の書き込み
+
+        ProfileScope_TERM
+    };
+
+    //------------------------------------------------------------------------------
+    /// 1種類の処理について、計測した実行時間を集計したものです。
+    ///
+    /// プロセス間で受け渡せるよう、コンストラクタを持たない構造体にしています。
+    /// すべての値がゼロの状態は、計測回数 0 回を表します。
+    struct ProfileEntry
+    {
+        void reset();                                   ///< 集計を初期化します。
+        void add(double aSec);                          ///< 計測した時間を1つ加えます。
+        void merge(const ProfileEntry& aEntry);         ///< 別の集計を加えます。
+
+        int count;          ///< 計測回数
+        double totalSec;    ///< 合計時間
+        double minSec;      ///< 最短時間
+        double maxSec;      ///< 最長時間
+    };
+
+    //------------------------------------------------------------------------------
+    /// 処理ごとの実行時間を集計します。
+    ///
+    /// 計測は SetEnabled(true) を呼んだ場合のみ行います。
+    /// 無効な場合、 ProfileSample の計測はほぼ無視できるコストになります。
+    class Profiler
+    {
+    public:
+        static void SetEnabled(bool aIsEnabled);        ///< 計測するかどうかを設定します。
+        static bool IsEnabled();                        ///< 計測するかどうかを返します。
+        static void Reset();                            ///< すべての集計を初期化します。
+        static void Add(ProfileScope aScope, double aSec); ///< 計測した時間を1つ加えます。
+        static const ProfileEntry& Entry(ProfileScope aScope); ///< 集計を返します。
+        static void Merge(const ProfileEntry* aEntries); ///< 別のプロセスの集計を加えます。
+        static const char* Name(ProfileScope aScope);   ///< 処理の名前を返します。
+        static void Print(double aWallSec, double aCpuSec); ///< 集計を表にして出力します。
+
+    private:
+        Profiler();
+    };
+
+    //------------------------------------------------------------------------------
+    /// 生存期間の間の実行時間を計測し、 Profiler に加えます。
+    class ProfileSample
+    {
+    public:
+        explicit ProfileSample(ProfileScope aScope);    ///< 計測を開始します。
+        ~ProfileSample();                               ///< 計測を終了し、 Profiler に加えます。
+
+    private:
+        ProfileSample(const ProfileSample& aSample);                ///< コピーはできません。
+        ProfileSample& operator=(const ProfileSample& aSample);     ///< コピーはできません。
+
+        const ProfileScope mScope;  ///< 計測する処理
+        const double mBeginSec;     ///< 開始時刻。計測しない場合は負の値。
+    };
+}
+//------------------------------------------------------------------------------
+// EOF
@@ -12,6 +12,83 @@
 
 #include "HPCCommon.hpp"
 
+namespace {
+    using namespace hpc;
+
+    /// 状態のビット数
+    const int StateBitCount = 64;
+
+    /// 範囲を指定した整数の計算に使う、 32 ビットの値どうしの積を格納できる型
+    typedef unsigned long long ProductType;
+
+    //------------------------------------------------------------------------------
+    /// 状態の更新を表す GF(2) 上の行列です。
+    ///
+    /// 状態を (x, y) の 64 ビットのベクトルとみなし、列ごとに、
+    /// その列に対応するビットだけが立った状態を変換した結果を持ちます。
+    struct JumpMatrix
+    {
+        uint columnX[StateBitCount];    ///< 列ごとの変換結果の x
+        uint columnY[StateBitCount];    ///< 列ごとの変換結果の y
+
+        //------------------------------------------------------------------------------
+        /// 状態を変換します。
+        void apply(uint& aSeedX, uint& aSeedY)const
+        {
+            uint resultX = 0;
+            uint resultY = 0;
+            for (int bit = 0; bit < 32; ++bit) {
+                if ((aSeedX >> bit) & 1) {
+                    resultX ^= columnX[bit];
+                    resultY ^= columnY[bit];
+                }
+                if ((aSeedY >> bit) & 1) {
+                    resultX ^= columnX[32 + bit];
+                    resultY ^= columnY[32 + bit];
+                }
+            }
+            aSeedX = resultX;
+            aSeedY = resultY;
+        }
+    };
+
+    // new, delete を使うことは出来ないので static な変数として用意します。
+    bool sIsJumpTableReady = false;                 ///< sJumpTable を計算したか
+    JumpMatrix sJumpTable[StateBitCount];           ///< 乱数列を 2^n 個進める行列
+
+    //------------------------------------------------------------------------------
+    /// sJumpTable を計算します。
+    ///
+    /// 1 個進める行列は、ビットを1つだけ立てた状態から実際に乱数を1つ発生させて求め、
+    /// 以降は前の行列の2乗として求めます。
+    void SetupJumpTable()
+    {
+        if (sIsJumpTableReady) {
+            return;
+        }
+        for (int bit = 0; bit < StateBitCount; ++bit) {
+            Random random(
+                bit < 32 ? 1u << bit : 0
+                , bit < 32 ? 0 : 1u << (bit - 32)
+                );
+            random.randTerm(1);
+            random.getState(sJumpTable[0].columnX[bit], sJumpTable[0].columnY[bit]);
+        }
+        for (int power = 1; power < StateBitCount; ++power) {
+            const JumpMatrix& half = sJumpTable[power - 1];
+            JumpMatrix& matrix = sJumpTable[power];
+            for (int bit = 0; bit < StateBitCount; ++bit) {
+                uint seedX = half.columnX[bit];
+                uint seedY = half.columnY[bit];
+                half.apply(seedX, seedY);
+                matrix.columnX[bit] = seedX;
+                matrix.columnY[bit] = seedY;
+            }
+        }
+        sIsJumpTableReady = true;
+    }
+}
+
 namespace hpc {
     //------------------------------------------------------------------------------
     /// クラスのインスタンスを生成します。
@@ -62,6 +139,123 @@ namespace hpc {
         return aMin + randTerm(1 + aMax - aMin);
     }
 
+    //------------------------------------------------------------------------------
+    /// 配列を [0, UINT_MAX] の範囲の乱数で埋めます。
+    ///
+    /// 値は、乱数列を aCount 個進める間に発生させた値を順に並べたものです。
+    ///
+    /// @param[out] aValues 埋める配列。
+    /// @param[in] aCount   要素数。
+    void Random::fillU32(uint* aValues, int aCount)
+    {
+        for (int index = 0; index < aCount; ++index) {
+            aValues[index] = randCoreU32();
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// 配列を [0, aTerm) の範囲の乱数で埋めます。
+    ///
+    /// 乱数 x に対して (x * aTerm) >> 32 を値とします。
+    /// 下位 32 ビットが 2^32 % aTerm 未満の場合は偏りが出るので、 x を引き直します。
+    /// 引き直しが起こる確率は aTerm / 2^32 未満です。
+    ///
+    /// @param[out] aValues 埋める配列。
+    /// @param[in] aCount   要素数。
+    /// @param[in] aTerm    乱数を発生させる範囲の上界。
+    void Random::fillTerm(int* aValues, int aCount, int aTerm)
+    {
+        HPC_LB_ASSERT_I(aTerm, 0);
+        const uint term = static_cast<uint>(aTerm);
+        // 2^32 % aTerm
+        const uint threshold = (0u - term) % term;
+        for (int index = 0; index < aCount; ++index) {
+            ProductType product = static_cast<ProductType>(randCoreU32()) * term;
+            while (static_cast<uint>(product) < threshold) {
+                product = static_cast<ProductType>(randCoreU32()) * term;
+            }
+            aValues[index] = static_cast<int>(product >> 32);
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// 配列を [0, 1) の範囲の乱数で埋めます。
+    ///
+    /// 上位 24 ビットを使うので、値は 2^-24 刻みで、丸めによる偏りはありません。
+    ///
+    /// @param[out] aValues 埋める配列。
+    /// @param[in] aCount   要素数。
+    void Random::fillFloat(float* aValues, int aCount)
+    {
+        const float scale = 1.0f / 16777216.0f;
+        for (int index = 0; index < aCount; ++index) {
+            aValues[index] = static_cast<float>(randCoreU32() >> 8) * scale;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// 乱数列を aCount * 2^aShift 個先に進めます。
+    ///
+    /// 同じ数だけ乱数を発生させた場合と同じ状態になります。
+    /// 進める数の 2 進数の桁ごとに状態を行列で変換するので、計算量は O(log n) です。
+    ///
+    /// @param[in] aCount 進める数。
+    /// @param[in] aShift 進める数を 2^aShift 倍します。 aCount * 2^aShift は 2^64 未満である必要があります。
+    void Random::jump(uint aCount, int aShift)
+    {
+        HPC_RANGE_ASSERT_MIN_UB_I(aShift, 0, StateBitCount);
+        HPC_ASSERT_MSG(aShift <= 32 || (aCount >> (StateBitCount - aShift)) == 0, "Jump count overflows (%u << %d)", aCount, aShift);
+        SetupJumpTable();
+        for (int bit = 0; bit < 32 && aShift + bit < StateBitCount; ++bit) {
+            if ((aCount >> bit) & 1) {
+                sJumpTable[aShift + bit].apply(mSeedX, mSeedY);
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// 現在の位置から乱数列を 2^SubstreamShift 個ずつの区間に分け、
+    /// aIndex 番目の区間の先頭から始まるインスタンスを返します。
+    ///
+    /// 番号が異なる区間は、それぞれ 2^SubstreamShift 個の乱数を発生させるまで重なりません。
+    /// 他の番号の区間を取り出したかどうかによらず同じ結果になり、
+    /// このインスタンスの状態も変わりません。
+    ///
+    /// @param[in] aIndex 区間の番号。 0 の場合は、このインスタンスと同じ状態になります。
+    ///
+    /// @return aIndex 番目の区間の乱数生成クラス。
+    Random Random::substream(int aIndex)const
+    {
+        HPC_ASSERT(0 <= aIndex);
+        Random random(*this);
+        random.jump(static_cast<uint>(aIndex), SubstreamShift);
+        return random;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 乱数列の現在の状態を取得します。
+    ///
+    /// setState() に渡すと、取得した時点から同じ乱数列を発生させられます。
+    ///
+    /// @param[out] aSeedX 乱数の状態。
+    /// @param[out] aSeedY 乱数の状態。
+    void Random::getState(uint& aSeedX, uint& aSeedY)const
+    {
+        aSeedX = mSeedX;
+        aSeedY = mSeedY;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 乱数列の状態を設定します。
+    ///
+    /// @param[in] aSeedX getState() で取得した乱数の状態。
+    /// @param[in] aSeedY getState() で取得した乱数の状態。
+    void Random::setState(uint aSeedX, uint aSeedY)
+    {
+        mSeedX = aSeedX;
+        mSeedY = aSeedY;
+    }
+
     //------------------------------------------------------------------------------
     /// [0, UINT_MAX] の範囲をもつ乱数を内部で計算して乱数列を1つ進め、
     /// 現在の値を返します。
@@ -18,14 +18,32 @@ namespace hpc {
     /// 乱数生成の機能を提供します。
     ///
     /// 乱数列は、シードの値によって一意に定められます。
+    ///
+    /// 状態の更新は GF(2) 上の線形変換なので、その行列のべき乗を使って
+    /// 乱数列を任意の数だけ O(log n) で先に進められます ( jump() ) 。
+    /// substream() は、これを使って乱数列を 2^SubstreamShift 個ずつの重ならない区間に分け、
+    /// 番号で指定した区間の先頭から始まるインスタンスを返します。
+    ///
+    /// fill 系の関数は、配列をまとめて乱数で埋めます。範囲を指定した整数は剰余ではなく
+    /// 掛け算とシフトで求めるため、同じ状態からでも randTerm() とは異なる値になります。
+    /// SIMD 命令でまとめて発生させる場合は RandomLanes を使ってください。
     class Random
     {
     public:
+        static const int SubstreamShift = 32;   ///< substream() の1区間の長さの 2 を底とする対数
+
         Random(uint aSeedX, uint aSeedY);
 
         int randTerm(int aTerm);                ///< [0, aTerm) の範囲で乱数を取得します。
         int randMinTerm(int aMin, int aTerm);   ///< [aMin, aTerm) の範囲で乱数を取得します。
         int randMinMax(int aMin, int aMax);     ///< [aMin, aMax] の範囲で乱数を取得します。
+        void fillU32(uint* aValues, int aCount);            ///< 配列を [0, UINT_MAX] の範囲の乱数で埋めます。
+        void fillTerm(int* aValues, int aCount, int aTerm); ///< 配列を [0, aTerm) の範囲の乱数で埋めます。
+        void fillFloat(float* aValues, int aCount);         ///< 配列を [0, 1) の範囲の乱数で埋めます。
+        void jump(uint aCount, int aShift = 0); ///< 乱数列を aCount * 2^aShift 個先に進めます。
+        Random substream(int aIndex)const;     ///< 乱数列を区間に分けた、 aIndex 番目の区間のインスタンスを返します。
+        void getState(uint& aSeedX, uint& aSeedY)const;    ///< 現在の状態を取得します。
+        void setState(uint aSeedX, uint aSeedY);            ///< 状態を設定します。
 
     private:
         uint mSeedX;            ///< 乱数のシード
@@ -0,0 +1,170 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    HPCRandomLanes.hpp の実装
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+
+#include "HPCRandomLanes.hpp"
+
+#include <cstring>
+#include "HPCCommon.hpp"
+#include "HPCMath.hpp"
+#include "HPCSimd.hpp"
+
+namespace {
+    /// 範囲を指定した整数の計算に使う、 32 ビットの値どうしの積を格納できる型
+    typedef unsigned long long ProductType;
+}
+
+namespace hpc {
+
+    //------------------------------------------------------------------------------
+    /// クラスのインスタンスを生成します。
+    ///
+    /// レーン i は aRandom.substream(FirstSubstreamIndex + i) から始めます。
+    /// aRandom 自身の乱数列や、ステージごとの乱数列と重ならないよう、
+    /// ParallelRunner が使う区間より後ろの区間を使います。
+    ///
+    /// @param[in] aRandom 元にする乱数。状態は変わりません。
+    RandomLanes::RandomLanes(const Random& aRandom)
+        : mBufferIndex(BufferCount)
+    {
+        for (int lane = 0; lane < LaneCount; ++lane) {
+            aRandom.substream(FirstSubstreamIndex + lane).getState(mSeedX[lane], mSeedY[lane]);
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// 配列を [0, UINT_MAX] の範囲の乱数で埋めます。
+    ///
+    /// @param[out] aValues 埋める配列。
+    /// @param[in] aCount   要素数。
+    void RandomLanes::fillU32(uint* aValues, int aCount)
+    {
+        int index = 0;
+        while (index < aCount) {
+            if (mBufferIndex == BufferCount) {
+                refill();
+            }
+            const int copyCount = Math::Min(aCount - index, BufferCount - mBufferIndex);
+            std::memcpy(aValues + index, mBuffer + mBufferIndex, sizeof(uint) * copyCount);
+            index += copyCount;
+            mBufferIndex += copyCount;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// 配列を [0, aTerm) の範囲の乱数で埋めます。
+    ///
+    /// 乱数 x に対して (x * aTerm) >> 32 を値とします。
+    /// 下位 32 ビットが 2^32 % aTerm 未満の場合は偏りが出るので、 x を引き直します。
+    /// 引き直しが起こる確率は aTerm / 2^32 未満です。
+    ///
+    /// @param[out] aValues 埋める配列。
+    /// @param[in] aCount   要素数。
+    /// @param[in] aTerm    乱数を発生させる範囲の上界。
+    void RandomLanes::fillTerm(int* aValues, int aCount, int aTerm)
+    {
+        HPC_LB_ASSERT_I(aTerm, 0);
+        const uint term = static_cast<uint>(aTerm);
+        // 2^32 % aTerm
+        const uint threshold = (0u - term) % term;
+        int index = 0;
+        while (index < aCount) {
+            if (mBufferIndex == BufferCount) {
+                refill();
+            }
+            // バッファの残りをまとめて変換し、引き直しが必要な値がなければそのまま使う
+            const uint* values = mBuffer + mBufferIndex;
+            const int count = Math::Min(aCount - index, BufferCount - mBufferIndex);
+            uint isRejected = 0;
+            for (int offset = 0; offset < count; ++offset) {
+                const ProductType product = static_cast<ProductType>(values[offset]) * term;
+                aValues[index + offset] = static_cast<int>(product >> 32);
+                isRejected |= static_cast<uint>(static_cast<uint>(product) < threshold);
+            }
+            if (!isRejected) {
+                index += count;
+                mBufferIndex += count;
+                continue;
+            }
+
+            // 引き直しが必要な値があれば、同じ範囲を1つずつ引き直しながら変換し直す
+            for (const int end = index + count; index < end; ++index) {
+                ProductType product = static_cast<ProductType>(nextU32()) * term;
+                while (static_cast<uint>(product) < threshold) {
+                    product = static_cast<ProductType>(nextU32()) * term;
+                }
+                aValues[index] = static_cast<int>(product >> 32);
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// 配列を [0, 1) の範囲の乱数で埋めます。
+    ///
+    /// 上位 24 ビットを使うので、値は 2^-24 刻みで、丸めによる偏りはありません。
+    ///
+    /// @param[out] aValues 埋める配列。
+    /// @param[in] aCount   要素数。
+    void RandomLanes::fillFloat(float* aValues, int aCount)
+    {
+        const float scale = 1.0f / 16777216.0f;
+        for (int index = 0; index < aCount; ++index) {
+            aValues[index] = static_cast<float>(nextU32() >> 8) * scale;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// 全レーンを BufferCount / LaneCount 回進め、 mBuffer を新しい値で埋めます。
+    ///
+    /// 状態の更新は Random と同じです。
+    void RandomLanes::refill()
+    {
+        int index = 0;
+#ifdef HPC_SIMD_SSE2
+        {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mSeedX));
+            __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mSeedY));
+            for (; index < BufferCount; index += LaneCount) {
+                const __m128i t = _mm_xor_si128(x, _mm_slli_epi32(x, 11));
+                x = y;
+                y = _mm_xor_si128(
+                    _mm_xor_si128(y, _mm_srli_epi32(y, 19))
+                    , _mm_xor_si128(t, _mm_srli_epi32(t, 8))
+                    );
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(mBuffer + index), y);
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(mSeedX), x);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(mSeedY), y);
+        }
+#endif
+        for (; index < BufferCount; index += LaneCount) {
+            for (int lane = 0; lane < LaneCount; ++lane) {
+                const uint t = (mSeedX[lane] ^ (mSeedX[lane] << 11));
+                mSeedX[lane] = mSeedY[lane];
+                mSeedY[lane] = (mSeedY[lane] ^ (mSeedY[lane] >> 19)) ^ (t ^ (t >> 8));
+                mBuffer[index + lane] = mSeedY[lane];
+            }
+        }
+        mBufferIndex = 0;
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return 発生させた値の並びの、次の値。
+    uint RandomLanes::nextU32()
+    {
+        if (mBufferIndex == BufferCount) {
+            refill();
+        }
+        return mBuffer[mBufferIndex++];
+    }
+}
+
+//------------------------------------------------------------------------------
+// EOF
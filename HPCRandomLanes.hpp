@@ -0,0 +1,59 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    RandomLanes クラス
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "HPCParameter.hpp"
+#include "HPCRandom.hpp"
+#include "HPCTypes.hpp"
+
+namespace hpc {
+
+    //------------------------------------------------------------------------------
+    /// 大量の乱数を配列にまとめて発生させます。
+    ///
+    /// Random と同じ xorshift を LaneCount 本並べ、 SIMD 命令でまとめて進めます。
+    /// 各レーンは元の Random の FirstSubstreamIndex 番目以降の Random::substream() から始まるため、
+    /// 互いに重ならず、 ParallelRunner がステージごとに使う区間とも重なりません。
+    /// 発生させる値の並びは、各レーンの値を順に交互に並べたもので、
+    /// SIMD 命令の有無や、 fill 系の関数を呼ぶ単位によらず同じになります。
+    ///
+    /// 値の変換は Random::fillTerm(), Random::fillFloat() と同じです。
+    /// Random の乱数列には影響しないので、ゲームの結果を変えずに使えます。
+    class RandomLanes
+    {
+    public:
+        static const int LaneCount = 4;         ///< 並べる乱数列の数
+        static const int BufferCount = 256;     ///< まとめて発生させておく値の数
+        /// 最初のレーンに使う Random::substream() の番号。
+        /// 0 ～ GameStageCount - 1 番は ParallelRunner::DeriveStageRandoms() が使います。
+        static const int FirstSubstreamIndex = Parameter::GameStageCount;
+
+        explicit RandomLanes(const Random& aRandom);
+
+        void fillU32(uint* aValues, int aCount);                ///< [0, UINT_MAX] の範囲の乱数で埋めます。
+        void fillTerm(int* aValues, int aCount, int aTerm);     ///< [0, aTerm) の範囲の乱数で埋めます。
+        void fillFloat(float* aValues, int aCount);             ///< [0, 1) の範囲の乱数で埋めます。
+
+    private:
+        uint mSeedX[LaneCount];         ///< レーンごとの乱数のシード
+        uint mSeedY[LaneCount];         ///< レーンごとの乱数のシード
+        uint mBuffer[BufferCount];      ///< 発生させておいた値
+        int mBufferIndex;               ///< 次に使う mBuffer の位置
+
+        /// レーン数の倍数ずつ発生させる
+        typedef char BufferCountCheck[BufferCount % LaneCount == 0 ? 1 : -1];
+
+        void refill();                  ///< mBuffer を新しい値で埋めます。
+        uint nextU32();                 ///< 次の値を返します。
+    };
+}
+//------------------------------------------------------------------------------
+// EOF
@@ -24,6 +24,17 @@ namespace hpc {
     {
     }
 
+    //------------------------------------------------------------------------------
+    /// 乱数生成クラスの状態を直接指定してインスタンスを生成します。
+    ///
+    /// @param[in] aSystem システムで使用する乱数生成クラス。
+    /// @param[in] aGame   ゲーム中に使用する乱数生成クラス。
+    RandomSet::RandomSet(const Random& aSystem, const Random& aGame)
+        : mSystem(aSystem)
+        , mGame(aGame)
+    {
+    }
+
     //------------------------------------------------------------------------------
     /// @return システムで使用する乱数生成クラス
     Random& RandomSet::system()
@@ -21,6 +21,7 @@ namespace hpc {
     {
     public:
         explicit RandomSet(const RandomSeed& aSeed = RandomSeed());
+        RandomSet(const Random& aSystem, const Random& aGame);
 
         /// @name 各要素へのアクセス
         //@{
@@ -12,15 +12,39 @@
 #include "HPCRecord.hpp"
 
 #include "HPCCommon.hpp"
+#include "HPCReplay.hpp"
+
+namespace {
+    // new, delete を使うことは出来ないので static な変数として用意します。
+    hpc::ReplayWriter sReplayWriter;    ///< リプレイファイルの書き込み用
+    hpc::ReplayFile sReplayFile;        ///< リプレイファイルの読み込み用
+
+#ifdef DEBUG
+    /// ターンごとの記録を格納する領域。
+    /// 実際に記録した分だけがメモリに載るよう、ゼロで初期化された static な変数として用意します。
+    unsigned char sTurnArenaBuffer[hpc::Parameter::GameStageCount * hpc::TurnStream::ArenaSizeMax];
+#endif
+}
 
 namespace hpc {
 
     //------------------------------------------------------------------------------
     /// クラスのインスタンスを生成します。
+    ///
+    /// 定数 DEBUG が定義されている場合、ターンごとの記録は static な領域に格納するため、
+    /// 同時に存在できるインスタンスは1つだけです。
     Record::Record()
         : mStage()
         , mCurrentStageIndex(0)
+#ifdef DEBUG
+        , mArena(sTurnArenaBuffer, sizeof(sTurnArenaBuffer))
+#endif
     {
+#ifdef DEBUG
+        for (int index = 0; index < Parameter::GameStageCount; ++index) {
+            mStage[index].setArena(mArena);
+        }
+#endif
     }
 
     //------------------------------------------------------------------------------
@@ -43,10 +67,10 @@ namespace hpc {
     ///
     /// @pre 記録前に writeStartStage を呼び、ステージ開始状態にする必要があります。
     ///
-    /// @param[in] aResult ターンの実行結果。
-    void Record::writeTurn(const TurnResult& aResult)
+    /// @param[in] aStage 現在実行しているステージ。
+    void Record::writeTurn(const Stage& aStage)
     {
-        mStage[mCurrentStageIndex].writeTurn(aResult);
+        mStage[mCurrentStageIndex].writeTurn(aStage);
     }
 
     //------------------------------------------------------------------------------
@@ -60,6 +84,24 @@ namespace hpc {
         mStage[mCurrentStageIndex].writeEnd(aStage);
     }
 
+    //------------------------------------------------------------------------------
+    /// 別のインスタンスで記録し終えたステージの結果を格納します。
+    ///
+    /// ステージを並列に実行した場合に、結果をまとめるために使用します。
+    /// ターンごとの記録は、このインスタンスの領域に複製します。
+    ///
+    /// @param[in] aStageIndex  ステージ番号。
+    /// @param[in] aRecord      ステージの記録。
+    ///
+    /// @pre ステージ番号は有効な範囲を示している必要があります。
+    void Record::writeStage(int aStageIndex, const RecordStage& aRecord)
+    {
+        HPC_RANGE_ASSERT_MIN_UB_I(aStageIndex, 0, Parameter::GameStageCount);
+
+        mCurrentStageIndex = aStageIndex;
+        mStage[mCurrentStageIndex].set(aRecord);
+    }
+
     //------------------------------------------------------------------------------
     /// 各ステージの合計得点を返します。
     /// すべてのステージが終了してから呼びます。
@@ -93,6 +135,16 @@ namespace hpc {
     }
 
 
+    //------------------------------------------------------------------------------
+    /// @param[in] aStageIndex ステージ番号。
+    ///
+    /// @return 引数に指定されたステージの記録。
+    const RecordStage& Record::stage(int aStageIndex)const
+    {
+        HPC_RANGE_ASSERT_MIN_UB_I(aStageIndex, 0, Parameter::GameStageCount);
+        return mStage[aStageIndex];
+    }
+
     //------------------------------------------------------------------------------
     /// 引数に指定されたステージの記録を JSON 形式で画面に出力します。
     /// 画面には指定されたステージの記録に関する部分のみの JSON が、非圧縮形式
@@ -156,6 +208,68 @@ namespace hpc {
         HPC_PRINT_JSON_DEBUG(!isCompressed, "\n");
         HPC_PRINT("]\n");
     }
+
+    //------------------------------------------------------------------------------
+    /// ゲームの全情報をリプレイファイルに書き込みます。
+    /// 形式は ReplayFormat を参照してください。
+    ///
+    /// @param[in] aFileName 書き込むファイル名。
+    ///
+    /// @return 書き込みに成功したら @c true を返します。
+    bool Record::writeReplay(const char* aFileName)const
+    {
+        ReplayWriter& writer = sReplayWriter;
+        if (!writer.open(aFileName)) {
+            return false;
+        }
+        writer.writeBytes(ReplayFormat::Magic, sizeof(ReplayFormat::Magic));
+        writer.writeInt(ReplayFormat::Version);
+        writer.writeInt(Parameter::GameStageCount);
+        writer.writeInt(Parameter::CharaCountMax);
+
+        // 索引は各ステージを書き込んだ後に埋める。
+        const int indexOffset = writer.position();
+        for (int index = 0; index < Parameter::GameStageCount * ReplayFormat::IndexEntrySize / 4; ++index) {
+            writer.writeInt(0);
+        }
+        for (int index = 0; index < Parameter::GameStageCount; ++index) {
+            const int stageOffset = writer.position();
+            writer.writeInt(index);
+            mStage[index].writeReplay(writer);
+            const int entryOffset = indexOffset + index * ReplayFormat::IndexEntrySize;
+            writer.overwriteInt(entryOffset, stageOffset);
+            writer.overwriteInt(entryOffset + 4, writer.position() - mStage[index].replayTurnSize());
+            writer.overwriteInt(entryOffset + 8, mStage[index].recordedTurnCount());
+        }
+        return writer.close();
+    }
+
+    //------------------------------------------------------------------------------
+    /// リプレイファイルを読み込み、記録された結果として設定します。
+    ///
+    /// 読み込みに失敗した場合、記録の内容は不定になります。
+    ///
+    /// @param[in] aFileName 読み込むファイル名。
+    ///
+    /// @return 読み込みに成功したら @c true を返します。
+    bool Record::readReplay(const char* aFileName)
+    {
+        ReplayFile& file = sReplayFile;
+        if (!file.open(aFileName)) {
+            return false;
+        }
+        // すべてのステージを読み直すので、それまでの記録の領域は不要になる。
+#ifdef DEBUG
+        mArena.reset();
+#endif
+        bool isValid = true;
+        for (int index = 0; isValid && index < Parameter::GameStageCount; ++index) {
+            isValid = file.readStage(index, mStage[index]);
+        }
+        file.close();
+        mCurrentStageIndex = Parameter::GameStageCount - 1;
+        return isValid;
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -10,6 +10,7 @@
 //------------------------------------------------------------------------------
 #pragma once
 
+#include "HPCArena.hpp"
 #include "HPCRecordStage.hpp"
 #include "HPCStage.hpp"
 #include "HPCTurnResult.hpp"
@@ -26,21 +27,29 @@ namespace hpc {
         /// @name 記録動作を行う関数
         //@{
         void writeStartStage(int aStageIndex, const Stage& aStage); ///< ステージの記録を開始します。
-        void writeTurn(const TurnResult& aResult);                  ///< 各ターンの結果を記録します。
+        void writeTurn(const Stage& aStage);                        ///< 各ターンの結果を記録します。
         void writeEndStage(const Stage& aStage);                    ///< 終了時の結果を記録します。
+        void writeStage(int aStageIndex, const RecordStage& aRecord); ///< 別に記録したステージの結果を格納します。
         //@}
 
         /// @name 記録を読み出す関数
         //@{
         int score()const;                                  ///< 合計得点を取得します。
+        const RecordStage& stage(int aStageIndex)const;    ///< ステージの記録を取得します。
         void dumpStage(int aStageIndex)const;              ///< ステージの結果を出力します。
         void dumpJsonStage(int aStageIndex)const;          ///< ステージの結果を JSON で出力します。
         void dumpJson(bool isCompressed)const;             ///< 全結果を JSON で出力します。
+        bool writeReplay(const char* aFileName)const;      ///< 全結果をリプレイファイルに書き込みます。
         //@}
 
+        bool readReplay(const char* aFileName);             ///< リプレイファイルから全結果を読み込みます。
+
     private:
         RecordStage mStage[Parameter::GameStageCount];    ///< ステージごとのデータ
         int mCurrentStageIndex;                             ///< 現在のステージ番号
+#ifdef DEBUG
+        Arena mArena;                                       ///< ターンごとの記録を格納する領域
+#endif
     };
 }
 //------------------------------------------------------------------------------
@@ -13,6 +13,15 @@
 
 #include "HPCCommon.hpp"
 #include "HPCLevelDesigner.hpp"
+#include "HPCProfiler.hpp"
+#include "HPCReplay.hpp"
+
+#ifdef DEBUG
+namespace {
+    // new, delete を使うことは出来ないので static な変数として用意します。
+    hpc::TurnResult sBlockTurns[hpc::TurnCodec::BlockTurnCount]; ///< 表示するために展開したブロック
+}
+#endif
 
 namespace hpc {
 
@@ -28,43 +37,125 @@ namespace hpc {
         , mField()
         , mLotuses()
         , mInitPositions()
+        , mRankEvents()
+        , mRankEventCount(0)
 #endif
         , mIsFailed(false)
     {
     }
 
+    //------------------------------------------------------------------------------
+    /// ターンごとの記録を格納する領域を設定します。
+    ///
+    /// 定数 DEBUG が定義されていない場合は、ターンごとの記録を保持しないので使用しません。
+    ///
+    /// @param[in] aArena 使用する領域。インスタンスより長く存在する必要があります。
+    void RecordStage::setArena(Arena& aArena)
+    {
+#ifdef DEBUG
+        mTurns.setArena(aArena);
+#else
+        (void)aArena;
+#endif
+    }
+
+    //------------------------------------------------------------------------------
+    /// 別の RecordStage の記録を複製します。
+    /// ターンごとの記録は、このインスタンスの領域に複製します。
+    ///
+    /// @param[in] aRecord 複製元。
+    void RecordStage::set(const RecordStage& aRecord)
+    {
+        mCurrentTurn = aRecord.mCurrentTurn;
+        for (int index = 0; index < Parameter::CharaCountMax; ++index) {
+            mRanks[index] = aRecord.mRanks[index];
+        }
+        mPassedLotusCount = aRecord.mPassedLotusCount;
+        mCharaCount = aRecord.mCharaCount;
+#ifdef DEBUG
+        mTurns.set(aRecord.mTurns);
+        mField.set(aRecord.mField);
+        mLotuses.set(aRecord.mLotuses);
+        for (int index = 0; index < Parameter::CharaCountMax; ++index) {
+            mInitPositions[index] = aRecord.mInitPositions[index];
+        }
+        for (int index = 0; index < aRecord.mRankEventCount; ++index) {
+            mRankEvents[index] = aRecord.mRankEvents[index];
+        }
+        mRankEventCount = aRecord.mRankEventCount;
+#endif
+        mIsFailed = aRecord.mIsFailed;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 記録を初期状態に戻します。
+    ///
+    /// 1つのインスタンスを複数のステージの記録に使い回す場合に呼び出します。
+    void RecordStage::reset()
+    {
+        mCurrentTurn = 0;
+#ifdef DEBUG
+        mTurns.reset(0);
+        mRankEventCount = 0;
+#endif
+        for (int index = 0; index < Parameter::CharaCountMax; ++index) {
+            mRanks[index] = 0;
+        }
+        mPassedLotusCount = 0;
+        mCharaCount = 0;
+        mIsFailed = false;
+    }
+
     //------------------------------------------------------------------------------
     /// ステージの記録を開始することを通知します。
     ///
     /// @param[in] aStage 現在実行しているステージを表す Stage クラスへの参照。
     void RecordStage::writeStart(const Stage& aStage)
     {
+        ProfileSample sample(ProfileScope_RecordWrite);
         mCharaCount = aStage.charas().count();
+        // 記録はゲームのルールどおりの人数まで
+        HPC_RANGE_ASSERT_MIN_MAX_I(mCharaCount, 0, Parameter::CharaCountMax);
         
 #ifdef DEBUG
+        mTurns.reset(mCharaCount);
         mField.set(aStage.field());
         mLotuses.set(aStage.lotuses());
         for (int index = 0; index < mCharaCount; ++index) {
             mInitPositions[index] = aStage.charas()[index].pos();
         }
+        mRankEventCount = 0;
 #endif
     }
 
     //------------------------------------------------------------------------------
     /// 毎ターンの記録を行います。
     ///
-    /// @param[in] aResult 現在のターンを表す実行結果。
-    void RecordStage::writeTurn(const TurnResult& aResult)
+    /// ターンの実行結果に加えて、そのターンで起きた順位の変化も記録します。
+    ///
+    /// @param[in] aStage 現在実行しているステージを表す Stage クラスへの参照。
+    void RecordStage::writeTurn(const Stage& aStage)
     {
+        ProfileSample sample(ProfileScope_RecordWrite);
+        const TurnResult& result = aStage.lastTurnResult();
 #ifdef DEBUG
-        HPC_RANGE_ASSERT_MIN_UB_I(mCurrentTurn, 0, HPC_ARRAY_NUM(mTurns));
-        mTurns[mCurrentTurn].set(aResult);
+        mTurns.append(result);
+        const CharaCollection& charas = aStage.charas();
+        HPC_ASSERT_MSG(
+            mRankEventCount + charas.rankEventCount() <= RankEventCountMax
+            , "Too many rank events (%d + %d)", mRankEventCount, charas.rankEventCount()
+            );
+        for (int index = 0; index < charas.rankEventCount(); ++index) {
+            RecordRankEvent& record = mRankEvents[mRankEventCount++];
+            record.turn = mCurrentTurn;
+            record.event = charas.rankEvent(index);
+        }
 #endif
         ++mCurrentTurn;
         // 得点計算のため、失敗したことを記録しておく。
         if (
-            aResult.state == StageState_Failed
-            || aResult.state == StageState_TurnLimit
+            result.state == StageState_Failed
+            || result.state == StageState_TurnLimit
         ) {
             mIsFailed = true;
         }
@@ -76,9 +167,13 @@ namespace hpc {
     /// @param[in] aStage 現在実行しているステージを表す Stage クラスへの参照。
     void RecordStage::writeEnd(const Stage& aStage)
     {
+        ProfileSample sample(ProfileScope_RecordWrite);
         for (int index = 0; index < mCharaCount; ++index) {
             mRanks[index] = aStage.charas()[index].rank();
         }
+#ifdef DEBUG
+        mTurns.finish();
+#endif
         
         // 通過した蓮の数を計算
         const Chara& player = aStage.charas()[0];
@@ -117,6 +212,111 @@ namespace hpc {
         return totalScore;
     }
 
+    //------------------------------------------------------------------------------
+    /// @return キャラ数。
+    int RecordStage::charaCount()const
+    {
+        return mCharaCount;
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return 終了時のターン番号。
+    int RecordStage::turn()const
+    {
+        return mCurrentTurn;
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return プレイヤーの順位。 1 位を 0 とします。
+    int RecordStage::rank()const
+    {
+        return mRanks[0];
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return プレイヤーが通過した蓮の数。
+    int RecordStage::passedLotusCount()const
+    {
+        return mPassedLotusCount;
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return 失敗した、またはターン数の上限に達した場合は @c true を返します。
+    bool RecordStage::isFailed()const
+    {
+        return mIsFailed;
+    }
+
+    //------------------------------------------------------------------------------
+    /// ターンごとの記録の数を返します。
+    ///
+    /// @return 初期状態を含む、記録したターン数。
+    ///         定数 DEBUG が定義されていない場合はターンごとの記録を保持しないので 0 を返します。
+    int RecordStage::recordedTurnCount()const
+    {
+#ifdef DEBUG
+        return mTurns.count();
+#else
+        return 0;
+#endif
+    }
+
+    //------------------------------------------------------------------------------
+    /// ターン1つ分の記録を取得します。
+    ///
+    /// @param[in] aTurn        ターン番号。 0 は初期状態です。
+    /// @param[out] aResult     取得先。
+    ///
+    /// @return 記録が存在すれば @c true を返します。
+    bool RecordStage::readTurn(int aTurn, TurnResult& aResult)const
+    {
+        if (aTurn < 0 || recordedTurnCount() <= aTurn) {
+            return false;
+        }
+#ifdef DEBUG
+        return mTurns.readTurn(aTurn, aResult);
+#else
+        (void)aResult;
+        return true;
+#endif
+    }
+
+    //------------------------------------------------------------------------------
+    /// 順位の変化の記録の数を返します。
+    ///
+    /// @return 記録した順位の変化の数。
+    ///         定数 DEBUG が定義されていない場合は順位の変化を保持しないので 0 を返します。
+    int RecordStage::rankEventCount()const
+    {
+#ifdef DEBUG
+        return mRankEventCount;
+#else
+        return 0;
+#endif
+    }
+
+    //------------------------------------------------------------------------------
+    /// 順位の変化の記録を取得します。
+    ///
+    /// 記録はターン順に並んでいます。
+    ///
+    /// @param[in] aIndex   記録の番号。
+    /// @param[out] aEvent  取得先。
+    ///
+    /// @return 記録が存在すれば @c true を返します。
+    bool RecordStage::readRankEvent(int aIndex, RecordRankEvent& aEvent)const
+    {
+        if (aIndex < 0 || rankEventCount() <= aIndex) {
+            return false;
+        }
+#ifdef DEBUG
+        aEvent = mRankEvents[aIndex];
+#else
+        (void)aEvent;
+#endif
+        return true;
+    }
+
     //------------------------------------------------------------------------------
     /// 記録された結果を画面に出力します。
     void RecordStage::dump()const
@@ -134,8 +334,12 @@ namespace hpc {
             HPC_PRINT_LOG("Lotus", "#%3d: (%7.2f,%7.2f) R=%7.2f\n", 
                 index, lotusRegion.pos().x, lotusRegion.pos().y, lotusRegion.radius());
         }
+        int rankEventIndex = 0;
         for (int index = 0; index < mCurrentTurn; ++index) {
-            const TurnResult& turn = mTurns[index];
+            if (index % TurnCodec::BlockTurnCount == 0) {
+                mTurns.readBlock(index / TurnCodec::BlockTurnCount, sBlockTurns);
+            }
+            const TurnResult& turn = sBlockTurns[index % TurnCodec::BlockTurnCount];
             HPC_PRINT_LOG("Turn", "#%04d: ", index);
             switch(turn.state) {
             case StageState_Playing:
@@ -168,6 +372,10 @@ namespace hpc {
                     );
                 HPC_PRINT("\n");
             }
+            for (; rankEventIndex < mRankEventCount && mRankEvents[rankEventIndex].turn == index; ++rankEventIndex) {
+                const RankEvent& event = mRankEvents[rankEventIndex].event;
+                HPC_PRINT(" rank[%d] - %d -> %d\n", event.charaIndex, event.prevRank, event.rank);
+            }
         }
 #endif
         HPC_PRINT_LOG("Score", "%d\n", static_cast<int>(score()));
@@ -262,7 +470,10 @@ namespace hpc {
             HPC_PRINT_JSON_DEBUG(!isCompressed, "\n");
 
             for (int turn = 0; turn < mCurrentTurn; ++turn) {
-                const TurnResult& s = mTurns[turn];
+                if (turn % TurnCodec::BlockTurnCount == 0) {
+                    mTurns.readBlock(turn / TurnCodec::BlockTurnCount, sBlockTurns);
+                }
+                const TurnResult& s = sBlockTurns[turn % TurnCodec::BlockTurnCount];
                 HPC_PRINT_JSON_DEBUG(!isCompressed, "                "); // インデント (16)
                 HPC_PRINT("[");
                 HPC_PRINT_JSON_DEBUG(!isCompressed, "\n");
@@ -324,6 +535,198 @@ namespace hpc {
 #else
         // デバッグ無効の場合、json 出力はサポートされません。
         HPC_PRINT("[]");
+#endif
+    }
+
+    //------------------------------------------------------------------------------
+    /// 記録された結果を、リプレイファイルの1ステージ分として書き込みます。
+    ///
+    /// 形式は ReplayFormat を参照してください。
+    /// 定数 DEBUG が定義されていない場合、フィールド・蓮・開始位置はゼロとして、
+    /// ターンごとの記録は 0 ターン分として書き込みます。
+    ///
+    /// @param[in] aWriter 書き込み先。
+    void RecordStage::writeReplay(ReplayWriter& aWriter)const
+    {
+        aWriter.writeInt(mCharaCount);
+        aWriter.writeInt(mCurrentTurn);
+        aWriter.writeInt(mPassedLotusCount);
+        aWriter.writeInt(mIsFailed ? 1 : 0);
+        for (int charaIndex = 0; charaIndex < Parameter::CharaCountMax; ++charaIndex) {
+            aWriter.writeInt(mRanks[charaIndex]);
+        }
+
+#ifdef DEBUG
+        const Rectangle& rect = mField.rect();
+        aWriter.writeFloat(rect.left);
+        aWriter.writeFloat(rect.right);
+        aWriter.writeFloat(rect.bottom);
+        aWriter.writeFloat(rect.top);
+        aWriter.writeFloat(mField.flowVel().x);
+        aWriter.writeFloat(mField.flowVel().y);
+        aWriter.writeInt(mLotuses.count());
+        for (int lotusIndex = 0; lotusIndex < mLotuses.count(); ++lotusIndex) {
+            aWriter.writeFloat(mLotuses[lotusIndex].pos().x);
+            aWriter.writeFloat(mLotuses[lotusIndex].pos().y);
+            aWriter.writeFloat(mLotuses[lotusIndex].radius());
+        }
+        for (int charaIndex = 0; charaIndex < Parameter::CharaCountMax; ++charaIndex) {
+            aWriter.writeFloat(mInitPositions[charaIndex].x);
+            aWriter.writeFloat(mInitPositions[charaIndex].y);
+        }
+        aWriter.writeInt(mRankEventCount);
+        for (int index = 0; index < mRankEventCount; ++index) {
+            aWriter.writeInt(mRankEvents[index].turn);
+            aWriter.writeInt(mRankEvents[index].event.charaIndex);
+            aWriter.writeInt(mRankEvents[index].event.prevRank);
+            aWriter.writeInt(mRankEvents[index].event.rank);
+        }
+
+        aWriter.writeInt(recordedTurnCount());
+        mTurns.writeReplay(aWriter);
+#else
+        // フィールド (6 要素)、蓮の数、開始位置、順位の変化の数
+        for (int index = 0; index < 6; ++index) {
+            aWriter.writeFloat(0.0f);
+        }
+        aWriter.writeInt(0);
+        for (int index = 0; index < Parameter::CharaCountMax * 2; ++index) {
+            aWriter.writeFloat(0.0f);
+        }
+        aWriter.writeInt(0);
+        aWriter.writeInt(recordedTurnCount());
+        aWriter.writeInt(0); // ブロックの合計のバイト数
+#endif
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return writeReplay() が書き込む内容のうち、ターンごとの記録のバイト数。
+    int RecordStage::replayTurnSize()const
+    {
+#ifdef DEBUG
+        return mTurns.replaySize();
+#else
+        return 4;
+#endif
+    }
+
+    //------------------------------------------------------------------------------
+    /// リプレイファイルの1ステージ分を読み込み、記録された結果として設定します。
+    ///
+    /// 定数 DEBUG が定義されていない場合、詳細な記録は読み飛ばします。
+    ///
+    /// @param[in] aReader  読み込み元。
+    ///
+    /// @return 正しく読み込めた場合は @c true を返します。
+    bool RecordStage::readReplay(ReplayReader& aReader)
+    {
+        reset();
+        mCharaCount = aReader.readInt();
+        mCurrentTurn = aReader.readInt();
+        mPassedLotusCount = aReader.readInt();
+        mIsFailed = (aReader.readInt() != 0);
+        for (int charaIndex = 0; charaIndex < Parameter::CharaCountMax; ++charaIndex) {
+            mRanks[charaIndex] = aReader.readInt();
+        }
+        if (
+            mCharaCount < Parameter::CharaCountMin || Parameter::CharaCountMax < mCharaCount
+            || mCurrentTurn < 0 || Parameter::GameTurnPerStage + 1 < mCurrentTurn
+            || mPassedLotusCount < 0
+            ) {
+            return false;
+        }
+        // 順位は得点計算で倍率テーブルの添字に使うため、対戦人数の範囲に収まっていなければならない。
+        for (int charaIndex = 0; charaIndex < mCharaCount; ++charaIndex) {
+            if (mRanks[charaIndex] < 0 || mCharaCount <= mRanks[charaIndex]) {
+                return false;
+            }
+        }
+
+        Field field;
+        {
+            Rectangle rect;
+            rect.left = aReader.readFloat();
+            rect.right = aReader.readFloat();
+            rect.bottom = aReader.readFloat();
+            rect.top = aReader.readFloat();
+            Vec2 flowVel;
+            flowVel.x = aReader.readFloat();
+            flowVel.y = aReader.readFloat();
+            field.setup(rect, flowVel);
+        }
+        LotusCollection lotuses;
+        const int lotusCount = aReader.readInt();
+        if (lotusCount < 0 || Parameter::LotusCountMax < lotusCount) {
+            return false;
+        }
+        for (int lotusIndex = 0; lotusIndex < lotusCount; ++lotusIndex) {
+            Vec2 pos;
+            pos.x = aReader.readFloat();
+            pos.y = aReader.readFloat();
+            const float radius = aReader.readFloat();
+            if (!(radius > 0.0f)) {
+                return false;
+            }
+            lotuses.setupAddLotus(pos, radius);
+        }
+        lotuses.setupEnd();
+        Vec2 initPositions[Parameter::CharaCountMax];
+        for (int charaIndex = 0; charaIndex < Parameter::CharaCountMax; ++charaIndex) {
+            initPositions[charaIndex].x = aReader.readFloat();
+            initPositions[charaIndex].y = aReader.readFloat();
+        }
+#ifdef DEBUG
+        mField.set(field);
+        mLotuses.set(lotuses);
+        for (int charaIndex = 0; charaIndex < Parameter::CharaCountMax; ++charaIndex) {
+            mInitPositions[charaIndex] = initPositions[charaIndex];
+        }
+#endif
+
+        const int rankEventCount = aReader.readInt();
+        if (rankEventCount < 0 || RankEventCountMax < rankEventCount) {
+            return false;
+        }
+        int prevTurn = 0;
+        for (int index = 0; index < rankEventCount; ++index) {
+            RecordRankEvent record;
+            record.turn = aReader.readInt();
+            record.event.charaIndex = aReader.readInt();
+            record.event.prevRank = aReader.readInt();
+            record.event.rank = aReader.readInt();
+            if (
+                record.turn < prevTurn || Parameter::GameTurnPerStage < record.turn
+                || record.event.charaIndex < 0 || mCharaCount <= record.event.charaIndex
+                || record.event.prevRank < 0 || mCharaCount <= record.event.prevRank
+                || record.event.rank < 0 || mCharaCount <= record.event.rank
+                ) {
+                return false;
+            }
+            prevTurn = record.turn;
+#ifdef DEBUG
+            mRankEvents[index] = record;
+#endif
+        }
+#ifdef DEBUG
+        mRankEventCount = rankEventCount;
+#endif
+
+        const int turnCount = aReader.readInt();
+        if (turnCount < 0 || Parameter::GameTurnPerStage + 1 < turnCount) {
+            return false;
+        }
+#ifdef DEBUG
+        return mTurns.readReplay(aReader, mCharaCount, turnCount) && aReader.isValid();
+#else
+        // ブロックごとの開始位置のうち、最後の値がブロックの合計のバイト数。
+        const int blockCount = (turnCount + TurnCodec::BlockTurnCount - 1) / TurnCodec::BlockTurnCount;
+        aReader.seek(aReader.position() + 4 * blockCount);
+        const int dataSize = aReader.readInt();
+        if (dataSize < 0) {
+            return false;
+        }
+        aReader.seek(aReader.position() + dataSize);
+        return aReader.isValid();
 #endif
     }
 }
@@ -14,25 +14,69 @@
 #include "HPCParameter.hpp"
 #include "HPCStage.hpp"
 #include "HPCTurnResult.hpp"
+#include "HPCTurnStream.hpp"
 
 namespace hpc {
 
+    class ReplayReader;
+    class ReplayWriter;
+
+    //------------------------------------------------------------------------------
+    /// 記録した順位の変化を表します。
+    struct RecordRankEvent
+    {
+        int turn;           ///< 順位が変わったターン番号。 RecordStage::readTurn() のターン番号と同じです。
+        RankEvent event;    ///< 順位の変化
+    };
+
     //------------------------------------------------------------------------------
     /// @brief 各ステージの記録を表します。
     class RecordStage 
     {
     public:
+        /// 1ステージで記録する順位の変化の数の最大値
+        /// 順位は蓮を通過したターンにしか変わらず、1ターンに変わるのは多くてもキャラ数までなので、
+        /// 全キャラが全周回の蓮を別々のターンに通過し、そのたびに全キャラの順位が変わる場合を上限とします。
+        static const int RankEventCountMax =
+            Parameter::CharaCountMax * Parameter::CharaCountMax * Parameter::LotusCountMax * Parameter::StageRoundCount;
+        /// writeReplay() が書き込むバイト数の最大値
+        static const int ReplaySizeMax =
+            4 * (4 + Parameter::CharaCountMax)          // キャラ数, ターン番号, 通過した蓮の数, 失敗したか, 順位
+            + 4 * 6 + 4 + 12 * Parameter::LotusCountMax // フィールド, 蓮
+            + 8 * Parameter::CharaCountMax              // 開始位置
+            + 4 + 16 * RankEventCountMax                // 順位の変化の数, 順位の変化
+            + 4                                         // 記録したターン数
+            + TurnStream::ReplaySizeMax;
+
         RecordStage();
 
+        void setArena(Arena& aArena);                       ///< ターンごとの記録を格納する領域を設定します。
+        void set(const RecordStage& aRecord);               ///< 記録を複製します。
+        void reset();                                       ///< 記録を初期状態に戻します。
         void writeStart(const Stage& aStage);               ///< 記録を開始します。
-        void writeTurn(const TurnResult& aResult);          ///< 各ターンの内容を記録します。
+        void writeTurn(const Stage& aStage);                ///< 各ターンの内容を記録します。
         void writeEnd(const Stage& aStage);                 ///< 終了時の内容を記録します。
 
         double score()const;                               ///< ステージ毎の得点を返します。
+        int charaCount()const;                             ///< キャラ数を返します。
+        int turn()const;                                   ///< 終了時のターン番号を返します。
+        int rank()const;                                   ///< プレイヤーの順位を返します。
+        int passedLotusCount()const;                       ///< プレイヤーが通過した蓮の数を返します。
+        bool isFailed()const;                              ///< ステージ途中で失敗したかを返します。
+        int recordedTurnCount()const;                      ///< ターンごとの記録の数を返します。
+        bool readTurn(int aTurn, TurnResult& aResult)const; ///< ターン1つ分の記録を取得します。
+        int rankEventCount()const;                         ///< 順位の変化の記録の数を返します。
+        bool readRankEvent(int aIndex, RecordRankEvent& aEvent)const; ///< 順位の変化の記録を取得します。
         void dump()const;                                  ///< 実行結果を画面に表示します。
         void dumpJson(bool aIsCompressed)const;            ///< 実行結果を JSON 形式で画面に表示します。
+        void writeReplay(ReplayWriter& aWriter)const;      ///< 実行結果をリプレイファイルに書き込みます。
+        int replayTurnSize()const;                         ///< リプレイファイルのターンごとの記録のバイト数を返します。
+        bool readReplay(ReplayReader& aReader); ///< リプレイファイルから実行結果を読み込みます。
 
     private:
+        RecordStage(const RecordStage& aRecord);            ///< コピーはできません。 set() を使います。
+        RecordStage& operator=(const RecordStage& aRecord); ///< コピーはできません。 set() を使います。
+
         int mCurrentTurn;                                   ///< 現在のターン番号
         int mRanks[Parameter::CharaCountMax];               ///< 順位
         int mPassedLotusCount;                              ///< 通過した蓮の数
@@ -40,10 +84,12 @@ namespace hpc {
         
         // 詳細な記録は、定数 DEBUG が定義されている場合にのみ表示されます。
 #ifdef DEBUG
-        TurnResult mTurns[Parameter::GameTurnPerStage + 1]; ///< 記録するターン。初期状態を含めるので1多くとる。
+        TurnStream mTurns;                                  ///< 記録するターン。初期状態を含めて圧縮して保持する。
         Field mField;                                       ///< フィールド情報
         LotusCollection mLotuses;                           ///< 蓮情報
         Vec2 mInitPositions[Parameter::CharaCountMax];      ///< 開始位置
+        RecordRankEvent mRankEvents[RankEventCountMax];     ///< 順位の変化。ターン順に並べる。
+        int mRankEventCount;                                ///< 順位の変化の数
 #endif
         bool mIsFailed;     ///< ステージ途中で失敗したか
     };
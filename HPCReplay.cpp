@@ -0,0 +1,693 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    HPCReplay.hpp の実装
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+
+#include "HPCReplay.hpp"
+
+#include <cstring>
+#include "HPCCommon.hpp"
+#include "HPCMath.hpp"
+#include "HPCRecordStage.hpp"
+#include "HPCTurnCodec.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    // new, delete を使うことは出来ないので static な変数として用意します。
+    hpc::TurnResult sBlockTurns[hpc::TurnCodec::BlockTurnCount]; ///< 展開したブロック
+
+    //------------------------------------------------------------------------------
+    /// 4 バイトの値をリトルエンディアンで書き出します。
+    void StoreU32(unsigned int aValue, unsigned char* aBytes)
+    {
+        aBytes[0] = static_cast<unsigned char>(aValue);
+        aBytes[1] = static_cast<unsigned char>(aValue >> 8);
+        aBytes[2] = static_cast<unsigned char>(aValue >> 16);
+        aBytes[3] = static_cast<unsigned char>(aValue >> 24);
+    }
+
+    //------------------------------------------------------------------------------
+    /// リトルエンディアンで格納された 4 バイトの値を読み出します。
+    unsigned int LoadU32(const unsigned char* aBytes)
+    {
+        return static_cast<unsigned int>(aBytes[0])
+            | (static_cast<unsigned int>(aBytes[1]) << 8)
+            | (static_cast<unsigned int>(aBytes[2]) << 16)
+            | (static_cast<unsigned int>(aBytes[3]) << 24);
+    }
+
+    //------------------------------------------------------------------------------
+    /// 実行環境がリトルエンディアンかどうかを返します。
+    bool IsLittleEndian()
+    {
+        const unsigned int value = 1;
+        unsigned char bytes[sizeof(value)];
+        std::memcpy(bytes, &value, sizeof(value));
+        return bytes[0] == 1;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 8 バイトの値の並びを、リトルエンディアンと実行環境の並びの間で入れ替えます。
+    void SwapDoubleBytes(unsigned char* aBytes)
+    {
+        if (IsLittleEndian()) {
+            return;
+        }
+        for (int index = 0; index < 4; ++index) {
+            const unsigned char byte = aBytes[index];
+            aBytes[index] = aBytes[7 - index];
+            aBytes[7 - index] = byte;
+        }
+    }
+}
+
+namespace hpc {
+
+    const char ReplayFormat::Magic[4] = { 'H', 'P', 'C', 'R' };
+
+    //------------------------------------------------------------------------------
+    /// クラスのインスタンスを生成します。
+    ReplayWriter::ReplayWriter()
+        : mFile(0)
+        , mMemory(0)
+        , mMemoryCapacity(0)
+        , mBuffer()
+        , mBufferCount(0)
+        , mFlushedSize(0)
+        , mIsValid(false)
+    {
+    }
+
+    //------------------------------------------------------------------------------
+    /// 開いているファイルがあれば閉じます。
+    ReplayWriter::~ReplayWriter()
+    {
+        close();
+    }
+
+    //------------------------------------------------------------------------------
+    /// 書き込むファイルを開きます。既にファイルがある場合は上書きします。
+    ///
+    /// @param[in] aFileName ファイル名。
+    ///
+    /// @return ファイルを開けたら @c true を返します。
+    bool ReplayWriter::open(const char* aFileName)
+    {
+        close();
+        mFile = std::fopen(aFileName, "wb");
+        mBufferCount = 0;
+        mFlushedSize = 0;
+        mIsValid = (mFile != 0);
+        return mIsValid;
+    }
+
+    //------------------------------------------------------------------------------
+    /// ファイルの代わりにメモリ上の領域に書き込むよう設定します。
+    /// 領域が足りなくなった場合は、書き込み失敗とします。
+    ///
+    /// @param[out] aMemory     書き込み先。
+    /// @param[in] aCapacity    書き込み先のバイト数。
+    ///
+    /// @return 設定できたら @c true を返します。
+    bool ReplayWriter::open(void* aMemory, int aCapacity)
+    {
+        HPC_LB_ASSERT_I(aCapacity, 0);
+        close();
+        mMemory = static_cast<unsigned char*>(aMemory);
+        mMemoryCapacity = aCapacity;
+        mBufferCount = 0;
+        mFlushedSize = 0;
+        mIsValid = (mMemory != 0);
+        return mIsValid;
+    }
+
+    //------------------------------------------------------------------------------
+    /// バッファに残っている値を出力し、ファイルを閉じます。
+    ///
+    /// @return すべての書き込みが成功していれば @c true を返します。
+    bool ReplayWriter::close()
+    {
+        if (mMemory != 0) {
+            mMemory = 0;
+            return mIsValid;
+        }
+        if (mFile == 0) {
+            return false;
+        }
+        flush();
+        if (std::fclose(mFile) != 0) {
+            mIsValid = false;
+        }
+        mFile = 0;
+        return mIsValid;
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return ファイルが開かれていて、ここまでの書き込みが成功していれば @c true を返します。
+    bool ReplayWriter::isValid()const
+    {
+        return mIsValid;
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return 次に書き込む位置。ファイル先頭からのバイト数です。
+    int ReplayWriter::position()const
+    {
+        return mFlushedSize + mBufferCount;
+    }
+
+    //------------------------------------------------------------------------------
+    /// バイト列をそのまま書き込みます。
+    ///
+    /// @param[in] aData 書き込むデータ。
+    /// @param[in] aSize データのバイト数。
+    void ReplayWriter::writeBytes(const void* aData, int aSize)
+    {
+        HPC_LB_ASSERT_I(aSize, 0);
+        if (mMemory != 0) {
+            if (!mIsValid || mMemoryCapacity - mFlushedSize < aSize) {
+                mIsValid = false;
+                return;
+            }
+            std::memcpy(mMemory + mFlushedSize, aData, aSize);
+            mFlushedSize += aSize;
+            return;
+        }
+        const unsigned char* data = static_cast<const unsigned char*>(aData);
+        while (aSize > 0) {
+            if (mBufferCount == BufferSize) {
+                flush();
+            }
+            int size = BufferSize - mBufferCount;
+            if (size > aSize) {
+                size = aSize;
+            }
+            std::memcpy(mBuffer + mBufferCount, data, size);
+            mBufferCount += size;
+            data += size;
+            aSize -= size;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// 整数を 4 バイトのリトルエンディアンで書き込みます。
+    ///
+    /// @param[in] aValue 書き込む値。
+    void ReplayWriter::writeInt(int aValue)
+    {
+        unsigned char bytes[4];
+        StoreU32(static_cast<unsigned int>(aValue), bytes);
+        writeBytes(bytes, sizeof(bytes));
+    }
+
+    //------------------------------------------------------------------------------
+    /// 浮動小数を IEEE 754 単精度の 4 バイトで、リトルエンディアンで書き込みます。
+    ///
+    /// @param[in] aValue 書き込む値。
+    void ReplayWriter::writeFloat(float aValue)
+    {
+        unsigned int bits = 0;
+        std::memcpy(&bits, &aValue, sizeof(bits));
+        unsigned char bytes[4];
+        StoreU32(bits, bytes);
+        writeBytes(bytes, sizeof(bytes));
+    }
+
+    //------------------------------------------------------------------------------
+    /// 浮動小数を IEEE 754 倍精度の 8 バイトで、リトルエンディアンで書き込みます。
+    ///
+    /// @param[in] aValue 書き込む値。
+    void ReplayWriter::writeDouble(double aValue)
+    {
+        unsigned char bytes[8];
+        std::memcpy(bytes, &aValue, sizeof(bytes));
+        SwapDoubleBytes(bytes);
+        writeBytes(bytes, sizeof(bytes));
+    }
+
+    //------------------------------------------------------------------------------
+    /// 書き込み済みの位置の整数を書き換えます。
+    /// 索引のように、後から値が決まる項目に使います。
+    ///
+    /// @param[in] aPosition    書き換える位置。ファイル先頭からのバイト数です。
+    /// @param[in] aValue       書き込む値。
+    ///
+    /// @pre 書き換える 4 バイトは書き込み済みである必要があります。
+    void ReplayWriter::overwriteInt(int aPosition, int aValue)
+    {
+        HPC_RANGE_ASSERT_MIN_UB_I(aPosition, 0, position() - 3);
+        unsigned char bytes[4];
+        StoreU32(static_cast<unsigned int>(aValue), bytes);
+        if (mMemory != 0) {
+            std::memcpy(mMemory + aPosition, bytes, sizeof(bytes));
+            return;
+        }
+        if (aPosition >= mFlushedSize) {
+            std::memcpy(mBuffer + (aPosition - mFlushedSize), bytes, sizeof(bytes));
+            return;
+        }
+        // ファイルに出力済みの場合は、書き換えてから末尾に戻る。
+        flush();
+        if (
+            mFile == 0
+            || std::fseek(mFile, aPosition, SEEK_SET) != 0
+            || std::fwrite(bytes, 1, sizeof(bytes), mFile) != sizeof(bytes)
+            || std::fseek(mFile, 0, SEEK_END) != 0
+            ) {
+            mIsValid = false;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// バッファに溜まった値をファイルに出力します。
+    void ReplayWriter::flush()
+    {
+        if (mFile != 0 && mBufferCount > 0) {
+            if (std::fwrite(mBuffer, 1, mBufferCount, mFile) != static_cast<std::size_t>(mBufferCount)) {
+                mIsValid = false;
+            }
+        }
+        mFlushedSize += mBufferCount;
+        mBufferCount = 0;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 何も読み込めないインスタンスを生成します。
+    ReplayReader::ReplayReader()
+        : mData(0)
+        , mSize(0)
+        , mPosition(0)
+        , mIsValid(false)
+    {
+    }
+
+    //------------------------------------------------------------------------------
+    /// メモリ上のデータを読み込むインスタンスを生成します。
+    ///
+    /// @param[in] aData 読み込むデータ。
+    /// @param[in] aSize データのバイト数。
+    ReplayReader::ReplayReader(const void* aData, int aSize)
+        : mData(static_cast<const unsigned char*>(aData))
+        , mSize(aSize)
+        , mPosition(0)
+        , mIsValid(aData != 0)
+    {
+        HPC_LB_ASSERT_I(aSize, 0);
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return ここまでの読み込みが、すべてデータの範囲内であれば @c true を返します。
+    bool ReplayReader::isValid()const
+    {
+        return mIsValid;
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return 次に読み込む位置。データ先頭からのバイト数です。
+    int ReplayReader::position()const
+    {
+        return mPosition;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 読み込む位置を変更します。範囲外の位置を指定した場合は、読み込み失敗とします。
+    ///
+    /// @param[in] aPosition 位置。データ先頭からのバイト数です。
+    void ReplayReader::seek(int aPosition)
+    {
+        if (aPosition < 0 || mSize < aPosition) {
+            mIsValid = false;
+            mPosition = mSize;
+            return;
+        }
+        mPosition = aPosition;
+    }
+
+    //------------------------------------------------------------------------------
+    /// バイト列をそのまま読み込みます。
+    /// データの終端に達した場合は、ゼロで埋め、読み込み失敗とします。
+    ///
+    /// @param[out] aData 読み込み先。
+    /// @param[in] aSize  読み込むバイト数。
+    void ReplayReader::readBytes(void* aData, int aSize)
+    {
+        HPC_LB_ASSERT_I(aSize, 0);
+        if (!mIsValid || mSize - mPosition < aSize) {
+            mIsValid = false;
+            std::memset(aData, 0, aSize);
+            return;
+        }
+        std::memcpy(aData, mData + mPosition, aSize);
+        mPosition += aSize;
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return 4 バイトのリトルエンディアンで格納された整数。
+    int ReplayReader::readInt()
+    {
+        unsigned char bytes[4];
+        readBytes(bytes, sizeof(bytes));
+        return static_cast<int>(LoadU32(bytes));
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return 4 バイトのリトルエンディアンで格納された浮動小数。
+    float ReplayReader::readFloat()
+    {
+        unsigned char bytes[4];
+        readBytes(bytes, sizeof(bytes));
+        const unsigned int bits = LoadU32(bytes);
+        float value = 0.0f;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return 8 バイトのリトルエンディアンで格納された倍精度の浮動小数。
+    double ReplayReader::readDouble()
+    {
+        unsigned char bytes[8];
+        readBytes(bytes, sizeof(bytes));
+        SwapDoubleBytes(bytes);
+        double value = 0.0;
+        std::memcpy(&value, bytes, sizeof(value));
+        return value;
+    }
+
+    //------------------------------------------------------------------------------
+    /// クラスのインスタンスを生成します。
+    ReplayFile::ReplayFile()
+        : mData(0)
+        , mSize(0)
+#ifdef _WIN32
+        , mFileHandle(INVALID_HANDLE_VALUE)
+        , mMappingHandle(0)
+#endif
+        , mStageOffsets()
+        , mTurnOffsets()
+        , mTurnCounts()
+    {
+    }
+
+    //------------------------------------------------------------------------------
+    /// 開いているファイルがあれば閉じます。
+    ReplayFile::~ReplayFile()
+    {
+        close();
+    }
+
+    //------------------------------------------------------------------------------
+    /// ファイルを開き、ファイルヘッダと索引を確認します。
+    ///
+    /// @param[in] aFileName ファイル名。
+    ///
+    /// @return ファイルを開けて、形式が正しければ @c true を返します。
+    bool ReplayFile::open(const char* aFileName)
+    {
+        close();
+        if (!map(aFileName)) {
+            return false;
+        }
+        ReplayReader reader(mData, mSize);
+        char magic[sizeof(ReplayFormat::Magic)];
+        reader.readBytes(magic, sizeof(magic));
+        const int version = reader.readInt();
+        const int stageCount = reader.readInt();
+        const int charaCountMax = reader.readInt();
+        const bool isValid = reader.isValid()
+            && std::memcmp(magic, ReplayFormat::Magic, sizeof(magic)) == 0
+            && version == ReplayFormat::Version
+            && stageCount == Parameter::GameStageCount
+            && charaCountMax == Parameter::CharaCountMax
+            && readIndex();
+        if (!isValid) {
+            close();
+        }
+        return isValid;
+    }
+
+    //------------------------------------------------------------------------------
+    /// ファイルを閉じます。
+    void ReplayFile::close()
+    {
+        unmap();
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return ファイルを開いていれば @c true を返します。
+    bool ReplayFile::isOpen()const
+    {
+        return mData != 0;
+    }
+
+    //------------------------------------------------------------------------------
+    /// @param[in] aStageIndex ステージ番号。
+    ///
+    /// @return ステージのキャラ数。
+    ///
+    /// @pre ファイルを開いている必要があります。
+    int ReplayFile::charaCount(int aStageIndex)const
+    {
+        HPC_ASSERT(isOpen());
+        HPC_RANGE_ASSERT_MIN_UB_I(aStageIndex, 0, Parameter::GameStageCount);
+        return static_cast<int>(LoadU32(mData + mStageOffsets[aStageIndex] + 4));
+    }
+
+    //------------------------------------------------------------------------------
+    /// @param[in] aStageIndex ステージ番号。
+    ///
+    /// @return ステージの記録したターン数。初期状態を含みます。
+    ///
+    /// @pre ファイルを開いている必要があります。
+    int ReplayFile::turnCount(int aStageIndex)const
+    {
+        HPC_ASSERT(isOpen());
+        HPC_RANGE_ASSERT_MIN_UB_I(aStageIndex, 0, Parameter::GameStageCount);
+        return mTurnCounts[aStageIndex];
+    }
+
+    //------------------------------------------------------------------------------
+    /// ターン1つ分の記録を読み込みます。
+    ///
+    /// @param[in] aStageIndex  ステージ番号。
+    /// @param[in] aTurn        ターン番号。 0 は初期状態です。
+    /// @param[out] aResult     読み込み先。
+    ///
+    /// @return 記録が存在し、正しく読み込めた場合は @c true を返します。
+    ///
+    /// @pre ファイルを開いている必要があります。
+    bool ReplayFile::readTurn(int aStageIndex, int aTurn, TurnResult& aResult)const
+    {
+        if (aTurn < 0 || turnCount(aStageIndex) <= aTurn) {
+            return false;
+        }
+        const TurnResult* const turns = readBlock(aStageIndex, aTurn);
+        if (turns == 0) {
+            return false;
+        }
+        aResult.set(turns[aTurn % TurnCodec::BlockTurnCount]);
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    /// キャラ1人の、ターン1つ分の記録を読み込みます。
+    ///
+    /// @param[in] aStageIndex  ステージ番号。
+    /// @param[in] aTurn        ターン番号。 0 は初期状態です。
+    /// @param[in] aCharaIndex  キャラ番号。
+    /// @param[out] aChara      読み込み先。
+    ///
+    /// @return 記録が存在し、正しく読み込めた場合は @c true を返します。
+    ///
+    /// @pre ファイルを開いている必要があります。
+    bool ReplayFile::readChara(int aStageIndex, int aTurn, int aCharaIndex, TurnResult::Chara& aChara)const
+    {
+        HPC_RANGE_ASSERT_MIN_UB_I(aCharaIndex, 0, Parameter::CharaCountMax);
+        if (aTurn < 0 || turnCount(aStageIndex) <= aTurn) {
+            return false;
+        }
+        const TurnResult* const turns = readBlock(aStageIndex, aTurn);
+        if (turns == 0) {
+            return false;
+        }
+        aChara = turns[aTurn % TurnCodec::BlockTurnCount].charas[aCharaIndex];
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    /// ステージ1つ分の記録を読み込みます。
+    ///
+    /// @param[in] aStageIndex  ステージ番号。
+    /// @param[out] aRecord     読み込み先。
+    ///
+    /// @return 正しく読み込めた場合は @c true を返します。
+    ///
+    /// @pre ファイルを開いている必要があります。
+    bool ReplayFile::readStage(int aStageIndex, RecordStage& aRecord)const
+    {
+        HPC_ASSERT(isOpen());
+        HPC_RANGE_ASSERT_MIN_UB_I(aStageIndex, 0, Parameter::GameStageCount);
+        ReplayReader reader(mData, mSize);
+        reader.seek(mStageOffsets[aStageIndex]);
+        return reader.readInt() == aStageIndex && aRecord.readReplay(reader);
+    }
+
+    //------------------------------------------------------------------------------
+    /// ターンを含むブロックを展開します。
+    ///
+    /// @param[in] aStageIndex  ステージ番号。
+    /// @param[in] aTurn        ターン番号。記録したターン数未満である必要があります。
+    ///
+    /// @return 展開したブロックの先頭。次に呼び出すまで有効です。展開できなかった場合は 0 を返します。
+    const TurnResult* ReplayFile::readBlock(int aStageIndex, int aTurn)const
+    {
+        const int blockIndex = aTurn / TurnCodec::BlockTurnCount;
+        const int blockCount = (mTurnCounts[aStageIndex] + TurnCodec::BlockTurnCount - 1) / TurnCodec::BlockTurnCount;
+        const int dataOffset = mTurnOffsets[aStageIndex] + 4 * (blockCount + 1);
+        ReplayReader reader(mData, mSize);
+        reader.seek(mTurnOffsets[aStageIndex] + 4 * blockIndex);
+        const int begin = reader.readInt();
+        const int end = reader.readInt();
+        if (
+            !reader.isValid()
+            || begin < 0 || end < begin
+            || mSize - dataOffset < end
+            ) {
+            return 0;
+        }
+        const int turnCount = Math::Min(
+            TurnCodec::BlockTurnCount
+            , mTurnCounts[aStageIndex] - blockIndex * TurnCodec::BlockTurnCount
+            );
+        if (!TurnCodec::DecodeBlock(mData + dataOffset + begin, end - begin, turnCount, charaCount(aStageIndex), sBlockTurns)) {
+            return 0;
+        }
+        return sBlockTurns;
+    }
+
+    //------------------------------------------------------------------------------
+    /// ファイル全体を読み込み専用でメモリにマップします。
+    ///
+    /// @param[in] aFileName ファイル名。
+    ///
+    /// @return マップできたら @c true を返します。
+    bool ReplayFile::map(const char* aFileName)
+    {
+#ifdef _WIN32
+        mFileHandle = CreateFileA(
+            aFileName, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0
+            );
+        if (mFileHandle == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(mFileHandle, &size) || size.QuadPart <= 0 || size.QuadPart > 0x7fffffff) {
+            unmap();
+            return false;
+        }
+        mMappingHandle = CreateFileMappingA(mFileHandle, 0, PAGE_READONLY, 0, 0, 0);
+        if (mMappingHandle == 0) {
+            unmap();
+            return false;
+        }
+        mData = static_cast<const unsigned char*>(MapViewOfFile(mMappingHandle, FILE_MAP_READ, 0, 0, 0));
+        mSize = mData != 0 ? static_cast<int>(size.QuadPart) : 0;
+#else
+        const int fd = ::open(aFileName, O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat status;
+        if (fstat(fd, &status) != 0 || status.st_size <= 0 || status.st_size > 0x7fffffff) {
+            ::close(fd);
+            return false;
+        }
+        // マップした内容はファイルを閉じた後も参照できる。
+        void* const memory = mmap(0, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (memory == MAP_FAILED) {
+            return false;
+        }
+        mData = static_cast<const unsigned char*>(memory);
+        mSize = static_cast<int>(status.st_size);
+#endif
+        return mData != 0;
+    }
+
+    //------------------------------------------------------------------------------
+    /// マップを解除します。
+    void ReplayFile::unmap()
+    {
+#ifdef _WIN32
+        if (mData != 0) {
+            UnmapViewOfFile(mData);
+        }
+        if (mMappingHandle != 0) {
+            CloseHandle(mMappingHandle);
+            mMappingHandle = 0;
+        }
+        if (mFileHandle != INVALID_HANDLE_VALUE) {
+            CloseHandle(mFileHandle);
+            mFileHandle = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (mData != 0) {
+            munmap(const_cast<unsigned char*>(mData), mSize);
+        }
+#endif
+        mData = 0;
+        mSize = 0;
+    }
+
+    //------------------------------------------------------------------------------
+    /// ファイルヘッダに続く索引を読み込み、範囲を確認します。
+    ///
+    /// @return 索引が正しければ @c true を返します。
+    bool ReplayFile::readIndex()
+    {
+        ReplayReader reader(mData, mSize);
+        reader.seek(ReplayFormat::HeaderSize);
+        const int stagesOffset = ReplayFormat::HeaderSize + ReplayFormat::IndexEntrySize * Parameter::GameStageCount;
+        for (int index = 0; index < Parameter::GameStageCount; ++index) {
+            const int stageOffset = reader.readInt();
+            const int turnOffset = reader.readInt();
+            const int turnCount = reader.readInt();
+            // ステージヘッダの固定長の部分と、ブロックの開始位置がファイルに収まっているか。
+            const int blockCount = (turnCount + TurnCodec::BlockTurnCount - 1) / TurnCodec::BlockTurnCount;
+            if (
+                stageOffset < stagesOffset || mSize - 8 < stageOffset
+                || turnOffset < stageOffset || mSize < turnOffset
+                || turnCount < 0 || Parameter::GameTurnPerStage + 1 < turnCount
+                || (mSize - turnOffset) / 4 < blockCount + 1
+                ) {
+                return false;
+            }
+            // キャラ数は展開に使うので、ここで確認しておく。
+            const int charaCount = static_cast<int>(LoadU32(mData + stageOffset + 4));
+            if (charaCount < 0 || Parameter::CharaCountMax < charaCount) {
+                return false;
+            }
+            mStageOffsets[index] = stageOffset;
+            mTurnOffsets[index] = turnOffset;
+            mTurnCounts[index] = turnCount;
+        }
+        return reader.isValid();
+    }
+}
+
+//------------------------------------------------------------------------------
+// EOF
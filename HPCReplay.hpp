@@ -0,0 +1,162 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    ReplayWriter, ReplayReader, ReplayFile クラス
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+#pragma once
+
+#include <cstdio>
+#include "HPCParameter.hpp"
+#include "HPCTurnResult.hpp"
+
+namespace hpc {
+
+    class RecordStage;
+
+    //------------------------------------------------------------------------------
+    /// リプレイファイルの形式を表します。
+    ///
+    /// リプレイファイルは、実行結果をバイナリで保存したものです。
+    /// 値はすべて 4 バイトのリトルエンディアンで格納されます。
+    ///
+    ///   項目                  | 内容
+    ///  -----------------------|----------------------------------------------
+    ///   ファイルヘッダ        | マジック "HPCR", バージョン, ステージ数, キャラ数の最大値
+    ///   索引 × ステージ数     | ステージの位置, ターンごとの記録の位置, 記録したターン数
+    ///   ステージ × ステージ数 | ステージ番号, ステージヘッダ, ターンごとの記録
+    ///
+    /// ステージヘッダには、得点の計算に使う値・フィールド・蓮・開始位置・順位の変化・記録したターン数が含まれます。
+    /// 順位の変化は、数と、 (ターン番号, キャラ番号, 変わる前の順位, 変わった後の順位) の並びです。
+    /// ターンごとの記録は、 TurnCodec で圧縮したブロックの開始位置 (ブロック数 + 1 個) と、
+    /// ブロックの並びです。開始位置は最初のブロックの先頭からのバイト数で、最後の値はブロックの合計のバイト数です。
+    /// 索引の位置は、ファイル先頭からのバイト数です。
+    ///
+    /// 索引を使うと、ファイル全体を読まずに任意のステージ・ターンの記録を参照できます。
+    ///
+    /// 読み込めるのは、バージョンが Version と同じファイルだけです。
+    class ReplayFormat
+    {
+    public:
+        static const int Version = 4;           ///< 形式のバージョン
+        static const char Magic[4];             ///< ファイル先頭のマジック
+        static const int HeaderSize = 16;       ///< ファイルヘッダのバイト数
+        static const int IndexEntrySize = 12;   ///< ステージ1つ分の索引のバイト数
+
+    private:
+        ReplayFormat();
+    };
+
+    //------------------------------------------------------------------------------
+    /// リプレイファイルを書き込みます。
+    ///
+    /// 書き込む値は内部のバッファに溜め、まとめてファイルに出力します。
+    /// ファイルの代わりに、メモリ上の領域に書き込むこともできます。
+    class ReplayWriter
+    {
+    public:
+        ReplayWriter();
+        ~ReplayWriter();
+
+        bool open(const char* aFileName);   ///< ファイルを開きます。
+        bool open(void* aMemory, int aCapacity); ///< メモリ上の領域に書き込むよう設定します。
+        bool close();                       ///< バッファを出力してファイルを閉じます。
+        bool isValid()const;               ///< ここまでの書き込みが成功しているかを返します。
+        int position()const;               ///< 次に書き込む位置を返します。
+
+        void writeBytes(const void* aData, int aSize);  ///< バイト列を書き込みます。
+        void writeInt(int aValue);                      ///< 整数を書き込みます。
+        void writeFloat(float aValue);                  ///< 浮動小数を書き込みます。
+        void writeDouble(double aValue);                ///< 倍精度の浮動小数を書き込みます。
+        void overwriteInt(int aPosition, int aValue);   ///< 書き込み済みの位置の整数を書き換えます。
+
+    private:
+        static const int BufferSize = 1 << 16;  ///< バッファの大きさ
+
+        void flush();                           ///< バッファをファイルに出力します。
+
+        std::FILE* mFile;                       ///< 出力先
+        unsigned char* mMemory;                 ///< メモリ上の出力先
+        int mMemoryCapacity;                    ///< メモリ上の出力先のバイト数
+        unsigned char mBuffer[BufferSize];      ///< バッファ
+        int mBufferCount;                       ///< バッファに溜まっているバイト数
+        int mFlushedSize;                       ///< ファイルに出力済みのバイト数
+        bool mIsValid;                          ///< 書き込みが成功しているか
+    };
+
+    //------------------------------------------------------------------------------
+    /// メモリ上のリプレイファイルの内容を読み込みます。
+    ///
+    /// 範囲外を読み込もうとした後は、値としてゼロを返し続けます。
+    /// 読み込みの最後に isValid() で成否を確認します。
+    class ReplayReader
+    {
+    public:
+        ReplayReader();
+        ReplayReader(const void* aData, int aSize);
+
+        bool isValid()const;               ///< ここまでの読み込みが成功しているかを返します。
+        int position()const;               ///< 次に読み込む位置を返します。
+        void seek(int aPosition);           ///< 読み込む位置を変更します。
+
+        void readBytes(void* aData, int aSize);         ///< バイト列を読み込みます。
+        int readInt();                                  ///< 整数を読み込みます。
+        float readFloat();                              ///< 浮動小数を読み込みます。
+        double readDouble();                            ///< 倍精度の浮動小数を読み込みます。
+
+    private:
+        const unsigned char* mData;             ///< 入力元
+        int mSize;                              ///< 入力元のバイト数
+        int mPosition;                          ///< 読み込み位置
+        bool mIsValid;                          ///< 読み込みが成功しているか
+    };
+
+    //------------------------------------------------------------------------------
+    /// リプレイファイルをメモリにマップし、索引を使って記録を参照します。
+    ///
+    /// ファイルを開いた時点では索引だけを確認するので、
+    /// 記録の量によらず、任意のステージ・ターン・キャラの記録を定数時間で参照できます。
+    /// 記録は、そのターンを含むブロック1つだけを展開します。
+    class ReplayFile
+    {
+    public:
+        ReplayFile();
+        ~ReplayFile();
+
+        bool open(const char* aFileName);   ///< ファイルを開きます。
+        void close();                       ///< ファイルを閉じます。
+        bool isOpen()const;                ///< ファイルを開いているかを返します。
+
+        int charaCount(int aStageIndex)const;              ///< ステージのキャラ数を返します。
+        int turnCount(int aStageIndex)const;               ///< ステージの記録したターン数を返します。
+        /// ターン1つ分の記録を読み込みます。
+        bool readTurn(int aStageIndex, int aTurn, TurnResult& aResult)const;
+        /// キャラ1人の、ターン1つ分の記録を読み込みます。
+        bool readChara(int aStageIndex, int aTurn, int aCharaIndex, TurnResult::Chara& aChara)const;
+        /// ステージ1つ分の記録を読み込みます。
+        bool readStage(int aStageIndex, RecordStage& aRecord)const;
+
+    private:
+        bool map(const char* aFileName);    ///< ファイルをメモリにマップします。
+        void unmap();                       ///< マップを解除します。
+        bool readIndex();                   ///< ファイルヘッダに格納された索引を読み込みます。
+        /// ターンを含むブロックを展開します。
+        const TurnResult* readBlock(int aStageIndex, int aTurn)const;
+
+        const unsigned char* mData;                         ///< マップしたファイルの内容
+        int mSize;                                          ///< ファイルのバイト数
+#ifdef _WIN32
+        void* mFileHandle;                                  ///< ファイルのハンドル
+        void* mMappingHandle;                               ///< マップのハンドル
+#endif
+        int mStageOffsets[Parameter::GameStageCount];       ///< ステージの位置
+        int mTurnOffsets[Parameter::GameStageCount];        ///< ターンごとの記録 (ブロックの開始位置) の位置
+        int mTurnCounts[Parameter::GameStageCount];         ///< 記録したターン数
+    };
+}
+//------------------------------------------------------------------------------
+// EOF
@@ -0,0 +1,196 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    HPCSeedList.hpp の実装
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+
+#include "HPCSeedList.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "HPCCommon.hpp"
+
+namespace {
+
+    //------------------------------------------------------------------------------
+    /// 空白文字かどうかを返します。
+    bool IsSpace(char aChar)
+    {
+        return aChar == ' ' || aChar == '\t' || aChar == '\r' || aChar == '\n';
+    }
+
+    //------------------------------------------------------------------------------
+    /// 文字列の先頭から 32 ビットの符号なし整数を1つ読み取ります。
+    ///
+    /// @param[in] aText    読み取る文字列。
+    /// @param[out] aValue  読み取った値。
+    ///
+    /// @return 読み取った値の直後の位置。読み取れなかった場合は 0 を返します。
+    const char* ParseUint(const char* aText, uint& aValue)
+    {
+        // strtoul は符号や空白を受け付けるので、数字から始まることを確認しておく。
+        if (*aText < '0' || '9' < *aText) {
+            return 0;
+        }
+        char* end = 0;
+        const unsigned long value = std::strtoul(aText, &end, 0);
+        if (end == aText || value > 0xFFFFFFFFul) {
+            return 0;
+        }
+        if (*end != '\0' && !IsSpace(*end) && *end != '#') {
+            return 0;
+        }
+        aValue = static_cast<uint>(value);
+        return end;
+    }
+}
+
+namespace hpc {
+
+    //------------------------------------------------------------------------------
+    /// 空のシードの一覧を生成します。
+    SeedList::SeedList()
+        : mCount(0)
+        , mErrorLine(0)
+    {
+    }
+
+    //------------------------------------------------------------------------------
+    /// シードをすべて取り除きます。
+    void SeedList::reset()
+    {
+        mCount = 0;
+        mErrorLine = 0;
+    }
+
+    //------------------------------------------------------------------------------
+    /// シードを1つ加えます。
+    ///
+    /// @param[in] aSeed 加えるシード。
+    ///
+    /// @return 加えられた場合は @c true を返します。
+    ///         シードの数が最大値に達している場合や、無効なシードの場合は @c false を返します。
+    bool SeedList::add(const RandomSeed& aSeed)
+    {
+        if (mCount >= SeedCountMax) {
+            return false;
+        }
+        if ((aSeed.x == 0 && aSeed.y == 0) || (aSeed.z == 0 && aSeed.w == 0)) {
+            return false;
+        }
+        mValues[mCount][0] = aSeed.x;
+        mValues[mCount][1] = aSeed.y;
+        mValues[mCount][2] = aSeed.z;
+        mValues[mCount][3] = aSeed.w;
+        ++mCount;
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    /// ファイルからシードを読み込み、一覧の末尾に加えます。
+    ///
+    /// @param[in] aFileName シードの一覧を記述したファイル名。
+    ///
+    /// @return すべての行を読み込めた場合は @c true を返します。
+    ///         失敗した場合は、 errorLine() で失敗した行番号を取得できます。
+    ///         ファイルを開けなかった場合の行番号は 0 です。
+    bool SeedList::load(const char* aFileName)
+    {
+        HPC_ASSERT(aFileName != 0);
+        mErrorLine = 0;
+        std::FILE* const file = std::fopen(aFileName, "r");
+        if (file == 0) {
+            return false;
+        }
+
+        char line[LineLengthMax + 2];
+        int lineNumber = 0;
+        bool isSucceeded = true;
+        while (std::fgets(line, sizeof(line), file) != 0) {
+            ++lineNumber;
+            const int length = static_cast<int>(std::strlen(line));
+            const bool isTooLong = length > LineLengthMax && line[length - 1] != '\n';
+            if (isTooLong || !parseLine(line)) {
+                mErrorLine = lineNumber;
+                isSucceeded = false;
+                break;
+            }
+        }
+        if (std::ferror(file)) {
+            isSucceeded = false;
+        }
+        std::fclose(file);
+        return isSucceeded;
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return シードの数。
+    int SeedList::count()const
+    {
+        return mCount;
+    }
+
+    //------------------------------------------------------------------------------
+    /// @param[in] aIndex シードの番号。
+    ///
+    /// @return 加えた順で aIndex 番目のシード。
+    RandomSeed SeedList::seed(int aIndex)const
+    {
+        HPC_RANGE_ASSERT_MIN_UB_I(aIndex, 0, mCount);
+        return RandomSeed(mValues[aIndex][0], mValues[aIndex][1], mValues[aIndex][2], mValues[aIndex][3]);
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return 最後の load() で読み込みに失敗した行番号。 1 から数えます。
+    ///         失敗していない場合や、ファイルを開けなかった場合は 0 を返します。
+    int SeedList::errorLine()const
+    {
+        return mErrorLine;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 1行を解析し、シードが記述されていれば加えます。
+    ///
+    /// @param[in] aLine 解析する行。
+    ///
+    /// @return 空行・コメントのみの行、またはシードを加えられた場合は @c true を返します。
+    bool SeedList::parseLine(const char* aLine)
+    {
+        uint values[4];
+        int valueCount = 0;
+        const char* text = aLine;
+        while (true) {
+            while (IsSpace(*text)) {
+                ++text;
+            }
+            if (*text == '\0' || *text == '#') {
+                break;
+            }
+            if (valueCount >= 4) {
+                return false;
+            }
+            text = ParseUint(text, values[valueCount]);
+            if (text == 0) {
+                return false;
+            }
+            ++valueCount;
+        }
+
+        if (valueCount == 0) {
+            return true;
+        }
+        if (valueCount != 4) {
+            return false;
+        }
+        return add(RandomSeed(values[0], values[1], values[2], values[3]));
+    }
+}
+
+//------------------------------------------------------------------------------
+// EOF
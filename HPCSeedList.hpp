@@ -0,0 +1,57 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    SeedList クラス
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "HPCRandomSeed.hpp"
+#include "HPCTypes.hpp"
+
+namespace hpc {
+
+    //------------------------------------------------------------------------------
+    /// 複数の乱数のシードを保持します。
+    ///
+    /// シードの一覧はテキストファイルから読み込みます。
+    /// 1行に1つのシードを、 x y z w の4つの値で空白区切りで記述します。
+    /// 値は 10 進数、または 0x から始まる 16 進数で指定します。
+    /// 空行と、 # から行末まではコメントとして無視します。
+    ///
+    /// @code
+    /// # x          y          z          w
+    /// 2942096179 2745714780 3684690907 3549078838
+    /// 0x12345678 0x9abcdef0 0x0fedcba9 0x87654321
+    /// @endcode
+    ///
+    /// (x, y) と (z, w) は、それぞれ Random の状態になるので、両方が 0 の組は指定できません。
+    class SeedList
+    {
+    public:
+        static const int SeedCountMax = 1 << 16;    ///< 保持できるシードの数の最大値
+        static const int LineLengthMax = 256;       ///< 1行の文字数の最大値
+
+        SeedList();
+
+        void reset();                               ///< シードをすべて取り除きます。
+        bool add(const RandomSeed& aSeed);          ///< シードを1つ加えます。
+        bool load(const char* aFileName);           ///< ファイルからシードを読み込みます。
+        int count()const;                          ///< シードの数を返します。
+        RandomSeed seed(int aIndex)const;          ///< シードを返します。
+        int errorLine()const;                      ///< 読み込みに失敗した行番号を返します。
+
+    private:
+        bool parseLine(const char* aLine);          ///< 1行を解析してシードを加えます。
+
+        uint mValues[SeedCountMax][4];              ///< シードの値
+        int mCount;                                 ///< シードの数
+        int mErrorLine;                             ///< 読み込みに失敗した行番号。失敗していなければ 0。
+    };
+}
+//------------------------------------------------------------------------------
+// EOF
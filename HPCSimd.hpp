@@ -0,0 +1,39 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    SIMD 命令の利用設定
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+#pragma once
+
+//------------------------------------------------------------------------------
+// コンパイラが対応している SIMD 命令に応じて、以下の定数を定義します。
+//
+//   定数           | 説明
+//  ----------------|----------------------------------------------
+//   HPC_SIMD_SSE2  | SSE2 命令を使用します。
+//   HPC_SIMD_AVX2  | AVX2 命令を使用します。 HPC_SIMD_SSE2 も定義されます。
+//
+// HPC_SIMD_DISABLE を定義すると、いずれも定義されず、スカラー演算のみを使用します。
+//
+// 浮動小数の演算は、スカラー演算と同じ順序で行うため、結果は完全に一致します。
+// FMA 命令で積和を1つの命令にまとめると丸め誤差が変わるため、
+// FMA 命令を有効にしてビルドする場合は -ffp-contract=off を指定してください。
+
+#if !defined(HPC_SIMD_DISABLE)
+    #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #define HPC_SIMD_SSE2
+        #include <emmintrin.h>
+    #endif
+    #if defined(HPC_SIMD_SSE2) && defined(__AVX2__)
+        #define HPC_SIMD_AVX2
+        #include <immintrin.h>
+    #endif
+#endif
+
+//------------------------------------------------------------------------------
+// EOF
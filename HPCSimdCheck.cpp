@@ -0,0 +1,346 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    HPCSimdCheck.hpp の実装
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+
+#include "HPCSimdCheck.hpp"
+
+#include <cstring>
+#include "HPCCollision.hpp"
+#include "HPCCommon.hpp"
+#include "HPCMath.hpp"
+#include "HPCRandom.hpp"
+#include "HPCRandomLanes.hpp"
+#include "HPCRandomSeed.hpp"
+#include "HPCSimd.hpp"
+
+namespace {
+
+    using namespace hpc;
+
+    /// 入力の要素数の上限
+    const int ElementCountMax = SimdCheck::ElementCountMax;
+
+    /// RandomLanes::fillU32() に1回に渡す要素数の最大値。バッファを使い切る境界をまたぐ数も含めます。
+    const int LaneValueCountMax = RandomLanes::BufferCount + RandomLanes::LaneCount + 1;
+    /// SimdCheck::Run() はレーンごとの Random を4つ用意する
+    typedef char LaneCountCheck[RandomLanes::LaneCount == 4 ? 1 : -1];
+
+    /// 座標を取る範囲の半分の大きさ
+    const float CoordRange = 4.0f;
+
+    /// 1ケース分の入力
+    struct CheckInput
+    {
+        int count;                      ///< 要素数
+        float x0s[ElementCountMax];     ///< 1つ目の x 座標
+        float y0s[ElementCountMax];     ///< 1つ目の y 座標
+        float radius0s[ElementCountMax];///< 1つ目の半径
+        float x1s[ElementCountMax];     ///< 2つ目の x 座標
+        float y1s[ElementCountMax];     ///< 2つ目の y 座標
+        float radius1s[ElementCountMax];///< 2つ目の半径
+        float px1s[ElementCountMax];    ///< 2つ目の移動後の x 座標
+        float py1s[ElementCountMax];    ///< 2つ目の移動後の y 座標
+    };
+
+    //------------------------------------------------------------------------------
+    /// [-CoordRange, CoordRange) の範囲の値を返します。
+    ///
+    /// 4つに1つは 1/4 刻みに丸め、計算がちょうど境界の値になる入力を作ります。
+    float MakeCoord(float aValue, int aKind)
+    {
+        const float coord = (aValue * 2.0f - 1.0f) * CoordRange;
+        return aKind == 0 ? static_cast<float>(Math::Ceil(coord * 4.0f)) / 4.0f : coord;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 乱数で入力を作ります。
+    ///
+    /// 移動していない円、長さ 0 のベクトル、移動量が減速量より小さいベクトルも含めます。
+    void MakeInput(Random& aRandom, CheckInput& aInput)
+    {
+        aInput.count = aRandom.randMinMax(1, ElementCountMax);
+        float values[8];
+        for (int index = 0; index < aInput.count; ++index) {
+            aRandom.fillFloat(values, 8);
+            const int kind = aRandom.randTerm(4);
+            aInput.x0s[index] = MakeCoord(values[0], kind);
+            aInput.y0s[index] = MakeCoord(values[1], kind);
+            aInput.radius0s[index] = MakeCoord(values[2], 0) * 0.5f + CoordRange * 0.5f;
+            aInput.x1s[index] = MakeCoord(values[3], kind);
+            aInput.y1s[index] = MakeCoord(values[4], kind);
+            aInput.radius1s[index] = MakeCoord(values[5], 0) * 0.5f + CoordRange * 0.5f;
+            switch (aRandom.randTerm(8)) {
+            case 0:
+                // 移動していない
+                aInput.px1s[index] = aInput.x1s[index];
+                aInput.py1s[index] = aInput.y1s[index];
+                break;
+            case 1:
+                // 長さ 0 のベクトル
+                aInput.x1s[index] = 0.0f;
+                aInput.y1s[index] = 0.0f;
+                aInput.px1s[index] = 0.0f;
+                aInput.py1s[index] = 0.0f;
+                break;
+            case 2:
+                // 減速量より短いベクトル
+                aInput.x1s[index] *= 1.0f / 64.0f;
+                aInput.y1s[index] *= 1.0f / 64.0f;
+                aInput.px1s[index] = MakeCoord(values[6], kind);
+                aInput.py1s[index] = MakeCoord(values[7], kind);
+                break;
+            default:
+                aInput.px1s[index] = MakeCoord(values[6], kind);
+                aInput.py1s[index] = MakeCoord(values[7], kind);
+                break;
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// 2つの float がビット単位で一致するかを返します。
+    bool IsSameBits(float aLhs, float aRhs)
+    {
+        return std::memcmp(&aLhs, &aRhs, sizeof(float)) == 0;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 一致しなかった要素を表示します。
+    void PrintMismatch(const char* aName, int aCase, int aIndex, const CheckInput& aInput)
+    {
+        HPC_PRINT(
+            "  %s: case %d, element %d/%d: (%a, %a, %a) (%a, %a, %a) -> (%a, %a)\n"
+            , aName
+            , aCase
+            , aIndex
+            , aInput.count
+            , aInput.x0s[aIndex]
+            , aInput.y0s[aIndex]
+            , aInput.radius0s[aIndex]
+            , aInput.x1s[aIndex]
+            , aInput.y1s[aIndex]
+            , aInput.radius1s[aIndex]
+            , aInput.px1s[aIndex]
+            , aInput.py1s[aIndex]
+            );
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return 一致しなかった要素の数。
+    int CheckIsHitPoints(int aCase, const CheckInput& aInput)
+    {
+        const Circle circle(Vec2(aInput.x0s[0], aInput.y0s[0]), aInput.radius0s[0]);
+        bool results[ElementCountMax];
+        Collision::IsHitPoints(circle, aInput.x1s, aInput.y1s, aInput.count, results);
+        const float squareRadius = circle.radius() * circle.radius();
+        int mismatchCount = 0;
+        for (int index = 0; index < aInput.count; ++index) {
+            const bool expected = circle.pos().squareDist(Vec2(aInput.x1s[index], aInput.y1s[index])) <= squareRadius;
+            if (results[index] != expected) {
+                PrintMismatch("IsHitPoints", aCase, index, aInput);
+                ++mismatchCount;
+            }
+        }
+        return mismatchCount;
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return 一致しなかった要素の数。
+    int CheckIsHitSwept(int aCase, const CheckInput& aInput)
+    {
+        bool results[ElementCountMax];
+        Collision::IsHitSwept(
+            aInput.x0s
+            , aInput.y0s
+            , aInput.radius0s
+            , aInput.x1s
+            , aInput.y1s
+            , aInput.radius1s
+            , aInput.px1s
+            , aInput.py1s
+            , aInput.count
+            , results
+            );
+        int mismatchCount = 0;
+        for (int index = 0; index < aInput.count; ++index) {
+            const bool expected = Collision::IsHit(
+                Circle(Vec2(aInput.x0s[index], aInput.y0s[index]), aInput.radius0s[index])
+                , Circle(Vec2(aInput.x1s[index], aInput.y1s[index]), aInput.radius1s[index])
+                , Vec2(aInput.px1s[index], aInput.py1s[index])
+                );
+            if (results[index] != expected) {
+                PrintMismatch("IsHitSwept", aCase, index, aInput);
+                ++mismatchCount;
+            }
+        }
+        return mismatchCount;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 静止している円が1つの場合の IsHitSwept を調べます。
+    ///
+    /// @return 一致しなかった要素の数。
+    int CheckIsHitSweptFixed(int aCase, const CheckInput& aInput)
+    {
+        const Circle circle(Vec2(aInput.x0s[0], aInput.y0s[0]), aInput.radius0s[0]);
+        const float radius1 = aInput.radius1s[0];
+        bool results[ElementCountMax];
+        Collision::IsHitSwept(
+            circle
+            , radius1
+            , aInput.x1s
+            , aInput.y1s
+            , aInput.px1s
+            , aInput.py1s
+            , aInput.count
+            , results
+            );
+        int mismatchCount = 0;
+        for (int index = 0; index < aInput.count; ++index) {
+            const bool expected = Collision::IsHit(
+                circle
+                , Circle(Vec2(aInput.x1s[index], aInput.y1s[index]), radius1)
+                , Vec2(aInput.px1s[index], aInput.py1s[index])
+                );
+            if (results[index] != expected) {
+                PrintMismatch("IsHitSwept (fixed)", aCase, index, aInput);
+                ++mismatchCount;
+            }
+        }
+        return mismatchCount;
+    }
+
+    //------------------------------------------------------------------------------
+    /// ShortenBatch を、 (x1, y1) のベクトルを減速量 radius0 だけ縮める入力で調べます。
+    ///
+    /// @return 一致しなかった要素の数。
+    int CheckShortenBatch(int aCase, const CheckInput& aInput)
+    {
+        const float amount = aInput.radius0s[0] * (1.0f / 8.0f);
+        float xs[ElementCountMax];
+        float ys[ElementCountMax];
+        std::memcpy(xs, aInput.x1s, sizeof(float) * aInput.count);
+        std::memcpy(ys, aInput.y1s, sizeof(float) * aInput.count);
+        Vec2::ShortenBatch(xs, ys, amount, aInput.count);
+        int mismatchCount = 0;
+        for (int index = 0; index < aInput.count; ++index) {
+            Vec2 expected(aInput.x1s[index], aInput.y1s[index]);
+            if (!expected.isZero()) {
+                const float len = Math::Max(expected.length() - amount, 0.0f);
+                if (0.0f < len) {
+                    expected.normalize(len);
+                } else {
+                    expected.reset();
+                }
+            }
+            if (!IsSameBits(xs[index], expected.x) || !IsSameBits(ys[index], expected.y)) {
+                PrintMismatch("ShortenBatch", aCase, index, aInput);
+                ++mismatchCount;
+            }
+        }
+        return mismatchCount;
+    }
+
+    //------------------------------------------------------------------------------
+    /// RandomLanes::fillU32() の値を、レーンごとの Random::fillU32() の値を交互に並べたものと比べます。
+    ///
+    /// @param[in] aCase                ケースの番号。
+    /// @param[in] aCount               発生させる値の数。
+    /// @param[in,out] aLanes           調べる RandomLanes 。
+    /// @param[in,out] aLaneRandoms     レーンごとの Random 。
+    /// @param[in,out] aNextLane        次の値を発生させるレーン。
+    ///
+    /// @return 一致しなかった値の数。
+    int CheckRandomLanes(int aCase, int aCount, RandomLanes& aLanes, Random* aLaneRandoms, int& aNextLane)
+    {
+        uint values[LaneValueCountMax];
+        aLanes.fillU32(values, aCount);
+        int mismatchCount = 0;
+        for (int index = 0; index < aCount; ++index) {
+            uint expected = 0;
+            aLaneRandoms[aNextLane].fillU32(&expected, 1);
+            if (values[index] != expected) {
+                HPC_PRINT("RandomLanes mismatch: case %d, index %d, lane %d\n", aCase, index, aNextLane);
+                ++mismatchCount;
+            }
+            aNextLane = (aNextLane + 1) % RandomLanes::LaneCount;
+        }
+        return mismatchCount;
+    }
+}
+
+namespace hpc {
+
+    //------------------------------------------------------------------------------
+    /// すべての関数を CaseCount 回ずつ調べ、関数ごとの結果を表示します。
+    ///
+    /// 一致しなかった要素は、入力の値とともに表示します。
+    ///
+    /// @return すべての結果が一致した場合は @c true 。
+    bool SimdCheck::Run()
+    {
+#if defined(HPC_SIMD_AVX2)
+        HPC_PRINT("SIMD: AVX2\n");
+#elif defined(HPC_SIMD_SSE2)
+        HPC_PRINT("SIMD: SSE2\n");
+#else
+        HPC_PRINT("SIMD: disabled\n");
+#endif
+        const RandomSeed seed;
+        Random random(seed.x, seed.y);
+        RandomLanes lanes(random);
+        // レーンごとの Random は、 RandomLanes と同じ区間から始める
+        Random laneRandoms[RandomLanes::LaneCount] = {
+            random.substream(RandomLanes::FirstSubstreamIndex)
+            , random.substream(RandomLanes::FirstSubstreamIndex + 1)
+            , random.substream(RandomLanes::FirstSubstreamIndex + 2)
+            , random.substream(RandomLanes::FirstSubstreamIndex + 3)
+            };
+        int nextLane = 0;
+        int mismatchCounts[5] = { 0, 0, 0, 0, 0 };
+        for (int caseIndex = 0; caseIndex < CaseCount; ++caseIndex) {
+            CheckInput input;
+            MakeInput(random, input);
+            mismatchCounts[0] += CheckIsHitPoints(caseIndex, input);
+            mismatchCounts[1] += CheckIsHitSwept(caseIndex, input);
+            mismatchCounts[2] += CheckIsHitSweptFixed(caseIndex, input);
+            mismatchCounts[3] += CheckShortenBatch(caseIndex, input);
+            mismatchCounts[4] += CheckRandomLanes(
+                caseIndex
+                , random.randMinMax(1, LaneValueCountMax)
+                , lanes
+                , laneRandoms
+                , nextLane
+                );
+        }
+
+        static const char* const Names[5] = {
+            "Collision::IsHitPoints"
+            , "Collision::IsHitSwept"
+            , "Collision::IsHitSwept (fixed)"
+            , "Vec2::ShortenBatch"
+            , "RandomLanes::fillU32"
+            };
+        bool isAllMatched = true;
+        for (int index = 0; index < 5; ++index) {
+            HPC_PRINT(
+                "%-30s %d cases, %d mismatches\n"
+                , Names[index]
+                , CaseCount
+                , mismatchCounts[index]
+                );
+            isAllMatched = isAllMatched && mismatchCounts[index] == 0;
+        }
+        return isAllMatched;
+    }
+}
+
+//------------------------------------------------------------------------------
+// EOF
@@ -0,0 +1,44 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    SimdCheck クラス
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+#pragma once
+
+namespace hpc {
+
+    //------------------------------------------------------------------------------
+    /// 複数の要素をまとめて計算する関数が、要素ごとのスカラー版の関数と一致するかを調べます。
+    ///
+    /// 調べる関数と、比べるスカラー版の関数は以下のとおりです。
+    ///
+    ///   関数                      | スカラー版
+    ///  ---------------------------|----------------------------------------------
+    ///   Collision::IsHitPoints    | Vec2::squareDist() と半径の二乗の比較
+    ///   Collision::IsHitSwept     | Collision::IsHit(const Circle&, const Circle&, const Vec2&)
+    ///   Vec2::ShortenBatch        | Vec2::length(), Vec2::normalize() による減速
+    ///   RandomLanes::fillU32      | レーンごとの Random::fillU32() の値を交互に並べたもの
+    ///
+    /// 決まったシードの乱数で入力を作るので、毎回同じ入力で調べます。
+    /// 要素数は SIMD 命令の幅で割り切れない数も含め、端数の処理も調べます。
+    /// 座標の一部は 1/4 刻みに丸め、判定の境界上にある入力も作ります。
+    /// 結果はビット単位で一致しなければなりません。
+    class SimdCheck
+    {
+    public:
+        static const int CaseCount = 20000;     ///< 関数ごとに調べる回数
+        static const int ElementCountMax = 19;  ///< 1回に渡す要素数の最大値
+
+        static bool Run();  ///< すべての関数を調べ、結果を表示します。
+
+    private:
+        SimdCheck();
+    };
+}
+//------------------------------------------------------------------------------
+// EOF
@@ -14,10 +14,18 @@
 #include <cstring>
 #include <cstdlib>
 #include "HPCCommon.hpp"
+#include "HPCLevelDesigner.hpp"
 #include "HPCMath.hpp"
+#include "HPCProfiler.hpp"
 #include "HPCTimer.hpp"
 
 namespace {
+    // new, delete を使うことは出来ないので static な変数として用意します。
+    hpc::RecordStage sReplayStage;  ///< リプレイファイルから読み込んだステージの記録
+    unsigned char sReplayArenaBuffer[hpc::TurnStream::ArenaSizeMax]; ///< sReplayStage のターンごとの記録を格納する領域
+    hpc::Arena sReplayArena(sReplayArenaBuffer, sizeof(sReplayArenaBuffer)); ///< sReplayArenaBuffer から確保する Arena
+    hpc::Stage sCrowdStage;         ///< runCrowd(), runLarge() で実行するステージ
+
     /// 入力を受けるコマンド
     enum Command {
         Command_Debug,          ///< デバッガ起動
@@ -56,6 +64,7 @@ namespace {
         DebugCommand_Next,          ///< 次へ
         DebugCommand_Prev,          ///< 前へ
         DebugCommand_Jump,          ///< 指定番号のステージにジャンプ
+        DebugCommand_ShowTurn,      ///< 指定番号のターンの結果を表示
         DebugCommand_Show,          ///< 再度
         DebugCommand_Help,          ///< ヘルプを表示
         DebugCommand_Exit,          ///< 終わる
@@ -126,6 +135,7 @@ namespace {
             case 'p': return DebugCommandSet(DebugCommand_Prev, arg1, arg2);
             case 'd': return DebugCommandSet(DebugCommand_Show, arg1, arg2);
             case 'j': return DebugCommandSet(DebugCommand_Jump, arg1, arg2);
+            case 't': return DebugCommandSet(DebugCommand_ShowTurn, arg1, arg2);
             case 'h': return DebugCommandSet(DebugCommand_Help, arg1, arg2);
             case 'e': return DebugCommandSet(DebugCommand_Exit, arg1, arg2);
             default:
@@ -143,9 +153,34 @@ namespace {
         HPC_PRINT(" p           : Go to the prev stage.\n");
         HPC_PRINT(" j [stage=0] : Go to the designated stage.\n");
         HPC_PRINT(" d           : Show the result of this stage.\n");
+        HPC_PRINT(" t [turn=0]  : Show the result of the designated turn.\n");
         HPC_PRINT(" h           : Show Help.\n");
         HPC_PRINT(" e           : Exit debugger.\n");
     }
+
+    //------------------------------------------------------------------------------
+    /// 1ターン分の結果を表示します。
+    ///
+    /// @param[in] aTurn        ターン番号。
+    /// @param[in] aResult      表示する結果。
+    /// @param[in] aCharaCount  キャラ数。
+    void ShowTurn(int aTurn, const hpc::TurnResult& aResult, int aCharaCount)
+    {
+        static const char StateMarks[hpc::StageState_TERM] = { ' ', 'C', 'F', 'L' };
+        HPC_ENUM_ASSERT(hpc::StageState, aResult.state);
+        HPC_PRINT_LOG("Turn", "#%04d: %c\n", aTurn, StateMarks[aResult.state]);
+        for (int charaIndex = 0; charaIndex < aCharaCount; ++charaIndex) {
+            const hpc::TurnResult::Chara& chara = aResult.charas[charaIndex];
+            HPC_PRINT(
+                " chara[%d] - [%7.2f,%7.2f] accel=%d lotus=%d\n"
+                , charaIndex
+                , chara.pos.x
+                , chara.pos.y
+                , chara.accelCount
+                , chara.passedLotusCount
+                );
+        }
+    }
 }
 
 namespace hpc {
@@ -156,7 +191,24 @@ namespace hpc {
         : mRandSet()
         , mGame(mRandSet)
         , mTimer(Parameter::GameTimeLimitSec)
+        , mRunWallSec(0.0)
+        , mRunCpuSec(0.0)
+        , mIsSweptCollision(false)
+        , mReplayFile()
+    {
+    }
+
+    //------------------------------------------------------------------------------
+    /// @brief キャラ同士の衝突を、移動中も含めて連続的に判定するかどうかを設定します。
+    ///
+    /// 以後に実行するすべてのステージに適用します。
+    ///
+    /// @param[in] aIsSwept 連続判定するなら @c true 。
+    void Simulation::setSweptCollision(bool aIsSwept)
     {
+        mIsSweptCollision = aIsSwept;
+        mGame.setSweptCollision(aIsSwept);
+        sCrowdStage.charas().setSweptCollision(aIsSwept);
     }
 
     //------------------------------------------------------------------------------
@@ -172,6 +224,168 @@ namespace hpc {
             }
             mGame.onStageDone();
         }
+        mRunWallSec = mTimer.pastWallSec();
+        mRunCpuSec = mTimer.pastSec();
+    }
+
+    //------------------------------------------------------------------------------
+    /// @brief ステージを並列に実行してゲームを実行します。
+    ///
+    /// ワーカーが 2 つ以上の場合、制限時間は、すべてのワーカーで共通の実時間で判定します。
+    /// CPU 時間には、このプロセスとすべてのワーカーの合計を記録します。
+    ///
+    /// @param[in] aWorkerCount ワーカー数。
+    void Simulation::runParallel(int aWorkerCount)
+    {
+        const double childCpuBeginSec = Timer::ChildProcessCpuSec();
+        mTimer.setClock(aWorkerCount > 1 ? TimerClock_Wall : TimerClock_Cpu);
+        mTimer.start();
+        mGame.runParallel(aWorkerCount, mTimer);
+        mRunWallSec = mTimer.pastWallSec();
+        mRunCpuSec = mTimer.pastSec() + (Timer::ChildProcessCpuSec() - childCpuBeginSec);
+    }
+
+    //------------------------------------------------------------------------------
+    /// @brief 複数のシードで、指定した範囲のステージを実行します。
+    ///
+    /// このクラスのゲームは実行せず、結果は aWriter と aStats にのみ書き出します。
+    /// 制限時間は、 BatchRunner がシードごとに判定します。
+    /// CPU 時間には、このプロセスとすべてのワーカーの合計を記録します。
+    ///
+    /// @param[in] aWorkerCount ワーカー数。1 以下の場合は呼び出し元のプロセスで実行します。
+    /// @param[in] aSeeds       実行するシードの一覧。
+    /// @param[in] aFirstStage  実行する最初のステージ番号。
+    /// @param[in] aLastStage   実行する最後のステージ番号。
+    /// @param[out] aWriter     実行結果の書き出し先。
+    /// @param[out] aStats      実行結果の集計。
+    void Simulation::runBatch(
+        int aWorkerCount
+        , const SeedList& aSeeds
+        , int aFirstStage
+        , int aLastStage
+        , BatchResultWriter& aWriter
+        , BatchStats& aStats
+        )
+    {
+        const double childCpuBeginSec = Timer::ChildProcessCpuSec();
+        mTimer.start();
+        BatchRunner::Run(aWorkerCount, aSeeds, aFirstStage, aLastStage, mIsSweptCollision, aWriter, aStats);
+        mRunWallSec = mTimer.pastWallSec();
+        mRunCpuSec = mTimer.pastSec() + (Timer::ChildProcessCpuSec() - childCpuBeginSec);
+    }
+
+    //------------------------------------------------------------------------------
+    /// @brief 人数を増やしたステージを、指定した範囲で実行します。
+    ///
+    /// 衝突判定などの負荷を測るため、各ステージに LevelDesigner::AddCrowd() で CPU キャラを追加します。
+    /// ゲームのルールの範囲外になるので記録はせず、
+    /// ステージごとのキャラ数・ターン数・ゴールしたキャラ数・順位が変わった延べ回数・実行時間を
+    /// CSV で標準出力に出力します。
+    /// 制限時間は判定しません。
+    ///
+    /// @param[in] aCharaCount  キャラ数(プレイヤー含む)。
+    /// @param[in] aFirstStage  実行する最初のステージ番号。
+    /// @param[in] aLastStage   実行する最後のステージ番号。
+    void Simulation::runCrowd(int aCharaCount, int aFirstStage, int aLastStage)
+    {
+        HPC_RANGE_ASSERT_MIN_MAX_I(aCharaCount, Parameter::CharaCountMin, Parameter::CharaCapacity);
+        HPC_RANGE_ASSERT_MIN_UB_I(aFirstStage, 0, Parameter::GameStageCount);
+        HPC_RANGE_ASSERT_MIN_UB_I(aLastStage, aFirstStage, Parameter::GameStageCount);
+        
+        mTimer.start();
+        HPC_PRINT("stage,charas,turns,goals,rank_changes,ms\n");
+        for (int stageIndex = aFirstStage; stageIndex <= aLastStage; ++stageIndex) {
+            LevelDesigner::Setup(stageIndex, sCrowdStage, mRandSet.system());
+            LevelDesigner::AddCrowd(stageIndex, aCharaCount, sCrowdStage, mRandSet.system());
+            
+            const double beginSec = Timer::MonotonicSec();
+            sCrowdStage.start();
+            int turnCount = 0;
+            int rankChangeCount = 0;
+            while (sCrowdStage.lastTurnResult().state == StageState_Playing) {
+                sCrowdStage.runTurn(mRandSet.game());
+                ++turnCount;
+                rankChangeCount += sCrowdStage.charas().rankEventCount();
+            }
+            const double sec = Timer::MonotonicSec() - beginSec;
+            
+            HPC_PRINT(
+                "%d,%d,%d,%d,%d,%.3f\n"
+                , stageIndex
+                , sCrowdStage.charas().count()
+                , turnCount
+                , sCrowdStage.charas().goalCount()
+                , rankChangeCount
+                , sec * 1000.0
+                );
+        }
+        mRunWallSec = mTimer.pastWallSec();
+        mRunCpuSec = mTimer.pastSec();
+    }
+
+    //------------------------------------------------------------------------------
+    /// @brief 大きなステージを生成し、指定した範囲の数だけ実行します。
+    ///
+    /// 先読みなどの処理がフィールドの広さや蓮の数に対してどう増えるかを測るため、
+    /// ステージごとに LevelDesigner::SetupLarge() で生成し直します。
+    /// ゲームのルールの範囲外になるので記録はせず、
+    /// ステージごとの蓮の数・ターン数・ゴールしたキャラ数・生成時間・実行時間を
+    /// CSV で標準出力に出力します。
+    /// 制限時間は判定しません。
+    ///
+    /// @param[in] aGridSize    フィールドのグリッド数。
+    /// @param[in] aLotusCount  蓮の個数。
+    /// @param[in] aFlowVel     フィールドの流れる速度。
+    /// @param[in] aFirstStage  実行する最初のステージ番号。
+    /// @param[in] aLastStage   実行する最後のステージ番号。
+    void Simulation::runLarge(const IntVec2& aGridSize, int aLotusCount, const Vec2& aFlowVel, int aFirstStage, int aLastStage)
+    {
+        HPC_RANGE_ASSERT_MIN_UB_I(aFirstStage, 0, Parameter::GameStageCount);
+        HPC_RANGE_ASSERT_MIN_UB_I(aLastStage, aFirstStage, Parameter::GameStageCount);
+        
+        mTimer.start();
+        HPC_PRINT("stage,grid_w,grid_h,lotuses,charas,turns,goals,setup_ms,ms\n");
+        for (int stageIndex = aFirstStage; stageIndex <= aLastStage; ++stageIndex) {
+            const double setupBeginSec = Timer::MonotonicSec();
+            LevelDesigner::SetupLarge(aGridSize, aLotusCount, aFlowVel, sCrowdStage, mRandSet.system());
+            const double setupSec = Timer::MonotonicSec() - setupBeginSec;
+            
+            const double beginSec = Timer::MonotonicSec();
+            sCrowdStage.start();
+            int turnCount = 0;
+            while (sCrowdStage.lastTurnResult().state == StageState_Playing) {
+                sCrowdStage.runTurn(mRandSet.game());
+                ++turnCount;
+            }
+            const double sec = Timer::MonotonicSec() - beginSec;
+            
+            HPC_PRINT(
+                "%d,%d,%d,%d,%d,%d,%d,%.3f,%.3f\n"
+                , stageIndex
+                , aGridSize.x
+                , aGridSize.y
+                , sCrowdStage.lotuses().count()
+                , sCrowdStage.charas().count()
+                , turnCount
+                , sCrowdStage.charas().goalCount()
+                , setupSec * 1000.0
+                , sec * 1000.0
+                );
+        }
+        mRunWallSec = mTimer.pastWallSec();
+        mRunCpuSec = mTimer.pastSec();
+    }
+
+    //------------------------------------------------------------------------------
+    /// 処理時間の集計を表示します。
+    ///
+    /// 集計は Profiler::SetEnabled(true) としてから実行した場合のみ行われます。
+    /// 表は標準エラー出力に出力するので、先に標準出力の内容を出力しておきます。
+    /// 実時間と CPU 時間は、実行を終えた時点のものです。
+    void Simulation::outputProfile()const
+    {
+        std::fflush(stdout);
+        Profiler::Print(mRunWallSec, mRunCpuSec);
     }
 
     //------------------------------------------------------------------------------
@@ -214,6 +428,47 @@ namespace hpc {
         mGame.record().dumpJson(isCompressed);
     }
 
+    //------------------------------------------------------------------------------
+    /// リプレイファイルを出力します。
+    ///
+    /// @param[in] aFileName 出力するファイル名。
+    ///
+    /// @return 出力に成功したら @c true を返します。
+    bool Simulation::outputReplay(const char* aFileName)const
+    {
+        return mGame.record().writeReplay(aFileName);
+    }
+
+    //------------------------------------------------------------------------------
+    /// ゲームを実行する代わりに、リプレイファイルから結果を読み込みます。
+    ///
+    /// @param[in] aFileName 読み込むファイル名。
+    ///
+    /// @return 読み込みに成功したら @c true を返します。
+    bool Simulation::loadReplay(const char* aFileName)
+    {
+        return mGame.readReplay(aFileName);
+    }
+
+    //------------------------------------------------------------------------------
+    /// ゲームを実行せずに、リプレイファイルの記録をデバッガで参照します。
+    ///
+    /// ファイル全体は読み込まず、表示するステージ・ターンの記録だけを読み込みます。
+    ///
+    /// @param[in] aFileName 読み込むファイル名。
+    ///
+    /// @return ファイルを開けたら @c true を返します。
+    bool Simulation::debugReplay(const char* aFileName)
+    {
+        if (!mReplayFile.open(aFileName)) {
+            return false;
+        }
+        sReplayStage.setArena(sReplayArena);
+        runDebugger();
+        mReplayFile.close();
+        return true;
+    }
+
     //------------------------------------------------------------------------------
     /// デバッグ実行を行います。
     void Simulation::runDebugger()
@@ -233,7 +488,42 @@ namespace hpc {
                     break;
 
                 case DebugCommand_Show:
-                    mGame.record().dumpStage(stage);
+                    if (!mReplayFile.isOpen()) {
+                        mGame.record().dumpStage(stage);
+                        break;
+                    }
+                    // 表示するステージだけを読み込むので、前に読み込んだ記録の領域は不要になる。
+                    sReplayArena.reset();
+                    if (mReplayFile.readStage(stage, sReplayStage)) {
+                        HPC_PRINT_LOG("Stage", "%d\n", stage);
+                        sReplayStage.dump();
+                    }
+                    else {
+                        HPC_PRINT("Failed to read the stage %d from the replay file.\n", stage);
+                    }
+                    break;
+
+                case DebugCommand_ShowTurn:
+                    {
+                        TurnResult result;
+                        bool isFound = false;
+                        int charaCount = 0;
+                        if (mReplayFile.isOpen()) {
+                            isFound = mReplayFile.readTurn(stage, commandSet.arg1, result);
+                            charaCount = mReplayFile.charaCount(stage);
+                        }
+                        else {
+                            const RecordStage& record = mGame.record().stage(stage);
+                            isFound = record.readTurn(commandSet.arg1, result);
+                            charaCount = record.charaCount();
+                        }
+                        if (isFound) {
+                            ShowTurn(commandSet.arg1, result, Math::LimitMinMax(charaCount, 0, Parameter::CharaCountMax));
+                        }
+                        else {
+                            HPC_PRINT("Turn %d is not recorded.\n", commandSet.arg1);
+                        }
+                    }
                     break;
 
                 case DebugCommand_Jump:
@@ -10,9 +10,14 @@
 //------------------------------------------------------------------------------
 #pragma once
 
+#include "HPCBatchRunner.hpp"
+#include "HPCBatchStats.hpp"
 #include "HPCGame.hpp"
+#include "HPCIntVec2.hpp"
 #include "HPCRandomSet.hpp"
+#include "HPCReplay.hpp"
 #include "HPCTimer.hpp"
+#include "HPCVec2.hpp"
 
 namespace hpc {
 
@@ -22,16 +27,39 @@ namespace hpc {
     {
     public:
         Simulation();
+        void setSweptCollision(bool aIsSwept);         ///< キャラ同士の衝突を連続判定するかどうかを設定する
 
         void run();                                    ///< 開始する
+        void runParallel(int aWorkerCount);            ///< ステージを並列に実行して開始する
+        /// 複数のシードで実行し、ステージごとの結果を書き出す
+        void runBatch(
+            int aWorkerCount
+            , const SeedList& aSeeds
+            , int aFirstStage
+            , int aLastStage
+            , BatchResultWriter& aWriter
+            , BatchStats& aStats
+            );
+        /// 人数を増やしたステージを、記録せずに実行する
+        void runCrowd(int aCharaCount, int aFirstStage, int aLastStage);
+        /// 大きなステージを生成し、記録せずに実行する
+        void runLarge(const IntVec2& aGridSize, int aLotusCount, const Vec2& aFlowVel, int aFirstStage, int aLastStage);
         void debug();                                  ///< デバッグする
         void outputResult()const;                     ///< 結果を表示する。
         void outputJson(bool isCompressed)const;      ///< JSON の出力を行う。
+        bool outputReplay(const char* aFileName)const; ///< リプレイファイルの出力を行う。
+        bool loadReplay(const char* aFileName);        ///< 実行せずにリプレイファイルから結果を読み込む。
+        bool debugReplay(const char* aFileName);       ///< 実行せずにリプレイファイルをデバッグする。
+        void outputProfile()const;                    ///< 処理時間の集計を表示する。
         
     private:
         RandomSet mRandSet; ///< 乱数生成クラス
         Game mGame;         ///< シミュレーションするゲーム
         Timer mTimer;       ///< ゲームタイマー
+        double mRunWallSec; ///< 実行にかかった実時間
+        double mRunCpuSec;  ///< 実行にかかった CPU 時間。ワーカーの分も含みます。
+        bool mIsSweptCollision; ///< キャラ同士の衝突を連続判定するかどうか
+        ReplayFile mReplayFile; ///< デバッグするリプレイファイル。開いていなければ mGame の記録をデバッグする。
 
         void runDebugger();
     };
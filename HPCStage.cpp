@@ -14,6 +14,8 @@
 #include "HPCCommon.hpp"
 #include "HPCLevelDesigner.hpp"
 #include "HPCParameter.hpp"
+#include "HPCProfiler.hpp"
+#include "HPCRandom.hpp"
 
 namespace hpc {
 
@@ -77,16 +79,28 @@ namespace hpc {
         mTurnResult.reset();
         
         // 各キャラの動作を確定する
-        mCharas.procDecideAction(aRandom);
+        {
+            ProfileSample sample(ProfileScope_DecideAction);
+            mCharas.procDecideAction(aRandom);
+        }
         
         // 動作が確定したら、動作を実行する
-        mCharas.procExecAction();
+        {
+            ProfileSample sample(ProfileScope_ExecAction);
+            mCharas.procExecAction(*this);
+        }
         
         // 動作が実行されたら、キャラ同士の衝突判定を行う
-        mCharas.procCheckColl();
+        {
+            ProfileSample sample(ProfileScope_CheckColl);
+            mCharas.procCheckColl(*this);
+        }
         
         // 衝突判定が終わったら、最終処理を行う
-        mCharas.procEnd(*this);
+        {
+            ProfileSample sample(ProfileScope_End);
+            mCharas.procEnd(*this);
+        }
         
         // 結果の保存
         updateTurnResult();
@@ -112,6 +126,41 @@ namespace hpc {
         }
     }
 
+    //------------------------------------------------------------------------------
+    /// 現在の状態を保存します。
+    ///
+    /// 保存した状態から runTurn() を同じ回数呼ぶと、
+    /// 回答者の Answer が同じ動作を返す限り、同じ結果が得られます。
+    ///
+    /// @param[out] aSnapshot   状態の保存先。
+    /// @param[in]  aRandom     runTurn() に渡す乱数。
+    void Stage::saveSnapshot(StageSnapshot& aSnapshot, const Random& aRandom)const
+    {
+        mCharas.saveStates(aSnapshot.physics, aSnapshot.charas);
+        aSnapshot.charaCount = mCharas.count();
+        aSnapshot.turnIndex = mTurnIndex;
+        aSnapshot.state = mTurnResult.state;
+        aRandom.getState(aSnapshot.randomSeedX, aSnapshot.randomSeedY);
+    }
+
+    //------------------------------------------------------------------------------
+    /// saveSnapshot() で保存した状態に戻します。
+    ///
+    /// 保存したときと同じステージで、ターンの合間に呼んでください。
+    /// lastTurnResult() も保存した時点の値に戻ります。
+    ///
+    /// @param[in]  aSnapshot   saveSnapshot() で保存した状態。
+    /// @param[out] aRandom     保存した時点の状態に戻す乱数。
+    void Stage::restoreSnapshot(const StageSnapshot& aSnapshot, Random& aRandom)
+    {
+        HPC_ASSERT(aSnapshot.charaCount == mCharas.count());
+        mCharas.restoreStates(aSnapshot.physics, aSnapshot.charas);
+        mTurnIndex = aSnapshot.turnIndex;
+        updateTurnResult();
+        mTurnResult.state = aSnapshot.state;
+        aRandom.setState(aSnapshot.randomSeedX, aSnapshot.randomSeedY);
+    }
+
     //------------------------------------------------------------------------------
     CharaCollection& Stage::charas()
     {
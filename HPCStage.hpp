@@ -14,9 +14,32 @@
 #include "HPCField.hpp"
 #include "HPCLotusCollection.hpp"
 #include "HPCTurnResult.hpp"
+#include "HPCTypes.hpp"
 
 namespace hpc {
 
+    class Random;
+
+    //------------------------------------------------------------------------------
+    /// Stage のターンごとに変わる状態と、乱数の状態をまとめた POD です。
+    ///
+    /// Stage::saveSnapshot() で取得し、 Stage::restoreSnapshot() で戻します。
+    /// 固定長なので、 static な変数や配列に置いておけば new, delete を使わずに何度でも保存できます。
+    /// 位置と速度は CharaPhysics をまるごとコピーして保存します。
+    /// 蓮とフィールドはステージ中に変わらないため含みません。
+    ///
+    /// @note 回答者の Answer が内部に持つ状態は含みません。
+    struct StageSnapshot
+    {
+        CharaPhysics physics;                           ///< 全キャラの位置と速度
+        CharaState charas[Parameter::CharaCapacity];    ///< キャラの状態
+        int charaCount;                                 ///< キャラ数
+        int turnIndex;                                  ///< 現在のターン番号
+        StageState state;                               ///< 最後のターン実行後の状態
+        uint randomSeedX;                               ///< 乱数の状態
+        uint randomSeedY;                               ///< 乱数の状態
+    };
+
     //------------------------------------------------------------------------------
     /// ゲームの1ステージを表します。
     class Stage 
@@ -33,6 +56,12 @@ namespace hpc {
         const TurnResult& lastTurnResult()const;        ///< 最後のターン実行後の結果を返します。
         //@}
 
+        /// @name 状態の保存と復元
+        //@{
+        void saveSnapshot(StageSnapshot& aSnapshot, const Random& aRandom)const;   ///< 現在の状態を保存します。
+        void restoreSnapshot(const StageSnapshot& aSnapshot, Random& aRandom);      ///< 保存した状態に戻します。
+        //@}
+
         /// @name 各要素へのアクセス
         //@{
         const CharaCollection& charas()const;       ///< キャラ情報を返します。
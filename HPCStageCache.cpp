@@ -0,0 +1,484 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    HPCStageCache.hpp の実装
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+
+#include "HPCStageCache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include "HPCCharaParam.hpp"
+#include "HPCCommon.hpp"
+#include "HPCLevelDesigner.hpp"
+#include "HPCReplay.hpp"
+
+namespace {
+    using namespace hpc;
+
+    //------------------------------------------------------------------------------
+    /// 1つのステージの生成結果です。
+    struct StageCacheEntry
+    {
+        uint beginSeedX;                                ///< 生成前の乱数の状態
+        uint beginSeedY;                                ///< 生成前の乱数の状態
+        uint endSeedX;                                  ///< 生成後の乱数の状態
+        uint endSeedY;                                  ///< 生成後の乱数の状態
+        Rectangle fieldRect;                            ///< フィールドの矩形
+        Vec2 flowVel;                                   ///< フィールドの流れる速度
+        int lotusCount;                                 ///< 蓮の数
+        Vec2 lotusPos[Parameter::LotusCountMax];        ///< 蓮の位置
+        float lotusRadius[Parameter::LotusCountMax];    ///< 蓮の半径
+        int charaCount;                                 ///< キャラの数
+        Vec2 charaPos[Parameter::CharaCountMax];        ///< キャラの初期位置
+        CharaParam charaParam[Parameter::CharaCountMax]; ///< キャラのパラメータ
+    };
+
+    /// 1つのステージの生成結果の、ファイル上のバイト数の最大値
+    const int EntrySizeMax = 4 * (4 + 6 + 1 + 3 * Parameter::LotusCountMax + 1 + 4 * Parameter::CharaCountMax);
+    /// ファイルのバイト数の最大値
+    const int FileSizeMax = StageCache::HeaderSize + EntrySizeMax * Parameter::GameStageCount;
+    /// 読み込んだ生成結果を確かめるために、生成し直すステージの番号
+    ///
+    /// LevelDesigner はステージ番号の範囲ごとに生成方法を切り替えるので、
+    /// どの範囲の生成方法が変わっても気付けるよう、範囲ごとに1つずつ選んでいます。
+    ///
+    /// 番号 | グリッドサイズ | 流れ       | 蓮の数  | 蓮の大きさ
+    /// ---- | -------------- | ---------- | ------- | ----------
+    ///  0   | 0 ～ 9         | 無し       | 0 ～ 47 | 0 ～ 4
+    ///  7   | 0 ～ 9         | 0 ～ 19    | 0 ～ 47 | 5 ～ 9
+    /// 15   | 10 ～ 19       | 0 ～ 19    | 0 ～ 47 | 10 ～ 24
+    /// 25   | 20 ～ 29       | 20 ～ 39   | 0 ～ 47 | 25 ～ 49
+    /// 41   | 30 ～          | 40 ～ 59   | 0 ～ 47 | 25 ～ 49
+    /// 48   | 30 ～          | 無し       | 48 ～   | 25 ～ 49
+    /// 63   | 30 ～          | 60 ～ 79   | 48 ～   | 50 ～
+    /// 99   | 30 ～          | 80 ～ 99   | 48 ～   | 50 ～
+    const int SampleStageNumbers[] = { 0, 7, 15, 25, 41, 48, 63, Parameter::GameStageCount - 1 };
+
+    // new, delete を使うことは出来ないので static な変数として用意します。
+    const char* sDirectory = 0;                                 ///< 保存先のディレクトリ
+    bool sIsPrepared = false;                                   ///< 生成結果を保持しているか
+    uint sKeySeedX = 0;                                         ///< 保持している生成結果のキー
+    uint sKeySeedY = 0;                                         ///< 保持している生成結果のキー
+    StageCacheEntry sEntries[Parameter::GameStageCount];        ///< ステージごとの生成結果
+    unsigned char sFileData[FileSizeMax + 1];                   ///< ファイルの内容
+    Stage sScratchStage;                                        ///< 生成に使う作業用のステージ
+
+    //------------------------------------------------------------------------------
+    /// バイト列の FNV-1a ハッシュ値を求めます。
+    uint Checksum(const unsigned char* aData, int aSize)
+    {
+        uint hash = 2166136261u;
+        for (int index = 0; index < aSize; ++index) {
+            hash = (hash ^ aData[index]) * 16777619u;
+        }
+        return hash;
+    }
+
+    //------------------------------------------------------------------------------
+    /// キーに対応するファイル名を作ります。
+    ///
+    /// @param[out] aPath 作成したファイル名。 StageCache::PathLengthMax 文字分の領域が必要です。
+    /// @param[in] aSuffix ファイル名の末尾に加える文字列。
+    ///
+    /// @return ファイル名が長すぎる場合は @c false を返します。
+    bool MakePath(char* aPath, const char* aSuffix)
+    {
+        // ディレクトリ名以外の部分は、 "/" + 16 文字 + ".hpcs" + aSuffix
+        if (std::strlen(sDirectory) + std::strlen(aSuffix) + 31 > StageCache::PathLengthMax) {
+            return false;
+        }
+        std::sprintf(aPath, "%s/%08x%08x.hpcs%s", sDirectory, sKeySeedX, sKeySeedY, aSuffix);
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 生成済みのステージから生成結果を取り出します。
+    void Capture(const Stage& aStage, StageCacheEntry& aEntry)
+    {
+        aEntry.fieldRect = aStage.field().rect();
+        aEntry.flowVel = aStage.field().flowVel();
+        aEntry.lotusCount = aStage.lotuses().count();
+        HPC_RANGE_ASSERT_MIN_MAX_I(aEntry.lotusCount, 1, Parameter::LotusCountMax);
+        for (int index = 0; index < aEntry.lotusCount; ++index) {
+            aEntry.lotusPos[index] = aStage.lotuses()[index].pos();
+            aEntry.lotusRadius[index] = aStage.lotuses()[index].radius();
+        }
+        aEntry.charaCount = aStage.charas().count();
+        HPC_RANGE_ASSERT_MIN_MAX_I(aEntry.charaCount, 1, Parameter::CharaCountMax);
+        for (int index = 0; index < aEntry.charaCount; ++index) {
+            aEntry.charaPos[index] = aStage.charas()[index].pos();
+            aEntry.charaParam[index] = aStage.charas()[index].charaParam();
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// 1つのステージを生成し、生成結果を aEntry に格納します。
+    ///
+    /// @param[in]      aNumber ステージ番号
+    /// @param[in,out]  aRandom system 乱数。生成後の状態になります。
+    /// @param[out]     aEntry  生成結果
+    void GenerateEntry(int aNumber, Random& aRandom, StageCacheEntry& aEntry)
+    {
+        aRandom.getState(aEntry.beginSeedX, aEntry.beginSeedY);
+        LevelDesigner::Setup(aNumber, sScratchStage, aRandom);
+        aRandom.getState(aEntry.endSeedX, aEntry.endSeedY);
+        Capture(sScratchStage, aEntry);
+    }
+
+    //------------------------------------------------------------------------------
+    /// 全ステージを生成し、生成結果を sEntries に格納します。
+    void Generate(const Random& aSystemRandom)
+    {
+        Random random = aSystemRandom;
+        for (int index = 0; index < Parameter::GameStageCount; ++index) {
+            GenerateEntry(index, random, sEntries[index]);
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// 1つのステージの生成結果を書き込みます。
+    void WriteEntry(ReplayWriter& aWriter, const StageCacheEntry& aEntry)
+    {
+        aWriter.writeInt(static_cast<int>(aEntry.beginSeedX));
+        aWriter.writeInt(static_cast<int>(aEntry.beginSeedY));
+        aWriter.writeInt(static_cast<int>(aEntry.endSeedX));
+        aWriter.writeInt(static_cast<int>(aEntry.endSeedY));
+        aWriter.writeFloat(aEntry.fieldRect.left);
+        aWriter.writeFloat(aEntry.fieldRect.right);
+        aWriter.writeFloat(aEntry.fieldRect.bottom);
+        aWriter.writeFloat(aEntry.fieldRect.top);
+        aWriter.writeFloat(aEntry.flowVel.x);
+        aWriter.writeFloat(aEntry.flowVel.y);
+        aWriter.writeInt(aEntry.lotusCount);
+        for (int index = 0; index < aEntry.lotusCount; ++index) {
+            aWriter.writeFloat(aEntry.lotusPos[index].x);
+            aWriter.writeFloat(aEntry.lotusPos[index].y);
+            aWriter.writeFloat(aEntry.lotusRadius[index]);
+        }
+        aWriter.writeInt(aEntry.charaCount);
+        for (int index = 0; index < aEntry.charaCount; ++index) {
+            aWriter.writeFloat(aEntry.charaPos[index].x);
+            aWriter.writeFloat(aEntry.charaPos[index].y);
+            aWriter.writeInt(aEntry.charaParam[index].type());
+            aWriter.writeInt(aEntry.charaParam[index].strength());
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// 1つのステージの生成結果を読み込みます。
+    ///
+    /// @return 読み込んだ値が有効な範囲であれば @c true を返します。
+    bool ReadEntry(ReplayReader& aReader, StageCacheEntry& aEntry)
+    {
+        aEntry.beginSeedX = static_cast<uint>(aReader.readInt());
+        aEntry.beginSeedY = static_cast<uint>(aReader.readInt());
+        aEntry.endSeedX = static_cast<uint>(aReader.readInt());
+        aEntry.endSeedY = static_cast<uint>(aReader.readInt());
+        aEntry.fieldRect.left = aReader.readFloat();
+        aEntry.fieldRect.right = aReader.readFloat();
+        aEntry.fieldRect.bottom = aReader.readFloat();
+        aEntry.fieldRect.top = aReader.readFloat();
+        aEntry.flowVel.x = aReader.readFloat();
+        aEntry.flowVel.y = aReader.readFloat();
+        aEntry.lotusCount = aReader.readInt();
+        if (aEntry.lotusCount < 1 || Parameter::LotusCountMax < aEntry.lotusCount) {
+            return false;
+        }
+        for (int index = 0; index < aEntry.lotusCount; ++index) {
+            aEntry.lotusPos[index].x = aReader.readFloat();
+            aEntry.lotusPos[index].y = aReader.readFloat();
+            aEntry.lotusRadius[index] = aReader.readFloat();
+        }
+        aEntry.charaCount = aReader.readInt();
+        if (aEntry.charaCount < 1 || Parameter::CharaCountMax < aEntry.charaCount) {
+            return false;
+        }
+        for (int index = 0; index < aEntry.charaCount; ++index) {
+            aEntry.charaPos[index].x = aReader.readFloat();
+            aEntry.charaPos[index].y = aReader.readFloat();
+            const int type = aReader.readInt();
+            const int strength = aReader.readInt();
+            if (type == CharaType_Human) {
+                aEntry.charaParam[index] = CharaParam::CreateHuman();
+            }
+            else if (type == CharaType_Cpu) {
+                aEntry.charaParam[index] = CharaParam::CreateCpu(strength);
+            }
+            else {
+                return false;
+            }
+        }
+        return aReader.isValid();
+    }
+
+    //------------------------------------------------------------------------------
+    /// 2つの生成結果が、ファイルに書き込む内容として一致するかを返します。
+    bool IsSameEntry(const StageCacheEntry& aLhs, const StageCacheEntry& aRhs)
+    {
+        unsigned char lhsData[EntrySizeMax];
+        unsigned char rhsData[EntrySizeMax];
+        ReplayWriter writer;
+        writer.open(lhsData, EntrySizeMax);
+        WriteEntry(writer, aLhs);
+        const int lhsSize = writer.position();
+        writer.close();
+        writer.open(rhsData, EntrySizeMax);
+        WriteEntry(writer, aRhs);
+        const int rhsSize = writer.position();
+        writer.close();
+        return lhsSize == rhsSize && std::memcmp(lhsData, rhsData, lhsSize) == 0;
+    }
+
+    //------------------------------------------------------------------------------
+    /// sEntries のうち、 SampleStageNumbers のステージを生成し直して、生成結果が一致するかを調べます。
+    ///
+    /// LevelDesigner や LevelGrid の変更で生成結果が変わった場合に、
+    /// 変更前に保存したファイルを使わないためのものです。
+    /// 全ステージを生成し直すと保存した意味がなくなるので、
+    /// LevelDesigner の生成方法の範囲ごとに1つずつのステージだけを調べます。
+    ///
+    /// @return すべて一致すれば @c true を返します。
+    bool IsSampleMatched()
+    {
+        const int sampleCount = sizeof(SampleStageNumbers) / sizeof(SampleStageNumbers[0]);
+        for (int index = 0; index < sampleCount; ++index) {
+            const int number = SampleStageNumbers[index];
+            const StageCacheEntry& saved = sEntries[number];
+            Random random(saved.beginSeedX, saved.beginSeedY);
+            StageCacheEntry generated;
+            GenerateEntry(number, random, generated);
+            if (!IsSameEntry(saved, generated)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    /// キーに対応するファイルを読み込み、生成結果を sEntries に格納します。
+    ///
+    /// @return ファイルがあり、内容が有効であれば @c true を返します。
+    bool Load()
+    {
+        char path[StageCache::PathLengthMax];
+        if (!MakePath(path, "")) {
+            return false;
+        }
+        std::FILE* file = std::fopen(path, "rb");
+        if (file == 0) {
+            return false;
+        }
+        const int size = static_cast<int>(std::fread(sFileData, 1, sizeof(sFileData), file));
+        std::fclose(file);
+        if (size < StageCache::HeaderSize || FileSizeMax < size) {
+            return false;
+        }
+
+        ReplayReader reader(sFileData, size);
+        char magic[sizeof(StageCache::Magic)];
+        reader.readBytes(magic, sizeof(magic));
+        const int version = reader.readInt();
+        const uint keySeedX = static_cast<uint>(reader.readInt());
+        const uint keySeedY = static_cast<uint>(reader.readInt());
+        const int stageCount = reader.readInt();
+        const int payloadSize = reader.readInt();
+        const uint checksum = static_cast<uint>(reader.readInt());
+        if (
+            std::memcmp(magic, StageCache::Magic, sizeof(magic)) != 0
+            || version != StageCache::Version
+            || keySeedX != sKeySeedX
+            || keySeedY != sKeySeedY
+            || stageCount != Parameter::GameStageCount
+            || payloadSize != size - StageCache::HeaderSize
+            || checksum != Checksum(sFileData + StageCache::HeaderSize, payloadSize)
+        ) {
+            return false;
+        }
+        for (int index = 0; index < Parameter::GameStageCount; ++index) {
+            if (!ReadEntry(reader, sEntries[index])) {
+                return false;
+            }
+        }
+        return reader.position() == size && IsSampleMatched();
+    }
+
+    //------------------------------------------------------------------------------
+    /// sEntries の生成結果を、キーに対応するファイルに保存します。
+    ///
+    /// 別のプロセスが読み込み中のファイルを壊さないよう、一時ファイルに書き込んでから置き換えます。
+    /// 保存に失敗しても、生成結果はそのまま使えるので何もしません。
+    void Save()
+    {
+        ReplayWriter writer;
+        writer.open(sFileData + StageCache::HeaderSize, FileSizeMax - StageCache::HeaderSize);
+        for (int index = 0; index < Parameter::GameStageCount; ++index) {
+            WriteEntry(writer, sEntries[index]);
+        }
+        const int payloadSize = writer.position();
+        if (!writer.close()) {
+            return;
+        }
+
+        char path[StageCache::PathLengthMax];
+        char tempPath[StageCache::PathLengthMax];
+        if (!MakePath(path, "") || !MakePath(tempPath, ".tmp")) {
+            return;
+        }
+        if (!writer.open(tempPath)) {
+            return;
+        }
+        writer.writeBytes(StageCache::Magic, sizeof(StageCache::Magic));
+        writer.writeInt(StageCache::Version);
+        writer.writeInt(static_cast<int>(sKeySeedX));
+        writer.writeInt(static_cast<int>(sKeySeedY));
+        writer.writeInt(Parameter::GameStageCount);
+        writer.writeInt(payloadSize);
+        writer.writeInt(static_cast<int>(Checksum(sFileData + StageCache::HeaderSize, payloadSize)));
+        writer.writeBytes(sFileData + StageCache::HeaderSize, payloadSize);
+        if (!writer.close()) {
+            std::remove(tempPath);
+            return;
+        }
+#ifdef _WIN32
+        // Windows では置き換え先があると rename() できないため、先に削除する。
+        // その間に読み込んだプロセスは、ファイルがないものとして生成し直す。
+        std::remove(path);
+#endif
+        if (std::rename(tempPath, path) != 0) {
+            std::remove(tempPath);
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// 乱数が、保持している生成結果の生成前の状態と一致すれば、その生成結果を返します。
+    ///
+    /// @return 使える生成結果がなければ 0 を返します。
+    const StageCacheEntry* FindEntry(int aNumber, const Random& aRandom)
+    {
+        HPC_RANGE_ASSERT_MIN_UB_I(aNumber, 0, Parameter::GameStageCount);
+        if (!sIsPrepared) {
+            return 0;
+        }
+        const StageCacheEntry& entry = sEntries[aNumber];
+        uint seedX = 0;
+        uint seedY = 0;
+        aRandom.getState(seedX, seedY);
+        if (seedX != entry.beginSeedX || seedY != entry.beginSeedY) {
+            return 0;
+        }
+        return &entry;
+    }
+}
+
+namespace hpc {
+
+    const char StageCache::Magic[4] = { 'H', 'P', 'C', 'S' };
+
+    //------------------------------------------------------------------------------
+    /// 保存先のディレクトリを設定します。
+    ///
+    /// ディレクトリは作成しないので、あらかじめ用意してください。
+    ///
+    /// @param[in] aDirectory 保存先のディレクトリ。 0 の場合は無効にします。
+    ///                       文字列はコピーしないので、使い終わるまで保持してください。
+    void StageCache::SetDirectory(const char* aDirectory)
+    {
+        sDirectory = aDirectory;
+        sIsPrepared = false;
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return SetDirectory() で保存先が設定されていれば @c true を返します。
+    bool StageCache::IsEnabled()
+    {
+        return sDirectory != 0;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 1 つめのステージの生成前の乱数の状態をキーとして、全ステージの生成結果を用意します。
+    ///
+    /// キーに対応するファイルがあれば読み込み、なければ全ステージを生成して保存します。
+    /// 保存先が設定されていなければ何もしません。
+    ///
+    /// @param[in] aSystemRandom 1 つめのステージの生成前の system 乱数。状態は変わりません。
+    void StageCache::Prepare(const Random& aSystemRandom)
+    {
+        if (!IsEnabled()) {
+            return;
+        }
+        uint seedX = 0;
+        uint seedY = 0;
+        aSystemRandom.getState(seedX, seedY);
+        if (sIsPrepared && seedX == sKeySeedX && seedY == sKeySeedY) {
+            return;
+        }
+
+        // 生成中に Restore() が保持中の生成結果を使わないよう、先に無効にする。
+        sIsPrepared = false;
+        sKeySeedX = seedX;
+        sKeySeedY = seedY;
+        if (!Load()) {
+            Generate(aSystemRandom);
+            Save();
+        }
+        sIsPrepared = true;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 保存した生成結果をステージに設定し、乱数を生成後の状態にします。
+    ///
+    /// 結果は LevelDesigner::Setup() で生成した場合と同じになります。
+    ///
+    /// @param[in]      aNumber ステージ番号
+    /// @param[out]     aStage  ステージ情報
+    /// @param[in,out]  aRandom system 乱数
+    ///
+    /// @return 使える生成結果がなければ何もせずに @c false を返します。
+    bool StageCache::Restore(int aNumber, Stage& aStage, Random& aRandom)
+    {
+        const StageCacheEntry* entry = FindEntry(aNumber, aRandom);
+        if (entry == 0) {
+            return false;
+        }
+        aStage.reset();
+        aStage.field().setup(entry->fieldRect, entry->flowVel);
+        aStage.lotuses().reset();
+        for (int index = 0; index < entry->lotusCount; ++index) {
+            aStage.lotuses().setupAddLotus(entry->lotusPos[index], entry->lotusRadius[index]);
+        }
+        aStage.lotuses().setupEnd();
+        for (int index = 0; index < entry->charaCount; ++index) {
+            aStage.charas().setupAddChara(entry->charaPos[index], entry->charaParam[index]);
+        }
+        aRandom.setState(entry->endSeedX, entry->endSeedY);
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    /// ステージを生成せずに、乱数を LevelDesigner::Setup() で生成した後の状態にします。
+    ///
+    /// 途中のステージだけを実行する場合に、それより前のステージの生成を省略するために使います。
+    ///
+    /// @param[in]      aNumber ステージ番号
+    /// @param[in,out]  aRandom system 乱数
+    ///
+    /// @return 使える生成結果がなければ何もせずに @c false を返します。
+    bool StageCache::Advance(int aNumber, Random& aRandom)
+    {
+        const StageCacheEntry* entry = FindEntry(aNumber, aRandom);
+        if (entry == 0) {
+            return false;
+        }
+        aRandom.setState(entry->endSeedX, entry->endSeedY);
+        return true;
+    }
+}
+
+//------------------------------------------------------------------------------
+// EOF
@@ -0,0 +1,68 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    StageCache クラス
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "HPCParameter.hpp"
+#include "HPCRandom.hpp"
+#include "HPCStage.hpp"
+
+namespace hpc {
+
+    //------------------------------------------------------------------------------
+    /// LevelDesigner::Setup() で生成したステージを、ファイルに保存して再利用します。
+    ///
+    /// ステージの生成は、ステージ番号と生成前の system 乱数の状態だけで決まります。
+    /// system 乱数はステージの生成にしか使わないため、 1 つめのステージの生成前の状態が同じなら、
+    /// すべてのステージの生成結果も同じになります。
+    /// そこで、その状態をキーとして、全ステージ分の生成結果と生成後の乱数の状態を1つのファイルに保存します。
+    /// 読み込んだファイルは、最初と最後のステージを生成し直して、保存した生成結果と一致するかを確かめます。
+    /// LevelDesigner や LevelGrid を変更して生成結果が変わった場合、変更前に保存したファイルは使われません。
+    ///
+    /// SetDirectory() で保存先を指定した場合のみ有効です。
+    /// Prepare() でファイルを読み込み、なければ全ステージを生成して保存します。
+    /// 以後、 Restore() は保存した生成結果をステージに設定するだけで済み、
+    /// Advance() は生成をまったく行わずに乱数を生成後の状態に進めます。
+    /// いずれも、渡された乱数が保存した生成前の状態と一致する場合のみ使い、
+    /// 一致しなければ @c false を返すので、呼び出し元で通常どおり生成してください。
+    ///
+    /// ファイルの形式は、値をすべて 4 バイトのリトルエンディアンで格納した以下の並びです。
+    ///
+    ///   項目                  | 内容
+    ///  -----------------------|----------------------------------------------
+    ///   ファイルヘッダ        | マジック "HPCS", バージョン, キー (乱数の状態 x, y), ステージ数, 本体のバイト数, 本体のチェックサム
+    ///   ステージ × ステージ数 | 生成前後の乱数の状態, フィールドの矩形と流れ, 蓮の数と位置・半径, キャラの数と位置・種類・強さ
+    ///
+    /// ファイル名は、キーを16進数で表したものです。
+    /// 読み込んだファイルの内容が不正な場合は、生成し直して上書きします。
+    ///
+    /// @note new, delete を使うことは出来ないので、1つのキーの分の生成結果を static な変数として保持します。
+    class StageCache
+    {
+    public:
+        static const int Version = 3;           ///< 形式のバージョン
+        static const char Magic[4];             ///< ファイル先頭のマジック
+        static const int HeaderSize = 28;       ///< ファイルヘッダのバイト数
+        static const int PathLengthMax = 512;   ///< ファイル名の文字数の最大値
+
+        static void SetDirectory(const char* aDirectory);   ///< 保存先のディレクトリを設定します。
+        static bool IsEnabled();                            ///< 保存先が設定されているかを返します。
+        static void Prepare(const Random& aSystemRandom);   ///< 生成結果を読み込むか、生成して保存します。
+        /// 保存した生成結果をステージに設定します。
+        static bool Restore(int aNumber, Stage& aStage, Random& aRandom);
+        /// 生成を行わずに、乱数を生成後の状態に進めます。
+        static bool Advance(int aNumber, Random& aRandom);
+
+    private:
+        StageCache();
+    };
+}
+//------------------------------------------------------------------------------
+// EOF
@@ -11,6 +11,17 @@
 
 #include "HPCTimer.hpp"
 
+#include "HPCCommon.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+// windows.h が定義するマクロが、下の GetCurrentTime 関数と衝突するため解除します。
+#undef GetCurrentTime
+#else
+#include <sys/resource.h>
+#include <time.h>
+#endif
+
 namespace {
 
     //------------------------------------------------------------------------------
@@ -45,8 +56,22 @@ namespace hpc {
     /// @param[in] aLimitSec 制限時間を秒で指定。
     Timer::Timer(int aLimitSec)
         : mLimitSec(aLimitSec)
+        , mClock(TimerClock_Cpu)
         , mTimeBegin(std::clock_t())
+        , mWallBegin(0.0)
+    {
+    }
+
+    //------------------------------------------------------------------------------
+    /// isInTime(), pastSecForPrint() で使う時間の種類を設定します。
+    ///
+    /// 生成した時点では TimerClock_Cpu です。
+    ///
+    /// @param[in] aClock 制限時間の判定に使う時間の種類。
+    void Timer::setClock(TimerClock aClock)
     {
+        HPC_ENUM_ASSERT(TimerClock, aClock);
+        mClock = aClock;
     }
 
     //------------------------------------------------------------------------------
@@ -54,12 +79,26 @@ namespace hpc {
     void Timer::start()
     {
         mTimeBegin = GetCurrentTime();
+        mWallBegin = MonotonicSec();
+    }
+
+    //------------------------------------------------------------------------------
+    /// 実時間の開始時刻を指定して、タイマーの計測を開始します。
+    ///
+    /// 別のプロセスで開始したタイマーと同じ締め切りを、 TimerClock_Wall で判定する場合に使います。
+    /// CPU 時間は、この関数を呼び出した時点から計測します。
+    ///
+    /// @param[in] aWallBeginSec 開始時の MonotonicSec() の値。
+    void Timer::startAt(double aWallBeginSec)
+    {
+        mTimeBegin = GetCurrentTime();
+        mWallBegin = aWallBeginSec;
     }
 
     //------------------------------------------------------------------------------
-    /// start 関数を呼び出した時点からの経過時間を取得します。
+    /// start 関数を呼び出した時点からの、このプロセスの CPU 時間を取得します。
     ///
-    /// @return start を呼び出してからの経過時間を秒に変換したもの。
+    /// @return start を呼び出してからの CPU 時間を秒に変換したもの。
     double Timer::pastSec()const
     {
         return ToSec(GetCurrentTime() - mTimeBegin);
@@ -68,24 +107,88 @@ namespace hpc {
     //------------------------------------------------------------------------------
     /// 表示用に修正された時間を表示します。
     ///
-    /// pastSec と異なり、制限時間を超過した場合は制限時間を返します。
+    /// 制限時間の判定と同じ種類の時間を返しますが、制限時間を超過した場合は制限時間を返します。
     ///
     /// @return start を呼び出してからの時間を秒に修正し、表示用に調整したもの。
     double Timer::pastSecForPrint()const
     {
-        if (!isInTime()) {
+        const double sec = judgedSec();
+        if (sec >= mLimitSec) {
             return mLimitSec;
         } else {
-            return pastSec();
+            return sec;
         }
     }
 
     //------------------------------------------------------------------------------
-    /// @return 制限時間以内の場合 @c false を返し、
-    ///         超過した場合は @c true を返します。
+    /// start 関数を呼び出した時点からの実時間を取得します。
+    ///
+    /// pastSec と異なり、 CPU 時間ではなく経過した実時間を返します。
+    ///
+    /// @return start を呼び出してからの実時間を秒に変換したもの。
+    double Timer::pastWallSec()const
+    {
+        return MonotonicSec() - mWallBegin;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 単調増加する高分解能の時刻を取得します。
+    ///
+    /// システムの時刻の変更による影響を受けません。
+    /// 基準となる時刻は不定なので、2つの値の差で時間を計測します。
+    ///
+    /// @return 時刻を秒に変換したもの。
+    double Timer::MonotonicSec()
+    {
+#ifdef _WIN32
+        LARGE_INTEGER frequency;
+        LARGE_INTEGER counter;
+        QueryPerformanceFrequency(&frequency);
+        QueryPerformanceCounter(&counter);
+        return static_cast<double>(counter.QuadPart) / static_cast<double>(frequency.QuadPart);
+#else
+        timespec time;
+        clock_gettime(CLOCK_MONOTONIC, &time);
+        return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_nsec) * 1.0e-9;
+#endif
+    }
+
+    //------------------------------------------------------------------------------
+    /// 終了を待った子プロセスの CPU 時間 (ユーザー時間とシステム時間) の合計を取得します。
+    ///
+    /// 実行中の子プロセスの分は含まれません。
+    /// プロセスを生成しない Windows では、常に 0 を返します。
+    ///
+    /// @return CPU 時間を秒に変換したもの。
+    double Timer::ChildProcessCpuSec()
+    {
+#ifdef _WIN32
+        return 0.0;
+#else
+        rusage usage;
+        if (getrusage(RUSAGE_CHILDREN, &usage) != 0) {
+            return 0.0;
+        }
+        return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)
+            + static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1.0e-6;
+#endif
+    }
+
+    //------------------------------------------------------------------------------
+    /// start 関数を呼び出した時点からの、 setClock() で設定した種類の時間で判定します。
+    ///
+    /// @return 制限時間以内の場合 @c true を返し、
+    ///         超過した場合は @c false を返します。
     bool Timer::isInTime()const
     {
-        return pastSec() < mLimitSec;
+        return judgedSec() < mLimitSec;
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return TimerClock_Wall の場合は pastWallSec() 、それ以外は pastSec() の値。
+    double Timer::judgedSec()const
+    {
+        return mClock == TimerClock_Wall ? pastWallSec() : pastSec();
     }
 }
 //------------------------------------------------------------------------------
@@ -14,22 +14,49 @@
 
 namespace hpc {
 
+    //------------------------------------------------------------------------------
+    /// 制限時間の判定に使う時間の種類を表します。
+    enum TimerClock
+    {
+        TimerClock_Cpu,     ///< このプロセスの CPU 時間 (std::clock)
+        TimerClock_Wall,    ///< 実時間 (Timer::MonotonicSec() の差)
+
+        TimerClock_TERM
+    };
+
     //------------------------------------------------------------------------------
     /// 実時間計測を行うタイマーを提供します。
+    ///
+    /// 制限時間は、通常は start() からのこのプロセスの CPU 時間 (std::clock) で判定します。
+    /// ステージを複数のワーカープロセスで実行する場合は、 setClock() で TimerClock_Wall を指定し、
+    /// start() からの実時間 (単調増加する高分解能の時刻 MonotonicSec() の差) で判定します。
+    /// MonotonicSec() はシステム全体で共通の時刻なので、 start() の後に生成したワーカープロセスでも、
+    /// コピーされたタイマーで同じ締め切りを判定できます。
+    /// 判定に使う時間によらず、 CPU 時間は pastSec() で、実時間は pastWallSec() で取得できます。
+    /// ワーカープロセスの CPU 時間は pastSec() に含まれないので、 ChildProcessCpuSec() の差を加えてください。
     class Timer
     {
     public:
         Timer(int aLimitSec);               ///< 制限時間を定めてインスタンスを生成します。
 
+        void setClock(TimerClock aClock);   ///< 制限時間の判定に使う時間の種類を設定します。
         void start();                       ///< タイマーを開始します。
+        void startAt(double aWallBeginSec); ///< 実時間の開始時刻を指定してタイマーを開始します。
         bool isInTime()const;              ///< 制限時間内かどうかを返します。
+        double pastSec()const;             ///< 経過した CPU 時間を取得します。
         double pastSecForPrint()const;     ///< 表示用の経過時間を取得します。
+        double pastWallSec()const;         ///< 開始してからの実時間を取得します。
+
+        static double MonotonicSec();       ///< 単調増加する高分解能の時刻を秒で取得します。
+        static double ChildProcessCpuSec(); ///< 終了を待った子プロセスの CPU 時間の合計を取得します。
 
     private:
-        double pastSec()const;             ///< 経過時間を取得します。
+        double judgedSec()const;           ///< 制限時間の判定に使う経過時間を取得します。
 
         const int mLimitSec;                ///< 制限時間
+        TimerClock mClock;                  ///< 制限時間の判定に使う時間の種類
         std::clock_t mTimeBegin;            ///< 開始時刻
+        double mWallBegin;                  ///< 開始時の MonotonicSec() の値
     };
 }
 //------------------------------------------------------------------------------
@@ -0,0 +1,437 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    HPCTurnCodec.hpp の実装
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+
+#include "HPCTurnCodec.hpp"
+
+#include <cmath>
+#include "HPCCommon.hpp"
+
+namespace {
+    using namespace hpc;
+
+    /// ブロックの形式
+    enum BlockFormat {
+        BlockFormat_Encoded,    ///< 圧縮した形式
+        BlockFormat_Raw,        ///< 圧縮しない形式
+
+        BlockFormat_TERM
+    };
+
+    //------------------------------------------------------------------------------
+    /// 決まった大きさの領域にバイト列を書き込みます。
+    /// 領域が足りなくなった場合は、それ以降の書き込みを無視します。
+    class ByteWriter
+    {
+    public:
+        ByteWriter(unsigned char* aData, int aCapacity)
+            : mData(aData)
+            , mCapacity(aCapacity)
+            , mSize(0)
+            , mIsValid(true)
+        {
+        }
+
+        /// @return 書き込んだバイト数。
+        int size()const { return mSize; }
+        /// @return 領域に収まっていれば @c true を返します。
+        bool isValid()const { return mIsValid; }
+
+        /// 1 バイトを書き込みます。
+        void writeByte(int aValue)
+        {
+            if (mSize >= mCapacity) {
+                mIsValid = false;
+                return;
+            }
+            mData[mSize] = static_cast<unsigned char>(aValue);
+            ++mSize;
+        }
+
+        /// 4 バイトのリトルエンディアンで書き込みます。
+        void writeFixed(int aValue)
+        {
+            const unsigned int value = static_cast<unsigned int>(aValue);
+            writeByte(value);
+            writeByte(value >> 8);
+            writeByte(value >> 16);
+            writeByte(value >> 24);
+        }
+
+        /// 符号なしの値を可変長で書き込みます。
+        void writeVarint(unsigned int aValue)
+        {
+            while (aValue >= 0x80) {
+                writeByte((aValue & 0x7f) | 0x80);
+                aValue >>= 7;
+            }
+            writeByte(aValue);
+        }
+
+        /// 符号付きの値を、ジグザグ符号化して可変長で書き込みます。
+        void writeSigned(int aValue)
+        {
+            const unsigned int value = static_cast<unsigned int>(aValue) << 1;
+            writeVarint(aValue < 0 ? ~value : value);
+        }
+
+    private:
+        unsigned char* mData;
+        int mCapacity;
+        int mSize;
+        bool mIsValid;
+    };
+
+    //------------------------------------------------------------------------------
+    /// バイト列を読み込みます。
+    /// 範囲外を読み込もうとした後は、値としてゼロを返し続けます。
+    class ByteReader
+    {
+    public:
+        ByteReader(const unsigned char* aData, int aSize)
+            : mData(aData)
+            , mSize(aSize)
+            , mPos(0)
+            , mIsValid(true)
+        {
+        }
+
+        /// @return ここまでの読み込みが範囲内であれば @c true を返します。
+        bool isValid()const { return mIsValid; }
+        /// @return すべて読み込んでいれば @c true を返します。
+        bool isEnd()const { return mPos == mSize; }
+
+        /// @return 1 バイトの値。
+        int readByte()
+        {
+            if (!mIsValid || mPos >= mSize) {
+                mIsValid = false;
+                return 0;
+            }
+            return mData[mPos++];
+        }
+
+        /// @return 4 バイトのリトルエンディアンで格納された値。
+        int readFixed()
+        {
+            unsigned int value = static_cast<unsigned int>(readByte());
+            value |= static_cast<unsigned int>(readByte()) << 8;
+            value |= static_cast<unsigned int>(readByte()) << 16;
+            value |= static_cast<unsigned int>(readByte()) << 24;
+            return static_cast<int>(value);
+        }
+
+        /// @return 可変長で格納された符号なしの値。
+        unsigned int readVarint()
+        {
+            unsigned int value = 0;
+            for (int shift = 0; shift < 35; shift += 7) {
+                const int byte = readByte();
+                value |= static_cast<unsigned int>(byte & 0x7f) << shift;
+                if ((byte & 0x80) == 0) {
+                    return value;
+                }
+            }
+            mIsValid = false;
+            return 0;
+        }
+
+        /// @return ジグザグ符号化して可変長で格納された符号付きの値。
+        int readSigned()
+        {
+            const unsigned int value = readVarint();
+            return static_cast<int>((value & 1) ? ~(value >> 1) : (value >> 1));
+        }
+
+        /// @return 連続するターン数。 1 以上 aRestCount 以下でなければ読み込み失敗とします。
+        int readRunLength(int aRestCount)
+        {
+            const unsigned int value = readVarint();
+            if (value < 1 || static_cast<unsigned int>(aRestCount) < value) {
+                mIsValid = false;
+                return aRestCount;
+            }
+            return static_cast<int>(value);
+        }
+
+    private:
+        const unsigned char* mData;
+        int mSize;
+        int mPos;
+        bool mIsValid;
+    };
+
+    //------------------------------------------------------------------------------
+    /// 直前の2ターンの位置から、次のターンの位置を予測します。
+    ///
+    /// 壊れたデータを展開してもオーバーフローしないよう、符号なしで計算します。
+    ///
+    /// @param[in] aPositions   量子化した位置の並び。
+    /// @param[in] aIndex       予測するターンのブロック内の番号。 1 以上です。
+    unsigned int PredictPosition(const int* aPositions, int aIndex)
+    {
+        const unsigned int last = static_cast<unsigned int>(aPositions[aIndex - 1]);
+        if (aIndex == 1) {
+            return last;
+        }
+        return 2 * last - static_cast<unsigned int>(aPositions[aIndex - 2]);
+    }
+
+    //------------------------------------------------------------------------------
+    /// 圧縮しない形式でブロックを書き込みます。
+    void WriteRawBlock(const TurnResult* aTurns, int aTurnCount, int aCharaCount, ByteWriter& aWriter)
+    {
+        aWriter.writeByte(BlockFormat_Raw);
+        for (int turn = 0; turn < aTurnCount; ++turn) {
+            for (int charaIndex = 0; charaIndex < aCharaCount; ++charaIndex) {
+                const TurnResult::Chara& chara = aTurns[turn].charas[charaIndex];
+                aWriter.writeFixed(TurnCodec::Quantize(chara.pos.x));
+                aWriter.writeFixed(TurnCodec::Quantize(chara.pos.y));
+                aWriter.writeFixed(chara.accelCount);
+                aWriter.writeFixed(chara.passedLotusCount);
+            }
+            aWriter.writeFixed(aTurns[turn].state);
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// 圧縮した形式でブロックを書き込みます。
+    void WriteEncodedBlock(const TurnResult* aTurns, int aTurnCount, int aCharaCount, ByteWriter& aWriter)
+    {
+        aWriter.writeByte(BlockFormat_Encoded);
+
+        // ステージの状態
+        for (int begin = 0; begin < aTurnCount; ) {
+            int end = begin + 1;
+            while (end < aTurnCount && aTurns[end].state == aTurns[begin].state) {
+                ++end;
+            }
+            aWriter.writeVarint(end - begin);
+            aWriter.writeVarint(aTurns[begin].state);
+            begin = end;
+        }
+
+        for (int charaIndex = 0; charaIndex < aCharaCount; ++charaIndex) {
+            // 加速回数と通過した蓮の数
+            for (int begin = 0; begin < aTurnCount; ) {
+                const TurnResult::Chara& chara = aTurns[begin].charas[charaIndex];
+                int end = begin + 1;
+                while (
+                    end < aTurnCount
+                    && aTurns[end].charas[charaIndex].accelCount == chara.accelCount
+                    && aTurns[end].charas[charaIndex].passedLotusCount == chara.passedLotusCount
+                    ) {
+                    ++end;
+                }
+                aWriter.writeVarint(end - begin);
+                aWriter.writeSigned(chara.accelCount);
+                aWriter.writeSigned(chara.passedLotusCount);
+                begin = end;
+            }
+
+            // 位置
+            int xs[TurnCodec::BlockTurnCount];
+            int ys[TurnCodec::BlockTurnCount];
+            for (int turn = 0; turn < aTurnCount; ++turn) {
+                xs[turn] = TurnCodec::Quantize(aTurns[turn].charas[charaIndex].pos.x);
+                ys[turn] = TurnCodec::Quantize(aTurns[turn].charas[charaIndex].pos.y);
+            }
+            aWriter.writeSigned(xs[0]);
+            aWriter.writeSigned(ys[0]);
+            for (int turn = 1; turn < aTurnCount; ++turn) {
+                aWriter.writeSigned(static_cast<int>(static_cast<unsigned int>(xs[turn]) - PredictPosition(xs, turn)));
+                aWriter.writeSigned(static_cast<int>(static_cast<unsigned int>(ys[turn]) - PredictPosition(ys, turn)));
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// 圧縮しない形式のブロックを読み込みます。
+    bool ReadRawBlock(ByteReader& aReader, int aTurnCount, int aCharaCount, TurnResult* aTurns)
+    {
+        for (int turn = 0; turn < aTurnCount; ++turn) {
+            for (int charaIndex = 0; charaIndex < aCharaCount; ++charaIndex) {
+                TurnResult::Chara& chara = aTurns[turn].charas[charaIndex];
+                chara.pos.x = TurnCodec::Dequantize(aReader.readFixed());
+                chara.pos.y = TurnCodec::Dequantize(aReader.readFixed());
+                chara.accelCount = aReader.readFixed();
+                chara.passedLotusCount = aReader.readFixed();
+            }
+            const int state = aReader.readFixed();
+            if (state < 0 || StageState_TERM <= state) {
+                return false;
+            }
+            aTurns[turn].state = static_cast<StageState>(state);
+        }
+        return aReader.isValid();
+    }
+
+    //------------------------------------------------------------------------------
+    /// 圧縮した形式のブロックを読み込みます。
+    bool ReadEncodedBlock(ByteReader& aReader, int aTurnCount, int aCharaCount, TurnResult* aTurns)
+    {
+        // ステージの状態
+        for (int begin = 0; begin < aTurnCount; ) {
+            const int end = begin + aReader.readRunLength(aTurnCount - begin);
+            const unsigned int state = aReader.readVarint();
+            if (StageState_TERM <= state) {
+                return false;
+            }
+            for (int turn = begin; turn < end; ++turn) {
+                aTurns[turn].state = static_cast<StageState>(state);
+            }
+            begin = end;
+        }
+
+        for (int charaIndex = 0; charaIndex < aCharaCount; ++charaIndex) {
+            // 加速回数と通過した蓮の数
+            for (int begin = 0; begin < aTurnCount; ) {
+                const int end = begin + aReader.readRunLength(aTurnCount - begin);
+                const int accelCount = aReader.readSigned();
+                const int passedLotusCount = aReader.readSigned();
+                for (int turn = begin; turn < end; ++turn) {
+                    aTurns[turn].charas[charaIndex].accelCount = accelCount;
+                    aTurns[turn].charas[charaIndex].passedLotusCount = passedLotusCount;
+                }
+                begin = end;
+            }
+
+            // 位置
+            int xs[TurnCodec::BlockTurnCount];
+            int ys[TurnCodec::BlockTurnCount];
+            xs[0] = aReader.readSigned();
+            ys[0] = aReader.readSigned();
+            for (int turn = 1; turn < aTurnCount; ++turn) {
+                xs[turn] = static_cast<int>(PredictPosition(xs, turn) + static_cast<unsigned int>(aReader.readSigned()));
+                ys[turn] = static_cast<int>(PredictPosition(ys, turn) + static_cast<unsigned int>(aReader.readSigned()));
+            }
+            for (int turn = 0; turn < aTurnCount; ++turn) {
+                aTurns[turn].charas[charaIndex].pos.x = TurnCodec::Dequantize(xs[turn]);
+                aTurns[turn].charas[charaIndex].pos.y = TurnCodec::Dequantize(ys[turn]);
+            }
+        }
+        return aReader.isValid();
+    }
+}
+
+namespace hpc {
+
+    //------------------------------------------------------------------------------
+    /// 位置を PositionScale 分の1 の単位に量子化します。
+    ///
+    /// ちょうど中間の値は偶数の側に丸めます。
+    /// 書式付き出力で小数点以下 3 桁に丸めた場合と同じ結果になります。
+    ///
+    /// @param[in] aValue 位置の値。
+    ///
+    /// @return 量子化した値。
+    int TurnCodec::Quantize(float aValue)
+    {
+        // float の仮数は 24 ビットなので、1000 倍しても double で誤差なく表せる。
+        const double value = static_cast<double>(aValue) * PositionScale;
+        HPC_ASSERT(-1.0e9 < value && value < 1.0e9);
+        double rounded = std::floor(value);
+        const double fraction = value - rounded;
+        if (fraction > 0.5 || (fraction == 0.5 && std::fmod(rounded, 2.0) != 0.0)) {
+            rounded += 1.0;
+        }
+        return static_cast<int>(rounded);
+    }
+
+    //------------------------------------------------------------------------------
+    /// 量子化した位置を元に戻します。
+    ///
+    /// @param[in] aValue 量子化した値。
+    ///
+    /// @return 位置の値。
+    float TurnCodec::Dequantize(int aValue)
+    {
+        return static_cast<float>(aValue / static_cast<double>(PositionScale));
+    }
+
+    //------------------------------------------------------------------------------
+    /// ブロックを圧縮します。
+    ///
+    /// @param[in] aTurns       ブロックに含めるターンの記録。
+    /// @param[in] aTurnCount   ブロックに含めるターン数。 1 以上 BlockTurnCount 以下です。
+    /// @param[in] aCharaCount  キャラ数。
+    /// @param[out] aData       書き込み先。 BlockSizeMax バイトの領域が必要です。
+    ///
+    /// @return 書き込んだバイト数。
+    int TurnCodec::EncodeBlock(
+        const TurnResult* aTurns
+        , int aTurnCount
+        , int aCharaCount
+        , unsigned char* aData
+        )
+    {
+        HPC_RANGE_ASSERT_MIN_UB_I(aTurnCount, 1, BlockTurnCount + 1);
+        HPC_RANGE_ASSERT_MIN_UB_I(aCharaCount, 0, Parameter::CharaCountMax + 1);
+
+        const int rawSize = 1 + aTurnCount * (16 * aCharaCount + 4);
+        {
+            ByteWriter writer(aData, rawSize - 1);
+            WriteEncodedBlock(aTurns, aTurnCount, aCharaCount, writer);
+            if (writer.isValid()) {
+                return writer.size();
+            }
+        }
+        ByteWriter writer(aData, BlockSizeMax);
+        WriteRawBlock(aTurns, aTurnCount, aCharaCount, writer);
+        HPC_ASSERT(writer.isValid());
+        return writer.size();
+    }
+
+    //------------------------------------------------------------------------------
+    /// ブロックを展開します。
+    ///
+    /// キャラ数以降のキャラの記録は、初期状態になります。
+    ///
+    /// @param[in] aData        圧縮したブロック。
+    /// @param[in] aSize        ブロックのバイト数。
+    /// @param[in] aTurnCount   ブロックに含まれるターン数。 1 以上 BlockTurnCount 以下です。
+    /// @param[in] aCharaCount  キャラ数。
+    /// @param[out] aTurns      展開先。 aTurnCount 個の要素が必要です。
+    ///
+    /// @return 正しく展開できた場合は @c true を返します。
+    bool TurnCodec::DecodeBlock(
+        const unsigned char* aData
+        , int aSize
+        , int aTurnCount
+        , int aCharaCount
+        , TurnResult* aTurns
+        )
+    {
+        HPC_RANGE_ASSERT_MIN_UB_I(aTurnCount, 1, BlockTurnCount + 1);
+        HPC_RANGE_ASSERT_MIN_UB_I(aCharaCount, 0, Parameter::CharaCountMax + 1);
+
+        for (int turn = 0; turn < aTurnCount; ++turn) {
+            aTurns[turn].reset();
+        }
+        ByteReader reader(aData, aSize);
+        bool isValid = false;
+        switch (reader.readByte()) {
+        case BlockFormat_Encoded:
+            isValid = ReadEncodedBlock(reader, aTurnCount, aCharaCount, aTurns);
+            break;
+
+        case BlockFormat_Raw:
+            isValid = ReadRawBlock(reader, aTurnCount, aCharaCount, aTurns);
+            break;
+
+        default:
+            break;
+        }
+        return isValid && reader.isEnd();
+    }
+}
+
+//------------------------------------------------------------------------------
+// EOF
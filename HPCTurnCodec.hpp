@@ -0,0 +1,75 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    TurnCodec クラス
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "HPCParameter.hpp"
+#include "HPCTurnResult.hpp"
+
+namespace hpc {
+
+    //------------------------------------------------------------------------------
+    /// ターンごとの記録を圧縮する機能を提供します。
+    ///
+    /// 記録は BlockTurnCount ターンずつのブロックに分けて圧縮します。
+    /// ブロックは他のブロックに依存しないので、任意のターンの記録は
+    /// そのターンを含むブロック1つを展開するだけで取得できます。
+    ///
+    /// ブロックの内容は次のとおりです。
+    /// 整数は、符号をジグザグ符号化した上で、7 ビットずつの可変長で格納します。
+    ///
+    ///   項目                  | 内容
+    ///  -----------------------|----------------------------------------------
+    ///   形式                  | 0 : 圧縮した形式, 1 : 圧縮しない形式 (1 バイト)
+    ///   ステージの状態        | (連続するターン数, 状態) の組の並び
+    ///   キャラ × キャラ数     | 加速回数と通過した蓮の数、位置
+    ///
+    /// 加速回数と通過した蓮の数は、(連続するターン数, 加速回数, 通過した蓮の数) の組の並びで格納します。
+    /// 位置は PositionScale 分の1 の単位に量子化し、ブロック先頭のターンは値そのものを、
+    /// 以降のターンは直前の速度から予測した位置との差分を格納します。
+    /// 圧縮した結果が大きくなる場合は、量子化した値をそのまま 4 バイトずつで格納します。
+    ///
+    /// @note 量子化の単位は JSON の出力と同じ精度です。
+    ///       ただし、 -0.0005 < x < 0 の値は 0 になるため、 JSON の出力は "-0.000" ではなく "0.000" になります。
+    class TurnCodec
+    {
+    public:
+        static const int BlockTurnCount = 64;   ///< 1ブロックのターン数
+        /// 1ステージのブロック数の最大値
+        static const int BlockCountMax = (Parameter::GameTurnPerStage + BlockTurnCount) / BlockTurnCount;
+        /// 1ブロックのバイト数の最大値
+        static const int BlockSizeMax = 1 + BlockTurnCount * (16 * Parameter::CharaCountMax + 4);
+        static const int PositionScale = 1000;  ///< 位置の量子化の単位の逆数
+
+        static int Quantize(float aValue);      ///< 位置を量子化します。
+        static float Dequantize(int aValue);    ///< 量子化した位置を元に戻します。
+
+        /// ブロックを圧縮します。
+        static int EncodeBlock(
+            const TurnResult* aTurns
+            , int aTurnCount
+            , int aCharaCount
+            , unsigned char* aData
+            );
+        /// ブロックを展開します。
+        static bool DecodeBlock(
+            const unsigned char* aData
+            , int aSize
+            , int aTurnCount
+            , int aCharaCount
+            , TurnResult* aTurns
+            );
+
+    private:
+        TurnCodec();
+    };
+}
+//------------------------------------------------------------------------------
+// EOF
@@ -29,7 +29,7 @@ namespace hpc {
     /// 値を既定の値で初期化します。
     void TurnResult::reset()
     {
-        for (int index = 0; index < Parameter::CharaCountMax; ++index) {
+        for (int index = 0; index < Parameter::CharaCapacity; ++index) {
             charas[index].pos.reset();
             charas[index].accelCount = 0;
             charas[index].passedLotusCount = 0;
@@ -45,7 +45,7 @@ namespace hpc {
     /// @param[in] aResult  上書きする TurnResult
     void TurnResult::set(const TurnResult& aResult)
     {
-        for (int index = 0; index < Parameter::CharaCountMax; ++index) {
+        for (int index = 0; index < Parameter::CharaCapacity; ++index) {
             charas[index] = aResult.charas[index];
         }
         state = aResult.state;
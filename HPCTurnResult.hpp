@@ -31,7 +31,7 @@ namespace hpc {
             Vec2 pos;
             int accelCount;
             int passedLotusCount;
-        } charas[Parameter::CharaCountMax];
+        } charas[Parameter::CharaCapacity];
         
         StageState state;   ///< 現在の状態
     };
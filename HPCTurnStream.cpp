@@ -0,0 +1,289 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    HPCTurnStream.hpp の実装
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+
+#include "HPCTurnStream.hpp"
+
+#include <cstring>
+#include "HPCCommon.hpp"
+#include "HPCMath.hpp"
+#include "HPCReplay.hpp"
+
+namespace {
+    // new, delete を使うことは出来ないので static な変数として用意します。
+    hpc::TurnResult sBlockTurns[hpc::TurnCodec::BlockTurnCount]; ///< 展開したブロック
+    unsigned char sBlockData[hpc::TurnCodec::BlockSizeMax];         ///< 圧縮したブロック
+}
+
+namespace hpc {
+
+    //------------------------------------------------------------------------------
+    /// クラスのインスタンスを生成します。
+    TurnStream::TurnStream()
+        : mArena(0)
+        , mBlocks()
+        , mBlockSizes()
+        , mDataSize(0)
+        , mEncodedBlockCount(0)
+        , mPendingTurns()
+        , mPendingCount(0)
+        , mTurnCount(0)
+        , mCharaCount(0)
+    {
+    }
+
+    //------------------------------------------------------------------------------
+    /// 圧縮したブロックを格納する Arena を設定します。
+    ///
+    /// @param[in] aArena 使用する Arena 。インスタンスより長く存在する必要があります。
+    void TurnStream::setArena(Arena& aArena)
+    {
+        mArena = &aArena;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 別の TurnStream の記録を複製します。
+    /// 圧縮したブロックは、このインスタンスの Arena に複製します。
+    ///
+    /// @param[in] aStream 複製元。
+    void TurnStream::set(const TurnStream& aStream)
+    {
+        if (this == &aStream) {
+            return;
+        }
+        reset(aStream.mCharaCount);
+        for (int index = 0; index < aStream.mEncodedBlockCount; ++index) {
+            addBlock(aStream.mBlocks[index], aStream.mBlockSizes[index]);
+        }
+        for (int index = 0; index < aStream.mPendingCount; ++index) {
+            mPendingTurns[index].set(aStream.mPendingTurns[index]);
+        }
+        mPendingCount = aStream.mPendingCount;
+        mTurnCount = aStream.mTurnCount;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 記録を消去します。
+    ///
+    /// @param[in] aCharaCount これから記録するキャラ数。
+    void TurnStream::reset(int aCharaCount)
+    {
+        HPC_RANGE_ASSERT_MIN_UB_I(aCharaCount, 0, Parameter::CharaCountMax + 1);
+        mDataSize = 0;
+        mEncodedBlockCount = 0;
+        mPendingCount = 0;
+        mTurnCount = 0;
+        mCharaCount = aCharaCount;
+    }
+
+    //------------------------------------------------------------------------------
+    /// ターンの記録を追加します。
+    ///
+    /// 位置は量子化した値として保持するので、取得した値は追加した値と一致しない場合があります。
+    ///
+    /// @param[in] aResult ターンの記録。
+    void TurnStream::append(const TurnResult& aResult)
+    {
+        HPC_RANGE_ASSERT_MIN_UB_I(mTurnCount, 0, Parameter::GameTurnPerStage + 1);
+        TurnResult& turn = mPendingTurns[mPendingCount];
+        turn.reset();
+        for (int charaIndex = 0; charaIndex < mCharaCount; ++charaIndex) {
+            TurnResult::Chara& chara = turn.charas[charaIndex];
+            chara = aResult.charas[charaIndex];
+            chara.pos.x = TurnCodec::Dequantize(TurnCodec::Quantize(chara.pos.x));
+            chara.pos.y = TurnCodec::Dequantize(TurnCodec::Quantize(chara.pos.y));
+        }
+        turn.state = aResult.state;
+        ++mPendingCount;
+        ++mTurnCount;
+        if (mPendingCount == TurnCodec::BlockTurnCount) {
+            encodePendingTurns();
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// 圧縮前の記録が残っていれば、ブロックとして圧縮します。
+    void TurnStream::finish()
+    {
+        if (mPendingCount > 0) {
+            encodePendingTurns();
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return 初期状態を含む、記録したターン数。
+    int TurnStream::count()const
+    {
+        return mTurnCount;
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return 圧縮前の記録を含む、ブロック数。
+    int TurnStream::blockCount()const
+    {
+        return (mTurnCount + TurnCodec::BlockTurnCount - 1) / TurnCodec::BlockTurnCount;
+    }
+
+    //------------------------------------------------------------------------------
+    /// ブロックを展開します。
+    ///
+    /// @param[in] aBlockIndex  ブロック番号。
+    /// @param[out] aTurns      展開先。 TurnCodec::BlockTurnCount 個の要素が必要です。
+    ///
+    /// @return ブロックに含まれるターン数。
+    int TurnStream::readBlock(int aBlockIndex, TurnResult* aTurns)const
+    {
+        HPC_RANGE_ASSERT_MIN_UB_I(aBlockIndex, 0, blockCount());
+        if (aBlockIndex == mEncodedBlockCount) {
+            for (int index = 0; index < mPendingCount; ++index) {
+                aTurns[index].set(mPendingTurns[index]);
+            }
+            return mPendingCount;
+        }
+        const int turnCount = Math::Min(TurnCodec::BlockTurnCount, mTurnCount - aBlockIndex * TurnCodec::BlockTurnCount);
+        const bool isValid = TurnCodec::DecodeBlock(
+            mBlocks[aBlockIndex]
+            , mBlockSizes[aBlockIndex]
+            , turnCount
+            , mCharaCount
+            , aTurns
+            );
+        HPC_ASSERT(isValid);
+        (void)isValid;
+        return turnCount;
+    }
+
+    //------------------------------------------------------------------------------
+    /// ターン1つ分の記録を取得します。
+    /// 記録を含むブロック1つを展開します。
+    ///
+    /// @param[in] aTurn        ターン番号。 0 は初期状態です。
+    /// @param[out] aResult     取得先。
+    ///
+    /// @return 記録が存在すれば @c true を返します。
+    bool TurnStream::readTurn(int aTurn, TurnResult& aResult)const
+    {
+        if (aTurn < 0 || mTurnCount <= aTurn) {
+            return false;
+        }
+        readBlock(aTurn / TurnCodec::BlockTurnCount, sBlockTurns);
+        aResult.set(sBlockTurns[aTurn % TurnCodec::BlockTurnCount]);
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    /// @return リプレイファイルに書き込むバイト数。
+    ///
+    /// @pre finish() を呼び、すべての記録を圧縮している必要があります。
+    int TurnStream::replaySize()const
+    {
+        HPC_ASSERT(mPendingCount == 0);
+        return 4 * (mEncodedBlockCount + 1) + mDataSize;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 圧縮した記録をリプレイファイルに書き込みます。
+    ///
+    /// ブロックごとの開始位置 (ブロック数 + 1 個) に続けて、ブロックを書き込みます。
+    /// 最後の開始位置は、ブロックの合計のバイト数です。
+    ///
+    /// @param[in] aWriter 書き込み先。
+    ///
+    /// @pre finish() を呼び、すべての記録を圧縮している必要があります。
+    void TurnStream::writeReplay(ReplayWriter& aWriter)const
+    {
+        HPC_ASSERT(mPendingCount == 0);
+        int offset = 0;
+        aWriter.writeInt(offset);
+        for (int index = 0; index < mEncodedBlockCount; ++index) {
+            offset += mBlockSizes[index];
+            aWriter.writeInt(offset);
+        }
+        for (int index = 0; index < mEncodedBlockCount; ++index) {
+            aWriter.writeBytes(mBlocks[index], mBlockSizes[index]);
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    /// 圧縮した記録をリプレイファイルから読み込みます。
+    /// 読み込んだブロックは、すべて展開できることを確認します。
+    ///
+    /// @param[in] aReader      読み込み元。
+    /// @param[in] aCharaCount  キャラ数。
+    /// @param[in] aTurnCount   記録したターン数。
+    ///
+    /// @return 正しく読み込めた場合は @c true を返します。
+    bool TurnStream::readReplay(ReplayReader& aReader, int aCharaCount, int aTurnCount)
+    {
+        HPC_RANGE_ASSERT_MIN_UB_I(aTurnCount, 0, Parameter::GameTurnPerStage + 2);
+        reset(aCharaCount);
+        const int blockCount = (aTurnCount + TurnCodec::BlockTurnCount - 1) / TurnCodec::BlockTurnCount;
+        int blockSizes[TurnCodec::BlockCountMax];
+        int lastOffset = aReader.readInt();
+        if (lastOffset != 0) {
+            return false;
+        }
+        for (int index = 0; index < blockCount; ++index) {
+            const int offset = aReader.readInt();
+            blockSizes[index] = offset - lastOffset;
+            if (blockSizes[index] < 1 || TurnCodec::BlockSizeMax < blockSizes[index]) {
+                return false;
+            }
+            lastOffset = offset;
+        }
+        for (int index = 0; index < blockCount; ++index) {
+            aReader.readBytes(sBlockData, blockSizes[index]);
+            const bool isValid = aReader.isValid() && TurnCodec::DecodeBlock(
+                sBlockData
+                , blockSizes[index]
+                , Math::Min(TurnCodec::BlockTurnCount, aTurnCount - index * TurnCodec::BlockTurnCount)
+                , mCharaCount
+                , sBlockTurns
+                );
+            if (!isValid) {
+                reset(aCharaCount);
+                return false;
+            }
+            addBlock(sBlockData, blockSizes[index]);
+        }
+        mTurnCount = aTurnCount;
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 圧縮前の記録をブロックとして圧縮します。
+    void TurnStream::encodePendingTurns()
+    {
+        const int size = TurnCodec::EncodeBlock(mPendingTurns, mPendingCount, mCharaCount, sBlockData);
+        addBlock(sBlockData, size);
+        mPendingCount = 0;
+    }
+
+    //------------------------------------------------------------------------------
+    /// 圧縮したブロックを Arena に複製して格納します。
+    ///
+    /// @param[in] aData ブロック。
+    /// @param[in] aSize ブロックのバイト数。
+    void TurnStream::addBlock(const unsigned char* aData, int aSize)
+    {
+        HPC_ASSERT(mArena != 0);
+        HPC_RANGE_ASSERT_MIN_UB_I(mEncodedBlockCount, 0, TurnCodec::BlockCountMax);
+        unsigned char* const block = mArena->allocate(aSize);
+        HPC_ASSERT_MSG(block != 0, "Arena is exhausted.");
+        std::memcpy(block, aData, aSize);
+        mBlocks[mEncodedBlockCount] = block;
+        mBlockSizes[mEncodedBlockCount] = aSize;
+        mDataSize += aSize;
+        ++mEncodedBlockCount;
+    }
+}
+
+//------------------------------------------------------------------------------
+// EOF
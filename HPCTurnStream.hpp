@@ -0,0 +1,75 @@
+//------------------------------------------------------------------------------
+/// @file
+/// @brief    TurnStream クラス
+/// @author   ハル研究所プログラミングコンテスト実行委員会
+///
+/// @copyright  Copyright (c) 2014 HAL Laboratory, Inc.
+/// @attention  このファイルの利用は、同梱のREADMEにある
+///             利用条件に従ってください
+
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "HPCArena.hpp"
+#include "HPCTurnCodec.hpp"
+#include "HPCTurnResult.hpp"
+
+namespace hpc {
+
+    class ReplayReader;
+    class ReplayWriter;
+
+    //------------------------------------------------------------------------------
+    /// 1ステージ分のターンごとの記録を、圧縮して保持します。
+    ///
+    /// 記録は TurnCodec::BlockTurnCount ターンたまるごとにブロックとして圧縮し、
+    /// setArena() で指定した Arena から、ブロックの大きさ分だけ領域を確保して格納します。
+    /// 最後のブロックは finish() を呼んだ時点で圧縮します。
+    /// 形式は TurnCodec を参照してください。
+    ///
+    /// 記録を消去しても、確保した領域は Arena をリセットするまで解放されません。
+    class TurnStream
+    {
+    public:
+        /// 1ステージ分の記録を格納するのに必要な Arena のバイト数の最大値
+        static const int ArenaSizeMax = TurnCodec::BlockCountMax * TurnCodec::BlockSizeMax;
+        /// リプレイファイルに書き込むバイト数の最大値
+        static const int ReplaySizeMax = 4 * (TurnCodec::BlockCountMax + 1) + ArenaSizeMax;
+
+        TurnStream();
+
+        void setArena(Arena& aArena);                       ///< 圧縮したブロックを格納する Arena を設定します。
+        void set(const TurnStream& aStream);                ///< 記録を複製します。
+        void reset(int aCharaCount);                        ///< 記録を消去します。
+        void append(const TurnResult& aResult);             ///< ターンの記録を追加します。
+        void finish();                                      ///< 残りの記録を圧縮します。
+
+        int count()const;                                  ///< 記録したターン数を返します。
+        int blockCount()const;                             ///< ブロック数を返します。
+        int readBlock(int aBlockIndex, TurnResult* aTurns)const;   ///< ブロックを展開します。
+        bool readTurn(int aTurn, TurnResult& aResult)const;        ///< ターン1つ分の記録を取得します。
+
+        int replaySize()const;                             ///< リプレイファイルに書き込むバイト数を返します。
+        void writeReplay(ReplayWriter& aWriter)const;      ///< リプレイファイルに書き込みます。
+        bool readReplay(ReplayReader& aReader, int aCharaCount, int aTurnCount); ///< リプレイファイルから読み込みます。
+
+    private:
+        TurnStream(const TurnStream& aStream);              ///< コピーはできません。 set() を使います。
+        TurnStream& operator=(const TurnStream& aStream);   ///< コピーはできません。 set() を使います。
+
+        void encodePendingTurns();                          ///< 圧縮前の記録をブロックとして圧縮します。
+        void addBlock(const unsigned char* aData, int aSize); ///< 圧縮したブロックを格納します。
+
+        Arena* mArena;                                      ///< 圧縮したブロックを格納する Arena
+        const unsigned char* mBlocks[TurnCodec::BlockCountMax]; ///< 圧縮したブロック
+        int mBlockSizes[TurnCodec::BlockCountMax];          ///< 圧縮したブロックのバイト数
+        int mDataSize;                                      ///< 圧縮したブロックの合計のバイト数
+        int mEncodedBlockCount;                             ///< 圧縮したブロック数
+        TurnResult mPendingTurns[TurnCodec::BlockTurnCount];///< 圧縮前の記録
+        int mPendingCount;                                  ///< 圧縮前の記録の数
+        int mTurnCount;                                     ///< 記録したターン数
+        int mCharaCount;                                    ///< キャラ数
+    };
+}
+//------------------------------------------------------------------------------
+// EOF
@@ -13,6 +13,7 @@
 
 #include "HPCCommon.hpp"
 #include "HPCMath.hpp"
+#include "HPCSimd.hpp"
 
 namespace hpc {
 
@@ -209,6 +210,63 @@ namespace hpc {
         return aVec;
     }
 
+    //------------------------------------------------------------------------------
+    /// 要素ごとの配列で表した複数のベクトルについて、長さを aAmount だけ縮めます。
+    /// 長さが 0 以下になるベクトルはゼロベクトルに、ゼロベクトルはそのままにします。
+    ///
+    /// 要素ごとの結果は、次の処理と完全に一致します。
+    /// @code
+    /// if (!vec.isZero()) {
+    ///     const float len = Math::Max(vec.length() - aAmount, 0.0f);
+    ///     if (0.0f < len) {
+    ///         vec.normalize(len);
+    ///     } else {
+    ///         vec.reset();
+    ///     }
+    /// }
+    /// @endcode
+    ///
+    /// @param[in,out] aXs  ベクトルの x 要素の配列。
+    /// @param[in,out] aYs  ベクトルの y 要素の配列。
+    /// @param[in] aAmount  縮める長さ。
+    /// @param[in] aCount   ベクトルの数。
+    void Vec2::ShortenBatch(float* aXs, float* aYs, float aAmount, int aCount)
+    {
+        int index = 0;
+#ifdef HPC_SIMD_SSE2
+        {
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 amount = _mm_set1_ps(aAmount);
+            for (; index + 4 <= aCount; index += 4) {
+                const __m128 x = _mm_loadu_ps(aXs + index);
+                const __m128 y = _mm_loadu_ps(aYs + index);
+                const __m128 isZero = _mm_and_ps(_mm_cmpeq_ps(x, zero), _mm_cmpeq_ps(y, zero));
+                const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)));
+                const __m128 len = _mm_max_ps(_mm_sub_ps(length, amount), zero);
+                // ゼロベクトルでなく、長さが残る要素のみ正規化した値を使う
+                const __m128 isScaled = _mm_andnot_ps(isZero, _mm_cmplt_ps(zero, len));
+                const __m128 scaledX = _mm_mul_ps(_mm_div_ps(x, length), len);
+                const __m128 scaledY = _mm_mul_ps(_mm_div_ps(y, length), len);
+                _mm_storeu_ps(aXs + index, _mm_or_ps(_mm_and_ps(isScaled, scaledX), _mm_and_ps(isZero, x)));
+                _mm_storeu_ps(aYs + index, _mm_or_ps(_mm_and_ps(isScaled, scaledY), _mm_and_ps(isZero, y)));
+            }
+        }
+#endif
+        for (; index < aCount; ++index) {
+            Vec2 vec(aXs[index], aYs[index]);
+            if (!vec.isZero()) {
+                const float len = Math::Max(vec.length() - aAmount, 0.0f);
+                if (0.0f < len) {
+                    vec.normalize(len);
+                } else {
+                    vec.reset();
+                }
+            }
+            aXs[index] = vec.x;
+            aYs[index] = vec.y;
+        }
+    }
+
     //------------------------------------------------------------------------------
     /// 値の表すベクトル (x, y) を引数に与えられた角度方向に回転させます。
     ///
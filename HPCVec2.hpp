@@ -63,6 +63,12 @@ namespace hpc {
         void project(const Vec2& aVec);                         ///< ベクトルを射影します。
         Vec2 getProjected(const Vec2& aVec)const;               ///< 射影したベクトルを返します。
 
+        ///@name 複数のベクトルをまとめて扱う関数
+        //@{
+        /// 要素ごとの配列で表したベクトルの長さを、まとめて一定量縮めます。
+        static void ShortenBatch(float* aXs, float* aYs, float aAmount, int aCount);
+        //@}
+
         float x;    ///< 値の x 要素
         float y;    ///< 値の y 要素
     };